@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+
+import argparse
+import os
+import random
+import re
+
+CONFIG_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "main", "config.h")
+
+# esp_now.h: the driver's peer table, which the broadcast peer also occupies
+ESP_NOW_MAX_TOTAL_PEER_NUM = 20
+
+def load_config(path):
+    """Integer #defines from config.h and the headers next to it that size the peer tables."""
+    values = {}
+    folder = os.path.dirname(path)
+    for name in (path, os.path.join(folder, "Manager.h"), os.path.join(folder, "PeerRegistry.h")):
+        with open(name) as f:
+            for line in f:
+                match = re.match(r"#define\s+(\w+)\s+(\d+)\b", line)
+                if match:
+                    values[match.group(1)] = int(match.group(2))
+    return values
+
+class PeerCache:
+    """Sender::ensurePeerSlot: real ESP-NOW peer slots for unicast, least recently used evicted first."""
+
+    def __init__(self, size):
+        self.slots = {}  # MAC -> clock when last used
+        self.size = size
+        self.clock = 0
+        self.hits = self.misses = self.evictions = 0
+        self.peak = 0
+
+    def ensure(self, mac):
+        self.clock += 1
+        if mac in self.slots:
+            self.hits += 1
+        else:
+            self.misses += 1
+            if len(self.slots) == self.size:
+                del self.slots[min(self.slots, key=self.slots.get)]  # esp_now_del_peer
+                self.evictions += 1
+        self.slots[mac] = self.clock  # esp_now_add_peer on a miss
+        self.peak = max(self.peak, len(self.slots))
+
+class Receiver:
+    """What frameAddressedTo in main/Messages.h lets through to one receiver."""
+
+    def __init__(self, mac):
+        self.mac = mac
+        self.node_id = None
+        self.accepted = 0
+        self.filtered = 0
+        self.expected = 0
+
+    def hear(self, destination):
+        # Broadcasts reach everyone in range; a destination extension leaves one taker
+        if destination is None or destination == self.node_id:
+            self.accepted += 1
+        else:
+            self.filtered += 1
+
+def main():
+    parser = argparse.ArgumentParser(description="Drive a fleet of virtual receivers through node-ID addressing.")
+    parser.add_argument("--nodes", type=int, default=200)
+    parser.add_argument("--frames", type=int, default=5000, help="Show traffic after registration and group assignment")
+    parser.add_argument("--targeted", type=float, default=0.2, help="Share of frames for one node, broadcast with its node ID")
+    parser.add_argument("--unicast", type=float, default=0.1, help="Share of frames unicast to one node")
+    parser.add_argument("--skew", type=float, default=1.1, help="Zipf exponent of which nodes get per-node frames, 0 for uniform")
+    parser.add_argument("--cache", type=int, help="Peer cache slots, default ESPNOW_PEER_CACHE_SIZE")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--config", default=CONFIG_H, help="Path to config.h")
+    args = parser.parse_args()
+
+    cfg = load_config(args.config)
+    cache_size = args.cache or cfg["ESPNOW_PEER_CACHE_SIZE"]
+    capacity = cfg["PEER_REGISTRY_CAPACITY"]
+    rng = random.Random(args.seed)
+    receivers = [Receiver(rng.getrandbits(48)) for _ in range(args.nodes)]
+    print(f"{args.nodes} receivers, {args.frames} show frames ({(1 - args.targeted - args.unicast) * 100:.0f}% fleet, "
+          f"{args.targeted * 100:.0f}% to one node by broadcast, {args.unicast * 100:.0f}% unicast), "
+          f"{cache_size} peer cache slots")
+
+    # One ESP-NOW peer per receiver, as before node IDs: the table fills with the broadcast peer and 19 others
+    reachable = min(args.nodes, ESP_NOW_MAX_TOTAL_PEER_NUM - 1)
+    print(f"peer per receiver:   {reachable} of {args.nodes} receivers registered, the rest get ESP_ERR_ESPNOW_FULL")
+
+    # PeerRegistry::add hands out node IDs in order of first registration
+    order = receivers[:]
+    rng.shuffle(order)
+    registered = order[:capacity]
+    for node_id, receiver in enumerate(registered, 1):
+        receiver.node_id = node_id
+
+    # Per-node frames favour some nodes, the way an operator keeps adjusting the same few
+    weights = [1 / rank ** args.skew for rank in range(1, len(registered) + 1)]
+    rng.shuffle(weights)
+
+    cache = PeerCache(cache_size)
+    frames = 0
+    def send(destination, unicast):
+        nonlocal frames
+        frames += 1
+        if unicast:
+            cache.ensure(destination.mac)
+            destination.hear(destination.node_id)  # Only the addressed radio hears a unicast
+            destination.expected += 1
+            return
+        for receiver in registered:
+            receiver.hear(destination.node_id if destination else None)
+            if destination is None or destination is receiver:
+                receiver.expected += 1
+
+    # Sender::sendGroupAssign, unicast to every node once
+    for receiver in registered:
+        send(receiver, True)
+    sweep_misses = cache.misses
+
+    for _ in range(args.frames):
+        roll = rng.random()
+        if roll < args.unicast:
+            send(rng.choices(registered, weights)[0], True)
+        elif roll < args.unicast + args.targeted:
+            send(rng.choices(registered, weights)[0], False)
+        else:
+            send(None, False)
+
+    correct = all(r.accepted == r.expected for r in registered)
+    filtered = sum(r.filtered for r in registered) / len(registered)
+    accepted = sum(r.accepted for r in registered) / len(registered)
+    show_unicasts = cache.hits + cache.misses - len(registered)
+    print(f"logical addressing:  {len(registered)} of {args.nodes} receivers registered with node IDs 1-{len(registered)}"
+          f" (registry holds {capacity})")
+    print(f"  ESP-NOW peers in use at most {cache.peak + 1} of {ESP_NOW_MAX_TOTAL_PEER_NUM} "
+          f"({cache.peak} cached + broadcast)")
+    print(f"  group assignment sweep: {len(registered)} unicasts, {sweep_misses} peer cache misses")
+    print(f"  show traffic: {show_unicasts} unicasts, "
+          f"{(cache.hits * 100.0 / show_unicasts) if show_unicasts else 0:.1f}% peer cache hits, "
+          f"{cache.evictions} evictions in all")
+    print(f"  per receiver: {accepted:.0f} frames accepted, {filtered:.0f} dropped by node ID filtering")
+    print(f"  every receiver got exactly its own frames: {'yes' if correct else 'NO'}")
+
+if __name__ == "__main__":
+    main()
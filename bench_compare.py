@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+
+import argparse
+import json
+import sys
+
+def load_results(path):
+    """Map (name, param) to the result dict for every "BENCH:{...}" line in a capture."""
+    results = {}
+    stream = open(path, errors="replace") if path != "-" else sys.stdin
+    for line in stream:
+        marker = line.find("BENCH:{")
+        if marker < 0:
+            continue
+        try:
+            result = json.loads(line[marker + 6:])
+        except ValueError:
+            continue
+        results[(result["name"], result["param"])] = result
+    return results
+
+def allocs_per_op(result):
+    return None if result.get("allocs") is None else result["allocs"] / result["iterations"]
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare benchmark results from a board or hot_path_bench against a baseline.")
+    parser.add_argument("capture", help="Serial capture of a benchmark run (- for stdin)")
+    parser.add_argument("--baseline", help="Baseline JSON written by --save")
+    parser.add_argument("--save", help="Write the capture's results as a baseline JSON file")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="Allowed increase in mean cycles, in percent (default: 10)")
+    args = parser.parse_args()
+
+    results = load_results(args.capture)
+    if not results:
+        sys.exit("No BENCH results in capture")
+
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump(sorted(results.values(), key=lambda r: (r["name"], r["param"])), f, indent=1)
+        print(f"Saved {len(results)} results to {args.save}")
+
+    if not args.baseline:
+        for (name, param), result in sorted(results.items()):
+            print(f"{name:<22} {param:>5} {result['cycles_mean']:>9} cycles (min {result['cycles_min']})")
+        return
+
+    with open(args.baseline) as f:
+        baseline = {(r["name"], r["param"]): r for r in json.load(f)}
+
+    regressions = 0
+    for key in sorted(set(baseline) | set(results)):
+        name, param = key
+        if key not in results:
+            print(f"{name:<22} {param:>5}  missing from capture")
+            regressions += 1
+            continue
+        if key not in baseline:
+            print(f"{name:<22} {param:>5}  new, no baseline")
+            continue
+
+        old, new = baseline[key], results[key]
+        change = (new["cycles_mean"] - old["cycles_mean"]) * 100.0 / max(old["cycles_mean"], 1)
+        status = "ok"
+        if change > args.threshold:
+            status = "REGRESSION"
+        old_allocs, new_allocs = allocs_per_op(old), allocs_per_op(new)
+        if old_allocs is not None and new_allocs is not None and new_allocs > old_allocs:
+            status = "REGRESSION (allocs)"
+        if status != "ok":
+            regressions += 1
+        allocs = "" if new_allocs is None else f"  {new_allocs:.2f} allocs/op"
+        print(f"{name:<22} {param:>5} {old['cycles_mean']:>9} -> {new['cycles_mean']:>9} cycles "
+              f"({change:+.1f}%){allocs}  {status}")
+
+    if regressions:
+        sys.exit(f"{regressions} regression(s) beyond {args.threshold}%")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,278 @@
+#!/usr/bin/env python3
+
+import argparse
+import os
+import random
+import re
+
+CONFIG_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "main", "config.h")
+
+TICK_S = 0.05
+# Share of an interferer's energy that lands on a channel this many channels away:
+# 2.4 GHz channels are 5 MHz apart and a Wi-Fi transmission is about 20 MHz wide
+OVERLAP = {0: 1.0, 1: 0.75, 2: 0.4, 3: 0.1}
+# Share of its frames a radio this many channels away still decodes. The survey
+# counts only what the promiscuous callback receives, so most adjacent-channel
+# energy, which still costs us frames, goes unseen.
+DECODE = {0: 1.0, 1: 0.3}
+BYTES_PER_MS = 2000        # Decoded bytes per ms from a channel kept fully busy
+
+def load_config(path):
+    """Integer #defines from config.h and the headers next to it that hold the channel settings."""
+    values = {}
+    folder = os.path.dirname(path)
+    for name in (path, os.path.join(folder, "Manager.h")):
+        with open(name) as f:
+            for line in f:
+                match = re.match(r"#define\s+(\w+)\s+(\d+)\b", line)
+                if match:
+                    values[match.group(1)] = int(match.group(2))
+    return values
+
+class Interferer:
+    """A Wi-Fi network on `channel`, busy for `duty` of the airtime while active. Bursty
+    ones switch on and off after exponentially distributed periods."""
+
+    def __init__(self, rng, channel, duty, start_s=0.0, mean_on_s=None, mean_off_s=None):
+        self.rng = rng
+        self.channel = channel
+        self.duty = duty
+        self.mean_on_s = mean_on_s
+        self.mean_off_s = mean_off_s
+        self.toggles = [start_s]  # Switches on at the first time, then alternates
+
+    def active(self, t):
+        while self.mean_on_s and self.toggles[-1] <= t:
+            on = len(self.toggles) % 2 == 1
+            self.toggles.append(self.toggles[-1] + self.rng.expovariate(1 / (self.mean_on_s if on else self.mean_off_s)))
+        return sum(1 for toggle in self.toggles if toggle <= t) % 2 == 1
+
+def scenario(name, rng, onset_s):
+    """Interferers of each venue model, and the channel the fleet starts on."""
+    if name == "venue":
+        # Busy venue Wi-Fi on the usual non-overlapping channels, the heaviest on ours
+        return 1, [Interferer(rng, 1, 0.6), Interferer(rng, 6, 0.35), Interferer(rng, 11, 0.25)]
+    if name == "onset":
+        # Quiet until a video stream starts on our channel partway through the show
+        return 6, [Interferer(rng, 1, 0.15), Interferer(rng, 11, 0.15), Interferer(rng, 6, 0.7, start_s=onset_s)]
+    if name == "bursty":
+        # Networks that come and go, to check that the hysteresis keeps us from flapping
+        return 1, [Interferer(rng, channel, 0.5, mean_on_s=20, mean_off_s=40) for channel in (1, 6, 11)]
+    if name == "adjacent":
+        # Networks between the usual channels, whose energy spills onto 3 and 4 while
+        # the survey decodes little of it there
+        return 1, [Interferer(rng, 1, 0.3), Interferer(rng, 2, 0.5), Interferer(rng, 5, 0.5),
+                   Interferer(rng, 9, 0.2), Interferer(rng, 13, 0.2)]
+    raise ValueError(name)
+
+def energy(interferers, channel, t):
+    idle = 1.0
+    for source in interferers:
+        d = abs(source.channel - channel)
+        if d in OVERLAP and source.active(t):
+            idle *= 1 - source.duty * OVERLAP[d]
+    return 1 - idle
+
+def loss(args, interferers, channel, t):
+    """Chance that one of our frames is lost on `channel` at `t`."""
+    return args.base_loss + (1 - args.base_loss) * min(1.0, args.collide * energy(interferers, channel, t))
+
+def survey_bytes(rng, interferers, channel, t, dwell_ms):
+    """What ChannelSurvey's promiscuous callback counts during one dwell."""
+    decoded = sum(source.duty * DECODE[abs(source.channel - channel)]
+                  for source in interferers if abs(source.channel - channel) in DECODE and source.active(t))
+    mean = decoded * dwell_ms * BYTES_PER_MS
+    return max(0, int(rng.gauss(mean, mean ** 0.5 * 10))) if mean else 0
+
+SPILL_PERCENT = (100, 75, 40, 10)
+
+def score(busy, channel, cfg):
+    """ChannelSurvey::score: busy bytes here and, weighted by overlap, on the neighbours."""
+    total = 0
+    for d in range(-3, 4):
+        if cfg["ESPNOW_CHANNEL_MIN"] <= channel + d <= cfg["ESPNOW_CHANNEL_MAX"]:
+            total += busy[channel + d] * SPILL_PERCENT[abs(d)] // 100
+    return total
+
+def best(busy, current, cfg):
+    """ChannelSurvey::best."""
+    quietest = current
+    for channel in range(cfg["ESPNOW_CHANNEL_MIN"], cfg["ESPNOW_CHANNEL_MAX"] + 1):
+        if score(busy, channel, cfg) < score(busy, quietest, cfg):
+            quietest = channel
+    threshold = score(busy, current, cfg) * cfg["CHANNEL_SWITCH_HYSTERESIS_PERCENT"] // 100
+    return quietest if score(busy, quietest, cfg) < threshold else current
+
+class Node:
+    def __init__(self, channel):
+        self.channel = channel
+        self.registered = True
+        self.last_heard = 0.0
+        self.pending = None        # (channel, switch time) from the last ChannelSwitch heard
+        self.lost_at = None
+        self.next_try = None       # Next registration request while scanning
+        self.attempt = 0
+        self.scan_index = 0
+        self.scan_start = channel
+
+def simulate(args, cfg, name, agile):
+    rng = random.Random(args.seed)
+    home, interferers = scenario(name, rng, args.onset * 60)
+    nodes = [Node(home) for _ in range(args.nodes)]
+    channel_min, channel_max = cfg["ESPNOW_CHANNEL_MIN"], cfg["ESPNOW_CHANNEL_MAX"]
+    channels = channel_max - channel_min + 1
+    dwell_s = cfg["CHANNEL_SURVEY_DWELL_MS"] / 1000
+    switch_delay_s = cfg["ESPNOW_CHANNEL_SWITCH_DELAY_MS"] / 1000
+    announce_every_s = switch_delay_s / cfg["ESPNOW_CHANNEL_SWITCH_REPEATS"]
+    timeout_s = cfg["ESPNOW_KEEPALIVE_TIMEOUT_MS"] / 1000
+    scan_dwell_s = cfg["ESPNOW_REGISTRATION_SCAN_DWELL_MS"] / 1000
+    summary_s = cfg["FLEET_SUMMARY_INTERVAL_MS"] / 1000
+
+    stats = {"sent": 0, "delivered": 0, "surveys": 0, "early": 0, "migrations": [], "stranded": 0,
+             "rejoin": [], "regret": [], "held": 0}
+    survey_at = 0.0 if agile else None  # Sender::init surveys straight away
+    surveying = None                      # (next channel, busy bytes so far) while a survey runs
+    next_dwell = 0.0
+    last_survey = 0.0
+    pending = None                        # (channel, switch time) while migrating
+    next_announce = 0.0
+    window_sent = window_delivered = 0
+    next_summary = summary_s
+    frame_credit = 0.0
+
+    def backoff_s(attempt):
+        # Receiver::registrationBackoffMs
+        ceiling = min(cfg["ESPNOW_REGISTRATION_BACKOFF_MAX_MS"], cfg["ESPNOW_REGISTRATION_BACKOFF_BASE_MS"] << min(attempt, 16))
+        return rng.randint(0, ceiling) / 1000
+
+    ticks = int(args.minutes * 60 / TICK_S)
+    for tick in range(ticks):
+        t = tick * TICK_S
+        here = loss(args, interferers, home, t)
+
+        # Sender::stepChannelSurvey, one channel per CHANNEL_SURVEY_DWELL_MS
+        if survey_at is not None and surveying is None and pending is None and t >= survey_at:
+            surveying, next_dwell = (channel_min, {}), t
+            stats["surveys"] += 1
+        if surveying is not None and t >= next_dwell:
+            channel, busy = surveying
+            if channel <= channel_max:
+                busy[channel] = survey_bytes(rng, interferers, channel, t, cfg["CHANNEL_SURVEY_DWELL_MS"])
+                surveying, next_dwell = (channel + 1, busy), t + dwell_s
+            else:
+                surveying = None
+                last_survey = t
+                survey_at = t + cfg["CHANNEL_SURVEY_INTERVAL_MS"] / 1000
+                choice = best(busy, home, cfg)
+                truth = min(loss(args, interferers, c, t) for c in range(channel_min, channel_max + 1))
+                stats["regret"].append(loss(args, interferers, choice, t) - truth)
+                if choice != home:
+                    pending, next_announce = (choice, t + switch_delay_s), t
+                    stats["migrations"].append((home, choice, t))
+
+        # Sender::stepChannelSwitch: announce the remaining countdown, then hop
+        if pending is not None and t >= next_announce:
+            if t >= pending[1]:
+                home, pending = pending[0], None
+                here = loss(args, interferers, home, t)
+            else:
+                for node in nodes:
+                    if node.registered and node.channel == home and rng.random() >= here:
+                        node.pending = pending
+                next_announce = min(pending[1], t + announce_every_s)
+
+        # Show frames, held back while the survey has the radio
+        frame_credit += args.fps * TICK_S
+        frames = int(frame_credit)
+        frame_credit -= frames
+        if surveying is not None:
+            stats["held"] += frames
+            frames = 0
+        for _ in range(frames):
+            for node in nodes:
+                got = node.registered and node.channel == home and rng.random() >= here
+                node.last_heard = t if got else node.last_heard
+                stats["delivered"] += got
+                window_delivered += got
+            stats["sent"] += len(nodes)
+            window_sent += len(nodes)
+
+        for node in nodes:
+            # Receiver::applyChannelSwitch
+            if node.pending is not None and t >= node.pending[1]:
+                node.channel, node.pending = node.pending[0], None
+            if node.registered:
+                # Receiver::keepaliveTimeout, then broadcastRegistration's scan
+                if surveying is None and t - node.last_heard > timeout_s:
+                    node.registered, node.lost_at, node.attempt = False, t, 0
+                    node.scan_start, node.scan_index = node.channel, channels
+                    stats["stranded"] += 1
+                continue
+            if node.next_try is None or t >= node.next_try:
+                if node.scan_index >= channels:
+                    node.scan_index = 0
+                    node.next_try = t + backoff_s(node.attempt)
+                    node.attempt += 1
+                    continue
+                channel = channel_min + (node.scan_start - channel_min + node.scan_index) % channels
+                node.channel = channel if agile else node.scan_start
+                node.scan_index += 1
+                node.next_try = t + (scan_dwell_s if agile else 0)
+                if not agile:
+                    node.scan_index = channels
+                # Request and acknowledgement both have to get through
+                if node.channel == home and surveying is None and rng.random() >= here and rng.random() >= here:
+                    node.registered, node.last_heard, node.next_try = True, t, None
+                    stats["rejoin"].append(t - node.lost_at)
+
+        # Sender::logFleetSummary's loss trigger
+        if t >= next_summary:
+            next_summary += summary_s
+            window_loss = 1 - window_delivered / window_sent if window_sent else 0
+            window_sent = window_delivered = 0
+            if (agile and window_loss * 1000 > cfg["CHANNEL_LOSS_TRIGGER_PERMILLE"] and surveying is None and pending is None
+                    and t - last_survey >= cfg["CHANNEL_LOSS_SURVEY_GAP_MS"] / 1000):
+                survey_at = t
+                stats["early"] += 1
+    stats["final"] = home
+    return stats
+
+def main():
+    parser = argparse.ArgumentParser(description="Check channel survey and fleet migration against per-channel interference.")
+    parser.add_argument("--scenario", choices=("venue", "onset", "bursty", "adjacent", "all"), default="all")
+    parser.add_argument("--nodes", type=int, default=30)
+    parser.add_argument("--minutes", type=float, default=60, help="Simulated show length")
+    parser.add_argument("--onset", type=float, default=20, help="Minutes before the onset scenario's interference starts")
+    parser.add_argument("--fps", type=float, default=10, help="Show frames per second")
+    parser.add_argument("--base-loss", type=float, default=0.02, help="Loss on a quiet channel")
+    parser.add_argument("--collide", type=float, default=0.6, help="Share of interferer airtime that costs us a frame")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--config", default=CONFIG_H, help="Path to config.h")
+    args = parser.parse_args()
+
+    cfg = load_config(args.config)
+    print(f"{args.nodes} receivers, {args.fps:.0f} frames/s for {args.minutes:.0f} min; survey every "
+          f"{cfg['CHANNEL_SURVEY_INTERVAL_MS'] / 60000:.0f} min or above {cfg['CHANNEL_LOSS_TRIGGER_PERMILLE'] / 10:.0f}% loss, "
+          f"{cfg['CHANNEL_SURVEY_DWELL_MS']} ms per channel, move at {cfg['CHANNEL_SWITCH_HYSTERESIS_PERCENT']}% of our score")
+    names = ("venue", "onset", "bursty", "adjacent") if args.scenario == "all" else (args.scenario,)
+    for name in names:
+        fixed = simulate(args, cfg, name, False)
+        agile = simulate(args, cfg, name, True)
+        moves = ", ".join(f"{a}->{b} at {t / 60:.1f} min" for a, b, t in agile["migrations"]) or "none"
+        regret = max(agile["regret"]) * 100 if agile["regret"] else 0
+        rejoin = agile["rejoin"]
+        print(f"{name}:")
+        print(f"  fixed channel:  {fixed['delivered'] * 100 / fixed['sent']:5.1f}% delivered")
+        print(f"  channel agile:  {agile['delivered'] * 100 / agile['sent']:5.1f}% delivered, "
+              f"{agile['surveys']} surveys ({agile['early']} on loss), {agile['held']} frames held during surveys")
+        print(f"    migrations: {moves}; ends on channel {agile['final']}")
+        print(f"    worst survey choice: {regret:.1f} points more loss than the best channel at the time")
+        if not agile["stranded"]:
+            print("    every receiver followed the fleet")
+        elif len(rejoin) == agile["stranded"]:
+            print(f"    rescans after losing the sender: {agile['stranded']}, all back within {max(rejoin):.1f} s")
+        else:
+            print(f"    rescans after losing the sender: {agile['stranded']}, {agile['stranded'] - len(rejoin)} never back")
+
+if __name__ == "__main__":
+    main()
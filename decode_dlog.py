@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+DEFAULT_FORMATS = os.path.join(os.path.dirname(os.path.abspath(__file__)), "main", "LogFormats.h")
+MACSTR = '"%02x:%02x:%02x:%02x:%02x:%02x"'
+LEVEL_CHARS = "NEWIDV"
+HEADER = struct.Struct("<IHBB")
+
+def load_formats(path):
+    """Parse the DLOG_FORMATS X-macro table into a list of (id, tag, format)."""
+    with open(path) as f:
+        text = f.read()
+    formats = []
+    for match in re.finditer(r'X\((\w+),\s*"([^"]*)",\s*(.*?)\)\s*\\?\n', text):
+        name, tag, fmt = match.groups()
+        fmt = fmt.replace("MACSTR", MACSTR)
+        # Join adjacent string literals the way the compiler does
+        fmt = "".join(re.findall(r'"((?:[^"\\]|\\.)*)"', fmt))
+        formats.append((name, tag, fmt))
+    return formats
+
+def format_message(fmt, args):
+    """Apply a C format string to 32-bit argument words."""
+    args = list(args)
+    def convert(match):
+        spec = match.group(0)
+        if spec == "%%":
+            return "%"
+        spec = re.sub(r"[hlzjt]+", "", spec)
+        value = args.pop(0) if args else 0
+        if spec[-1] in "di":
+            value = value - (1 << 32) if value & 0x80000000 else value
+        elif spec[-1] == "c":
+            return chr(value & 0xFF)
+        return spec % value
+    return re.sub(r"%[-+ #0]*\d*(?:\.\d+)?[hlzjt]*[diuxXoc%]", convert, fmt)
+
+def decode_line(line, formats):
+    """Decode one "DLOG:<hex>" line, or return None if the line is not a record."""
+    marker = line.find("DLOG:")
+    if marker < 0:
+        return None
+    try:
+        raw = bytes.fromhex(line[marker + 5:].strip())
+    except ValueError:
+        return None
+    if len(raw) < HEADER.size:
+        return None
+
+    timestamp_us, format_id, level, argc = HEADER.unpack_from(raw)
+    args = struct.unpack_from(f"<{argc}I", raw, HEADER.size)
+    if format_id >= len(formats):
+        return f"? ({timestamp_us // 1000}) dlog: unknown format id {format_id} args={args}"
+
+    _, tag, fmt = formats[format_id]
+    level_char = LEVEL_CHARS[level] if level < len(LEVEL_CHARS) else "N"
+    return f"{level_char} ({timestamp_us // 1000}) {tag}: {format_message(fmt, args)}"
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode deferred binary log records from a serial capture.")
+    parser.add_argument("input", nargs="?", help="Capture file to decode (default: stdin)")
+    parser.add_argument("--formats", default=DEFAULT_FORMATS, help="Path to LogFormats.h")
+    args = parser.parse_args()
+
+    formats = load_formats(args.formats)
+    stream = open(args.input, errors="replace") if args.input else sys.stdin
+    for line in stream:
+        decoded = decode_line(line, formats)
+        # Pass everything else through so regular ESP_LOG output stays interleaved
+        print(decoded if decoded is not None else line.rstrip("\n"))
+
+if __name__ == "__main__":
+    main()
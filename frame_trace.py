@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+
+import argparse
+import os
+import re
+import struct
+import sys
+import time
+
+MESSAGES_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "main", "Messages.h")
+RECORD = struct.Struct("<I6sbBH")  # FrameTraceRecord
+FRAME = struct.Struct("<HHBB")     # MessageData fixed header
+FLAG_RX, FLAG_TX, FLAG_BROADCAST = 0x01, 0x02, 0x04
+
+def load_payload_types(path):
+    """Names of the PayloadType enumerators, in declaration order."""
+    with open(path) as f:
+        text = f.read()
+    body = re.search(r"enum class PayloadType\s*:\s*\w+\s*\{(.*?)\};", text, re.S).group(1)
+    body = re.sub(r"//[^\n]*", "", body)
+    return [name.strip() for name in body.split(",") if name.strip()]
+
+def parse_capture(stream):
+    """Raw records (header plus frame bytes) from the "FTRACE:<hex>" lines of a capture."""
+    records = []
+    for line in stream:
+        marker = line.find("FTRACE:")
+        if marker < 0:
+            continue
+        try:
+            raw = bytes.fromhex(line[marker + 7:].strip())
+        except ValueError:
+            continue  # END, REPLAYED and other status lines
+        if len(raw) >= RECORD.size and len(raw) == RECORD.size + RECORD.unpack_from(raw)[4]:
+            records.append(raw)
+    return records
+
+def describe(raw, payload_types, first_us):
+    timestamp_us, peer, rssi, flags, length = RECORD.unpack_from(raw)
+    frame = raw[RECORD.size:]
+    direction = "RX" if flags & FLAG_RX else "TX"
+    address = "bcast" if flags & FLAG_BROADCAST else "ucast"
+    mac = ":".join(f"{b:02x}" for b in peer)
+    text = f"{(timestamp_us - first_us) & 0xFFFFFFFF:>10} us  {direction} {address} {mac} rssi={rssi:<4} len={length:<4}"
+    if len(frame) >= FRAME.size:
+        seq_num, crc, payload_type, frame_flags = FRAME.unpack_from(frame)
+        name = payload_types[payload_type] if payload_type < len(payload_types) else f"type{payload_type}"
+        text += f" seq={seq_num:<5} flags=0x{frame_flags:02x} {name}"
+    return text
+
+def show(args):
+    payload_types = load_payload_types(args.messages)
+    stream = open(args.capture, errors="replace") if args.capture else sys.stdin
+    records = parse_capture(stream)
+    first_us = RECORD.unpack_from(records[0])[0] if records else 0
+    for raw in records:
+        print(describe(raw, payload_types, first_us))
+    print(f"{len(records)} records")
+
+def replay(args):
+    try:
+        import serial
+    except ImportError:
+        sys.exit("replay needs pyserial (pip install pyserial)")
+
+    with open(args.capture, errors="replace") as f:
+        records = parse_capture(f)
+    if not records:
+        sys.exit("No FTRACE records in capture")
+
+    with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+        def command(line):
+            port.write(line.encode() + b"\n")
+            port.flush()
+            # The device polls its console, so give it time to drain the line
+            time.sleep(args.line_delay)
+
+        command("trace clear")
+        for raw in records:
+            command("trace load " + raw.hex())
+        command("trace replay fast" if args.fast else "trace replay")
+
+        deadline = time.monotonic() + args.timeout
+        while time.monotonic() < deadline:
+            line = port.readline().decode(errors="replace")
+            if not line:
+                continue
+            print(line.rstrip("\n"))
+            match = re.search(r"FTRACE:REPLAYED frames=(\d+) bytes=(\d+) us=(\d+)", line)
+            if match:
+                frames, size, elapsed_us = map(int, match.groups())
+                if elapsed_us:
+                    print(f"{frames} frames, {size} bytes in {elapsed_us / 1000:.1f} ms: "
+                          f"{frames * 1e6 / elapsed_us:.0f} frames/s")
+                return
+    sys.exit("Timed out waiting for the replay to finish")
+
+def main():
+    parser = argparse.ArgumentParser(description="Inspect frame trace captures and replay them on a device.")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    show_parser = sub.add_parser("show", help="List the frames in a capture")
+    show_parser.add_argument("capture", nargs="?", help="Serial capture containing a trace dump (default: stdin)")
+    show_parser.add_argument("--messages", default=MESSAGES_H, help="Path to Messages.h")
+    show_parser.set_defaults(func=show)
+
+    replay_parser = sub.add_parser("replay", help="Upload a capture to a device and replay it through its receive path")
+    replay_parser.add_argument("port", help="Serial port of the device")
+    replay_parser.add_argument("capture", help="Serial capture containing a trace dump")
+    replay_parser.add_argument("--fast", action="store_true", help="Replay back to back instead of with the original spacing")
+    replay_parser.add_argument("--baud", type=int, default=115200)
+    replay_parser.add_argument("--line-delay", type=float, default=0.1, help="Seconds between uploaded lines")
+    replay_parser.add_argument("--timeout", type=float, default=120, help="Seconds to wait for the replay to finish")
+    replay_parser.set_defaults(func=replay)
+
+    args = parser.parse_args()
+    args.func(args)
+
+if __name__ == "__main__":
+    main()
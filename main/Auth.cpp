@@ -0,0 +1,366 @@
+#include "Auth.h"
+
+#if ENABLE_AUTH
+
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+
+static_assert(sizeof(CONFIG_ESPNOW_PMK) - 1 == 16, "CONFIG_ESPNOW_PMK must be 16 bytes");
+static_assert(AUTH_REPLAY_WINDOW <= 32, "AUTH_REPLAY_WINDOW must fit the 32-bit window mask");
+
+static const char *TAG = "Auth";
+
+#define AUTH_NVS_NAMESPACE "auth"
+
+static const uint8_t *groupKey = reinterpret_cast<const uint8_t *>(CONFIG_ESPNOW_PMK);
+
+// Sender side
+static std::atomic<uint32_t> counter{0};
+static std::atomic<uint32_t> reservedUntil{0}; // Counters below this are covered by NVS
+static uint8_t ownMac[ESP_NOW_ETH_ALEN] = {0};  // Tagged into every frame we sign
+
+// Receiver side, only touched by recvLoop
+struct ReplayWindow {
+    bool used;
+    uint8_t origin[ESP_NOW_ETH_ALEN];
+    uint32_t highest; // Newest counter accepted
+    uint32_t seen;    // Bit n set: highest - n was accepted
+    uint32_t saved;   // Newest counter in NVS
+};
+
+// What NVS keeps of a window
+struct SavedWindow {
+    uint8_t origin[ESP_NOW_ETH_ALEN]; // All zero for an unused window
+    uint32_t highest;
+} __attribute__((packed));
+static ReplayWindow windows[AUTH_REPLAY_ORIGINS];
+static size_t nextWindow = 0; // Replaced next once every window is in use
+
+static esp_err_t saveReservation(uint32_t until) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(AUTH_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_u32(handle, "counter", until);
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to reserve auth counters: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+void Auth::restoreCounter() {
+    uint32_t saved = 0;
+    nvs_handle_t handle;
+    if (nvs_open(AUTH_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_u32(handle, "counter", &saved);
+        nvs_close(handle);
+    }
+
+    // Whatever the last boot used, it stayed below its reservation
+    counter = saved;
+    reservedUntil = saved + AUTH_COUNTER_RESERVE;
+    saveReservation(reservedUntil);
+    ESP_LOGI(TAG, "Auth counter resumes at %" PRIu32, saved);
+    esp_wifi_get_mac(static_cast<wifi_interface_t>(ESPNOW_WIFI_IF), ownMac);
+}
+
+// Everything up to the saved counter counts as seen: that is all we know of it
+void Auth::restoreWindows() {
+    SavedWindow saved[AUTH_REPLAY_ORIGINS] = {};
+    size_t len = sizeof(saved);
+    nvs_handle_t handle;
+    if (nvs_open(AUTH_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    esp_err_t err = nvs_get_blob(handle, "windows", saved, &len);
+    nvs_close(handle);
+    if (err != ESP_OK || len != sizeof(saved)) {
+        return;
+    }
+
+    static const uint8_t noMac[ESP_NOW_ETH_ALEN] = {0};
+    for (size_t i = 0; i < AUTH_REPLAY_ORIGINS; i++) {
+        if (std::memcmp(saved[i].origin, noMac, ESP_NOW_ETH_ALEN) == 0) {
+            continue;
+        }
+        windows[i].used = true;
+        std::memcpy(windows[i].origin, saved[i].origin, ESP_NOW_ETH_ALEN);
+        windows[i].highest = saved[i].highest;
+        windows[i].seen = UINT32_MAX;
+        windows[i].saved = saved[i].highest;
+        ESP_LOGI(TAG, "Replay window for MAC=" MACSTR " resumes at %" PRIu32, MAC2STR(saved[i].origin), saved[i].highest);
+    }
+}
+
+void Auth::saveWindows() {
+    SavedWindow saved[AUTH_REPLAY_ORIGINS] = {};
+    for (size_t i = 0; i < AUTH_REPLAY_ORIGINS; i++) {
+        if (windows[i].used) {
+            std::memcpy(saved[i].origin, windows[i].origin, ESP_NOW_ETH_ALEN);
+            saved[i].highest = windows[i].highest;
+        }
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(AUTH_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, "windows", saved, sizeof(saved));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save replay windows: %s", esp_err_to_name(err));
+        return;
+    }
+    for (auto &window : windows) {
+        window.saved = window.highest;
+    }
+}
+
+// Reserves the next block half way through the current one, so the counter never
+// gets ahead of what is in flash
+uint32_t Auth::nextCounter() {
+    uint32_t value = counter.fetch_add(1, std::memory_order_relaxed);
+    uint32_t until = reservedUntil.load(std::memory_order_relaxed);
+    if (value == until - AUTH_COUNTER_RESERVE / 2) {
+        reservedUntil.store(until + AUTH_COUNTER_RESERVE / 2, std::memory_order_relaxed);
+        saveReservation(until + AUTH_COUNTER_RESERVE / 2);
+    }
+    return value;
+}
+
+static inline uint64_t rotl(uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+static inline uint64_t load64(const uint8_t *p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v)); // Little-endian on every ESP32
+    return v;
+}
+
+static inline void sipRound(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3) {
+    v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+    v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+}
+
+// SipHash-2-4 fed in pieces, so a frame can be tagged without first copying it
+class SipHash {
+public:
+    explicit SipHash(const uint8_t *key) {
+        uint64_t k0 = load64(key);
+        uint64_t k1 = load64(key + 8);
+        v0 = 0x736f6d6570736575ULL ^ k0;
+        v1 = 0x646f72616e646f6dULL ^ k1;
+        v2 = 0x6c7967656e657261ULL ^ k0;
+        v3 = 0x7465646279746573ULL ^ k1;
+    }
+
+    // A null `data` feeds `len` zero bytes
+    void update(const uint8_t *data, size_t len) {
+        total += len;
+        while (len > 0) {
+            if (filled == 0 && len >= 8) {
+                compress(data ? load64(data) : 0);
+                data = data ? data + 8 : nullptr;
+                len -= 8;
+                continue;
+            }
+            pending |= static_cast<uint64_t>(data ? *data++ : 0) << (8 * filled);
+            len--;
+            if (++filled == 8) {
+                compress(pending);
+                pending = 0;
+                filled = 0;
+            }
+        }
+    }
+
+    uint64_t finish() {
+        compress(pending | static_cast<uint64_t>(total) << 56);
+        v2 ^= 0xff;
+        for (int i = 0; i < 4; i++) {
+            sipRound(v0, v1, v2, v3);
+        }
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+
+private:
+    void compress(uint64_t m) {
+        v3 ^= m;
+        sipRound(v0, v1, v2, v3);
+        sipRound(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    uint64_t v0, v1, v2, v3;
+    uint64_t pending = 0; // Bytes short of a whole word, little-endian
+    size_t filled = 0;    // How many bytes `pending` holds
+    size_t total = 0;
+};
+
+uint64_t Auth::siphash(const uint8_t *key, const uint8_t *data, size_t len) {
+    SipHash hash(key);
+    hash.update(data, len);
+    return hash.finish();
+}
+
+// Tag over the origin MAC followed by the frame, with every field that may change
+// after signing read as zero. The fields are skipped in the order they sit in the
+// frame, so nothing is copied: relayLoop and the sender reactor have small stacks.
+uint64_t Auth::frameTag(const uint8_t *frame, size_t len, const uint8_t *origin) {
+    uint8_t flags = reinterpret_cast<const MessageData *>(frame)->flags;
+    struct Field {
+        size_t offset;
+        size_t len;
+    } mutableFields[5];
+    size_t count = 0;
+    mutableFields[count++] = {offsetof(MessageData, crc), sizeof(uint16_t)};
+    if (flags & MESSAGE_FLAG_TRACE) {
+        mutableFields[count++] = {messageExtensionOffset(flags, MESSAGE_FLAG_TRACE), sizeof(TraceExtension)};
+    }
+    if (flags & MESSAGE_FLAG_RELAY) {
+        mutableFields[count++] = {messageExtensionOffset(flags, MESSAGE_FLAG_RELAY) + offsetof(RelayExtension, hops_left),
+                                  sizeof(uint8_t)};
+    }
+    mutableFields[count++] = {messageExtensionOffset(flags, MESSAGE_FLAG_AUTH) + offsetof(AuthExtension, tag), AUTH_TAG_LEN};
+    if (flags & MESSAGE_FLAG_WAKE_PHASE) {
+        mutableFields[count++] = {messageExtensionOffset(flags, MESSAGE_FLAG_WAKE_PHASE), sizeof(WakePhaseExtension)};
+    }
+
+    SipHash hash(groupKey);
+    hash.update(origin, ESP_NOW_ETH_ALEN);
+    size_t done = 0;
+    for (size_t i = 0; i < count; i++) {
+        hash.update(frame + done, mutableFields[i].offset - done);
+        hash.update(nullptr, mutableFields[i].len);
+        done = mutableFields[i].offset + mutableFields[i].len;
+    }
+    hash.update(frame + done, len - done);
+    return hash.finish();
+}
+
+void Auth::sign(uint8_t *frame, size_t len) {
+    const MessageData *message = reinterpret_cast<const MessageData *>(frame);
+    AuthExtension *auth = reinterpret_cast<AuthExtension *>(frame + messageExtensionOffset(message->flags, MESSAGE_FLAG_AUTH));
+    auth->counter = nextCounter();
+    uint64_t tag = frameTag(frame, len, ownMac);
+    std::memcpy(auth->tag, &tag, AUTH_TAG_LEN);
+}
+
+bool Auth::verifyTag(const uint8_t *frame, size_t len, const uint8_t *origin) {
+    const MessageData *message = reinterpret_cast<const MessageData *>(frame);
+    if (len < sizeof(MessageData) || len > ESP_NOW_MAX_DATA_LEN_V2 || !(message->flags & MESSAGE_FLAG_AUTH) ||
+        len < messageHeaderLength(message->flags)) {
+        return false;
+    }
+
+    AuthExtension auth;
+    std::memcpy(&auth, frame + messageExtensionOffset(message->flags, MESSAGE_FLAG_AUTH), sizeof(auth));
+    uint64_t tag = frameTag(frame, len, origin);
+
+    // Constant time, so timing does not reveal how much of a forged tag was right
+    uint8_t diff = 0;
+    const uint8_t *expected = reinterpret_cast<const uint8_t *>(&tag);
+    for (size_t i = 0; i < AUTH_TAG_LEN; i++) {
+        diff |= expected[i] ^ auth.tag[i];
+    }
+    return diff == 0;
+}
+
+bool Auth::verify(const uint8_t *frame, size_t len, const uint8_t *origin) {
+    if (!verifyTag(frame, len, origin)) {
+        ESP_LOGW(TAG, "Dropping frame with missing or bad tag from MAC=" MACSTR, MAC2STR(origin));
+        return false;
+    }
+
+    const MessageData *message = reinterpret_cast<const MessageData *>(frame);
+    AuthExtension auth;
+    std::memcpy(&auth, frame + messageExtensionOffset(message->flags, MESSAGE_FLAG_AUTH), sizeof(auth));
+
+    ReplayWindow *window = nullptr;
+    for (auto &candidate : windows) {
+        if (candidate.used && std::memcmp(candidate.origin, origin, ESP_NOW_ETH_ALEN) == 0) {
+            window = &candidate;
+            break;
+        }
+    }
+    if (!window) {
+        window = &windows[nextWindow];
+        nextWindow = (nextWindow + 1) % AUTH_REPLAY_ORIGINS;
+        window->used = true;
+        std::memcpy(window->origin, origin, ESP_NOW_ETH_ALEN);
+        window->highest = auth.counter;
+        window->seen = 1;
+        ESP_LOGI(TAG, "First authentic frame from MAC=" MACSTR ", replay window starts at %" PRIu32,
+                 MAC2STR(origin), auth.counter);
+        saveWindows();
+        return true;
+    }
+
+    if (auth.counter > window->highest) {
+        uint32_t shift = auth.counter - window->highest;
+        window->seen = shift >= AUTH_REPLAY_WINDOW ? 1 : (window->seen << shift) | 1;
+        window->highest = auth.counter;
+        if (window->highest - window->saved >= AUTH_WINDOW_SAVE_EVERY) {
+            saveWindows();
+        }
+        return true;
+    }
+    uint32_t age = window->highest - auth.counter;
+    if (age >= AUTH_REPLAY_WINDOW || (window->seen & (1u << age))) {
+        ESP_LOGW(TAG, "Dropping replayed frame from MAC=" MACSTR ": counter=%" PRIu32 ", newest=%" PRIu32,
+                 MAC2STR(origin), auth.counter, window->highest);
+        return false;
+    }
+    window->seen |= 1u << age;
+    return true;
+}
+
+void Auth::benchmark() {
+    // Reference vector from the SipHash paper: key 00..0f, message 00..0e
+    uint8_t key[16];
+    uint8_t message[15];
+    for (size_t i = 0; i < sizeof(key); i++) {
+        key[i] = i;
+    }
+    for (size_t i = 0; i < sizeof(message); i++) {
+        message[i] = i;
+    }
+    if (siphash(key, message, sizeof(message)) != 0xa129ca6149be45e5ULL) {
+        ESP_LOGE(TAG, "SipHash self-test failed");
+        return;
+    }
+
+    // A fleet frame as the sender builds it, payload filled up to each size
+    static const size_t sizes[] = {32, 64, 128, ESP_NOW_MAX_DATA_LEN};
+    static const int rounds = 200;
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN_V2] = {};
+    reinterpret_cast<MessageData *>(frame)->flags = MESSAGE_FLAG_RELAY | MESSAGE_FLAG_AUTH;
+    volatile uint64_t sink = 0;
+    for (size_t size : sizes) {
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < rounds; i++) {
+            sink = sink + frameTag(frame, size, ownMac);
+        }
+        int64_t elapsed = esp_timer_get_time() - start;
+        ESP_LOGI(TAG, "Tagging a %u-byte frame takes %" PRId64 " ns", static_cast<unsigned>(size), elapsed * 1000 / rounds);
+    }
+}
+
+#endif // ENABLE_AUTH
@@ -0,0 +1,59 @@
+#ifndef AUTH_H
+#define AUTH_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Messages.h"
+#include "config.h"
+
+#if ENABLE_AUTH
+
+// Application-layer authenticated broadcast. ESP-NOW's own encryption needs one
+// encrypted peer per receiver, only works for unicast and allows few such peers, so
+// instead every frame from the sender carries an AuthExtension: a counter and a
+// 64-bit SipHash-2-4 tag under the fleet-wide key CONFIG_ESPNOW_PMK. One broadcast
+// then reaches every board authenticated. The tag covers the frame and the MAC of
+// the sender that built it, so a capture replayed from another address fails. Fields
+// rewritten in flight (crc, the TraceExtension timestamps, the relay hop count and
+// the wake phase) are zeroed before tagging.
+//
+// The counter only grows: the sender reserves blocks of AUTH_COUNTER_RESERVE in NVS
+// ahead of use, and receivers drop counters they have already accepted or that fall
+// more than AUTH_REPLAY_WINDOW behind the newest. Receivers save each sender's newest
+// counter every AUTH_WINDOW_SAVE_EVERY frames and resume from it after a reboot, so
+// only frames accepted since the last save could be replayed, once each. Only a
+// sender never heard before is trusted from its first authentic frame.
+//
+// Uplink frames from receivers are not authenticated.
+class Auth {
+public:
+    // Sender: pick up the counter where the last boot left off
+    static void restoreCounter();
+    // Receiver: pick up the replay windows saved before the last reboot
+    static void restoreWindows();
+
+    // Sender: fill in the AuthExtension of a fully built frame, before its CRC
+    static void sign(uint8_t *frame, size_t len);
+
+    // Tag check only, for relays. `origin` is the MAC of the sender that built the
+    // frame: its RelayExtension origin, or the source address of a direct frame.
+    static bool verifyTag(const uint8_t *frame, size_t len, const uint8_t *origin);
+
+    // Receiver: tag check plus replay check against `origin`'s window. Only an
+    // authentic, fresh frame advances the window.
+    static bool verify(const uint8_t *frame, size_t len, const uint8_t *origin);
+
+    // Check SipHash against its reference vector and log how long tagging takes
+    // for a few frame sizes
+    static void benchmark();
+
+private:
+    static uint32_t nextCounter();
+    static uint64_t frameTag(const uint8_t *frame, size_t len, const uint8_t *origin);
+    static void saveWindows();
+    static uint64_t siphash(const uint8_t *key, const uint8_t *data, size_t len);
+};
+
+#endif // ENABLE_AUTH
+
+#endif // AUTH_H
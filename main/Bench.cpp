@@ -0,0 +1,431 @@
+#include "Bench.h"
+
+#if ENABLE_BENCH
+
+#include "Sender.h"
+#include "Receiver.h"
+#include "PeerRegistry.h"
+#include "Messages.h"
+#include "SpscRing.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+static const char *TAG = "Bench";
+
+#if CONFIG_HEAP_USE_HOOKS
+// Called by the heap on every allocation
+static std::atomic<uint32_t> allocations{0};
+extern "C" void esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+}
+extern "C" void esp_heap_trace_free_hook(void *ptr) {}
+#endif
+
+static const size_t frameSizes[] = {16, 64, 128, ESP_NOW_MAX_DATA_LEN};
+// ChangePattern payload sizes
+static const size_t payloadSizes[] = {32, 64, 128, 200};
+static const size_t peerCounts[] = {1, 16, 64, PEER_REGISTRY_CAPACITY};
+static const size_t producerCounts[] = {1, 2, 4, 8};
+
+static const uint8_t benchMac[ESP_NOW_ETH_ALEN] = {0x02, 0xbe, 0x4c, 0x00, 0x00, 0x01};
+
+struct BenchStats {
+    uint32_t iterations = 0;
+    uint64_t cycles = 0;
+    uint32_t minCycles = UINT32_MAX;
+    uint32_t allocations = 0;
+};
+
+// Times one call of `op`, so per-iteration setup stays out of the numbers
+template <typename Op>
+static void measure(BenchStats &stats, Op &&op) {
+#if CONFIG_HEAP_USE_HOOKS
+    uint32_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+#endif
+    uint32_t start = esp_cpu_get_cycle_count();
+    op();
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+#if CONFIG_HEAP_USE_HOOKS
+    stats.allocations += allocations.load(std::memory_order_relaxed) - allocationsBefore;
+#endif
+    stats.iterations++;
+    stats.cycles += cycles;
+    if (cycles < stats.minCycles) {
+        stats.minCycles = cycles;
+    }
+}
+
+static void report(const char *name, size_t param, const BenchStats &stats) {
+    if (stats.iterations == 0) {
+        return;
+    }
+#if CONFIG_HEAP_USE_HOOKS
+    char allocs[12];
+    snprintf(allocs, sizeof(allocs), "%" PRIu32, stats.allocations);
+#else
+    const char *allocs = "null";
+#endif
+    printf("BENCH:{\"name\":\"%s\",\"param\":%u,\"iterations\":%" PRIu32 ",\"cycles_mean\":%" PRIu32
+           ",\"cycles_min\":%" PRIu32 ",\"allocs\":%s}\n",
+           name, static_cast<unsigned>(param), stats.iterations,
+           static_cast<uint32_t>(stats.cycles / stats.iterations), stats.minCycles, allocs);
+}
+
+void Bench::run() {
+    static const char *quietTags[] = {"Sender", "Receiver", "Auth", "Telemetry"};
+    for (const char *tag : quietTags) {
+        esp_log_level_set(tag, ESP_LOG_ERROR);
+    }
+
+    ESP_LOGI(TAG, "Running %d iterations per case", BENCH_ITERATIONS);
+    printf("BENCH:START\n");
+    benchCrc();
+    benchPrepare();
+    benchParse();
+    benchDispatch();
+    benchQueueHandoff();
+    benchHandoffThroughput();
+    benchSenderLookup();
+    benchReceiverLookup();
+    benchSendContention();
+    printf("BENCH:END\n");
+}
+
+void Bench::benchCrc() {
+    static uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    for (size_t i = 0; i < sizeof(frame); i++) {
+        frame[i] = static_cast<uint8_t>(i);
+    }
+    for (size_t size : frameSizes) {
+        BenchStats stats;
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            measure(stats, [&] { computeMessageCrc(frame, size); });
+        }
+        report("crc16", size, stats);
+    }
+}
+
+void Bench::benchPrepare() {
+    static SendParams params;
+    uint8_t payload[200];
+    std::memset(payload, 'a', sizeof(payload));
+    for (size_t size : payloadSizes) {
+        BenchStats stats;
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            measure(stats, [&] { Sender::prepareSendParams(params, payload, size, PayloadType::ChangePattern); });
+        }
+        report("prepare_send", size, stats);
+    }
+}
+
+// What recvLoop does per frame before dispatch: validate it where it lies. Every
+// iteration parses a freshly built frame so the sequence and replay checks pass.
+void Bench::benchParse() {
+    static SendParams params;
+    uint8_t payload[200];
+    std::memset(payload, 'a', sizeof(payload));
+    for (size_t size : payloadSizes) {
+        Receiver::resetSequenceTracking(benchMac);
+        BenchStats stats;
+        int failures = 0;
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            Sender::prepareSendParams(params, payload, size, PayloadType::ChangePattern);
+            measure(stats, [&] {
+                if (Receiver::parseESPNOWData(params.raw_data, params.data_len, benchMac) < 0) {
+                    failures++;
+                }
+            });
+        }
+        if (failures > 0) {
+            ESP_LOGW(TAG, "parse: %d of %d frames rejected at payload size %u", failures, BENCH_ITERATIONS,
+                     static_cast<unsigned>(size));
+        }
+        report("parse", size, stats);
+    }
+}
+
+static volatile size_t dispatchedBytes = 0;
+
+static void onBenchPattern(std::string_view name, const ReceivedFrame &frame) {
+    dispatchedBytes = dispatchedBytes + name.size();
+}
+
+// What recvLoop does with a frame once it parses: the subscription table lookup and
+// the handler call, with the payload viewed where it lies. The frame is built once and
+// dispatched again every iteration, as dispatch does not check it.
+void Bench::benchDispatch() {
+    static SendParams params;
+    static MessageEnvelope envelope;
+    uint8_t payload[200];
+    std::memset(payload, 'a', sizeof(payload));
+    Receiver::subscribe<PayloadType::ChangePattern>(onBenchPattern);
+    for (size_t size : payloadSizes) {
+        Sender::prepareSendParams(params, payload, size, PayloadType::ChangePattern);
+        std::memcpy(envelope.src_mac, benchMac, ESP_NOW_ETH_ALEN);
+        std::memcpy(envelope.data, params.raw_data, params.data_len);
+        envelope.data_len = params.data_len;
+        BenchStats stats;
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            measure(stats, [&] { Receiver::dispatch(envelope, PayloadType::ChangePattern); });
+        }
+        report("dispatch", size, stats);
+    }
+    Receiver::unsubscribe(PayloadType::ChangePattern);
+}
+
+typedef SpscRing<MessageEnvelope, RECV_RING_SLOTS> BenchRing;
+
+// recvCallback's copy of a frame and its handoff to the consumer, without the context
+// switch: the previous path, a heap copy through a FreeRTOS queue of pointers, against
+// the ring slots RecvHandoff fills in place
+void Bench::benchQueueHandoff() {
+    QueueHandle_t queue = xQueueCreate(ESPNOW_QUEUE_SIZE, sizeof(uint8_t *));
+    static BenchRing ring;
+    if (!queue) {
+        ESP_LOGE(TAG, "Failed to create benchmark queue");
+        return;
+    }
+    static uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    for (size_t size : frameSizes) {
+        BenchStats queueStats;
+        BenchStats ringStats;
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            measure(queueStats, [&] {
+                uint8_t *copy = new uint8_t[size];
+                std::memcpy(copy, frame, size);
+                xQueueSend(queue, &copy, 0);
+                uint8_t *received = nullptr;
+                xQueueReceive(queue, &received, 0);
+                delete[] received;
+            });
+            measure(ringStats, [&] {
+                MessageEnvelope *slot = ring.beginWrite();
+                std::memcpy(slot->data, frame, size);
+                slot->data_len = size;
+                ring.commitWrite();
+                ring.beginRead();
+                ring.endRead();
+            });
+        }
+        report("queue_handoff", size, queueStats);
+        report("ring_handoff", size, ringStats);
+    }
+    vQueueDelete(queue);
+}
+
+struct HandoffRun {
+    QueueHandle_t queue;     // Queue run, or nullptr for the ring
+    BenchRing *ring;
+    TaskHandle_t consumer;
+    int frames;
+    SemaphoreHandle_t done;
+};
+
+// Stands in for the Wi-Fi task, handing off full-size frames as fast as the consumer
+// takes them. A full queue or ring yields rather than drops, so every frame counts.
+void Bench::handoffProducer(void *pvParameter) {
+    auto *run = static_cast<HandoffRun *>(pvParameter);
+    static uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    for (int i = 0; i < run->frames; i++) {
+        if (run->queue) {
+            uint8_t *copy = new uint8_t[sizeof(frame)];
+            std::memcpy(copy, frame, sizeof(frame));
+            while (xQueueSend(run->queue, &copy, 0) != pdTRUE) {
+                taskYIELD();
+            }
+        } else {
+            MessageEnvelope *slot;
+            while (!(slot = run->ring->beginWrite())) {
+                taskYIELD();
+            }
+            std::memcpy(slot->data, frame, sizeof(frame));
+            slot->data_len = sizeof(frame);
+            if (run->ring->commitWrite()) {
+                xTaskNotify(run->consumer, 1, eSetBits);
+            }
+        }
+    }
+    xSemaphoreGive(run->done);
+    vTaskDelete(nullptr);
+}
+
+// Frames per second through each handoff between two tasks at our priority, wakeups
+// included. Reported as wall-clock cycles per frame.
+void Bench::benchHandoffThroughput() {
+    QueueHandle_t queue = xQueueCreate(ESPNOW_QUEUE_SIZE, sizeof(uint8_t *));
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    static BenchRing ring;
+    if (!queue || !done) {
+        ESP_LOGE(TAG, "Failed to create handoff benchmark queue");
+        return;
+    }
+    for (int useRing = 0; useRing < 2; useRing++) {
+        HandoffRun run = {useRing ? nullptr : queue, &ring, xTaskGetCurrentTaskHandle(), BENCH_ITERATIONS, done};
+        xTaskNotifyStateClear(nullptr);
+        uint32_t start = esp_cpu_get_cycle_count();
+        if (xTaskCreate(handoffProducer, "benchHandoff", 2048, &run, uxTaskPriorityGet(nullptr), nullptr) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create handoff producer");
+            break;
+        }
+        for (int received = 0; received < run.frames;) {
+            if (!useRing) {
+                uint8_t *copy;
+                xQueueReceive(queue, &copy, portMAX_DELAY);
+                delete[] copy;
+                received++;
+            } else if (ring.beginRead()) {
+                ring.endRead();
+                received++;
+            } else {
+                xTaskNotifyWait(0, UINT32_MAX, nullptr, portMAX_DELAY);
+            }
+        }
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        xSemaphoreTake(done, portMAX_DELAY);
+
+        BenchStats stats;
+        stats.iterations = run.frames;
+        stats.cycles = cycles;
+        stats.minCycles = cycles / run.frames;
+        report(useRing ? "ring_throughput" : "queue_throughput", ESP_NOW_MAX_DATA_LEN, stats);
+    }
+    vSemaphoreDelete(done);
+    vQueueDelete(queue);
+}
+
+static void peerMac(size_t index, uint8_t *mac) {
+    std::memcpy(mac, benchMac, ESP_NOW_ETH_ALEN);
+    mac[4] = static_cast<uint8_t>(index >> 8);
+    mac[5] = static_cast<uint8_t>(index);
+}
+
+// Peer counts only grow, since the registry never forgets a peer
+void Bench::benchSenderLookup() {
+    for (size_t peers : peerCounts) {
+        for (size_t i = PeerRegistry::size(); i < peers; i++) {
+            uint8_t mac[ESP_NOW_ETH_ALEN];
+            peerMac(i, mac);
+            bool created;
+            PeerRegistry::add(mac, created);
+        }
+
+        BenchStats findStats;
+        BenchStats seqStats;
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            uint8_t mac[ESP_NOW_ETH_ALEN];
+            peerMac(esp_random() % peers, mac);
+            PeerEntry *peer = nullptr;
+            measure(findStats, [&] { peer = PeerRegistry::find(mac); });
+            if (peer) {
+                FrameTarget target = FrameTarget::toNode(peer->node_id);
+                measure(seqStats, [&] { Sender::getNextSequenceNumber(target); });
+            }
+        }
+        report("sender_peer_find", peers, findStats);
+        report("sender_next_seq", peers, seqStats);
+    }
+}
+
+void Bench::benchReceiverLookup() {
+    for (size_t peers : peerCounts) {
+        Receiver::peerLastSequenceNumbers.clear();
+        for (size_t i = 0; i < peers; i++) {
+            uint8_t mac[ESP_NOW_ETH_ALEN];
+            peerMac(i, mac);
+            Receiver::peerLastSequenceNumbers[std::string(reinterpret_cast<const char *>(mac), ESP_NOW_ETH_ALEN)] = 1;
+        }
+
+        // Same key construction and lookup as the sequence check in parseESPNOWData
+        BenchStats stats;
+        volatile uint16_t sink = 0;
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            uint8_t mac[ESP_NOW_ETH_ALEN];
+            peerMac(esp_random() % peers, mac);
+            measure(stats, [&] {
+                std::string peerKey(reinterpret_cast<const char *>(mac), ESP_NOW_ETH_ALEN);
+                sink = Receiver::peerLastSequenceNumbers[peerKey];
+            });
+        }
+        report("receiver_seq_lookup", peers, stats);
+    }
+    Receiver::peerLastSequenceNumbers.clear();
+}
+
+struct ContentionRun {
+    int frames; // Per producer
+    SemaphoreHandle_t done;
+};
+
+void Bench::contentionProducer(void *pvParameter) {
+    auto *run = static_cast<ContentionRun *>(pvParameter);
+    SendOptions options;
+    options.overflow = OverflowPolicy::Wait;
+    options.wait_ticks = portMAX_DELAY;
+    for (int i = 0; i < run->frames; i++) {
+        Sender::send(FrameTarget::all(), ChangeBrightnessPayload{static_cast<uint8_t>(i)}, options);
+    }
+    xSemaphoreGive(run->done);
+    vTaskDelete(nullptr);
+}
+
+// Producer tasks at our priority call Sender::send as fast as they can while this
+// task stands in for the reactor, taking and releasing slots without transmitting.
+// Reports wall-clock cycles per frame through the slot queues, so the mean is the
+// API's throughput under contention; min holds the same figure.
+void Bench::benchSendContention() {
+    if (Sender::initSendSlots() != ESP_OK) {
+        return;
+    }
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(8, 0);
+    if (!done) {
+        ESP_LOGE(TAG, "Failed to create benchmark semaphore");
+        return;
+    }
+    UBaseType_t priority = uxTaskPriorityGet(nullptr);
+    for (size_t producers : producerCounts) {
+        ContentionRun run = {static_cast<int>(BENCH_ITERATIONS / producers), done};
+        int total = run.frames * static_cast<int>(producers);
+        uint32_t start = esp_cpu_get_cycle_count();
+        size_t started = 0;
+        for (; started < producers; started++) {
+            if (xTaskCreate(contentionProducer, "benchProducer", 2048, &run, priority, nullptr) != pdPASS) {
+                break;
+            }
+        }
+        if (started < producers) {
+            ESP_LOGE(TAG, "Failed to create producer tasks");
+            total = run.frames * static_cast<int>(started);
+        }
+        for (int i = 0; i < total; i++) {
+            uint8_t index;
+            Sender::takeCommittedSlot(index, portMAX_DELAY);
+            Sender::releaseSlot(index);
+        }
+        uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        for (size_t i = 0; i < started; i++) {
+            xSemaphoreTake(done, portMAX_DELAY);
+        }
+        if (total == 0) {
+            continue;
+        }
+
+        BenchStats stats;
+        stats.iterations = total;
+        stats.cycles = cycles;
+        stats.minCycles = cycles / total;
+        report("send_contention", producers, stats);
+    }
+    vSemaphoreDelete(done);
+}
+
+#endif // ENABLE_BENCH
@@ -0,0 +1,38 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "config.h"
+
+#if ENABLE_BENCH
+
+// On-device microbenchmarks for the protocol hot paths: CRC, building, parsing and
+// dispatching frames, the receive handoff (FreeRTOS queue against SpscRing),
+// per-peer lookups and Sender::send under contention, each across frame sizes, peer
+// counts or producer counts. Every case prints one "BENCH:{...}" JSON line with mean
+// and minimum CPU cycles per operation and, when CONFIG_HEAP_USE_HOOKS is set, the
+// heap allocations it made; bench_compare.py checks a capture against a baseline.
+//
+// UART logging from the code under test is silenced, so the numbers show the
+// protocol work itself. Runs instead of the normal role and leaves the sender's
+// peer registry and sequence numbers in a state unfit for real traffic.
+class Bench {
+public:
+    static void run();
+
+private:
+    static void benchCrc();
+    static void benchPrepare();
+    static void benchParse();
+    static void benchDispatch();
+    static void benchQueueHandoff();
+    static void benchHandoffThroughput();
+    static void handoffProducer(void *pvParameter);
+    static void benchSenderLookup();
+    static void benchReceiverLookup();
+    static void benchSendContention();
+    static void contentionProducer(void *pvParameter);
+};
+
+#endif // ENABLE_BENCH
+
+#endif // BENCH_H
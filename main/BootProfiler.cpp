@@ -0,0 +1,44 @@
+#include "BootProfiler.h"
+
+#if ENABLE_BOOT_PROFILER
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <atomic>
+
+static const char *TAG = "BootProfiler";
+
+struct BootMark {
+    const char *phase;
+    int64_t time_us; // esp_timer_get_time() at the end of the phase
+};
+
+// Only written during startup, by app_main and the init helpers it waits for
+static BootMark marks[BOOT_PROFILER_MAX_MARKS];
+static size_t markCount = 0;
+static std::atomic<bool> firstCommandSeen{false};
+
+void BootProfiler::mark(const char *phase) {
+    if (markCount < BOOT_PROFILER_MAX_MARKS) {
+        marks[markCount++] = {phase, esp_timer_get_time()};
+    }
+}
+
+void BootProfiler::report() {
+    ESP_LOGI(TAG, "Startup report (%zu phases):", markCount);
+    int64_t previous = 0;
+    for (size_t i = 0; i < markCount; i++) {
+        ESP_LOGI(TAG, "  %-16s %6lu us  (at %lu us)", marks[i].phase,
+                 static_cast<unsigned long>(marks[i].time_us - previous), static_cast<unsigned long>(marks[i].time_us));
+        previous = marks[i].time_us;
+    }
+}
+
+void BootProfiler::markFirstCommand() {
+    if (firstCommandSeen.exchange(true)) {
+        return;
+    }
+    ESP_LOGI(TAG, "First command %lu us after reset", static_cast<unsigned long>(esp_timer_get_time()));
+}
+
+#endif // ENABLE_BOOT_PROFILER
@@ -0,0 +1,39 @@
+#ifndef BOOT_PROFILER_H
+#define BOOT_PROFILER_H
+
+#include <cstdint>
+#include "config.h"
+
+#define BOOT_PROFILER_MAX_MARKS 16
+
+#if ENABLE_BOOT_PROFILER
+
+// Records how long each startup phase takes. Timestamps come from esp_timer, which
+// starts shortly after reset, so the first mark already includes the bootloader
+// and the ROM/IDF startup code that run before app_main.
+class BootProfiler {
+public:
+    // Record the end of `phase`. `phase` must be a string literal.
+    static void mark(const char *phase);
+
+    // Log every phase with its duration and the time since reset
+    static void report();
+
+    // Receiver: the first command after boot, the number we are optimising for.
+    // Only the first call does anything.
+    static void markFirstCommand();
+};
+
+#else
+
+// Profiler compiled out: every call is an empty inline
+class BootProfiler {
+public:
+    static void mark(const char *) {}
+    static void report() {}
+    static void markFirstCommand() {}
+};
+
+#endif // ENABLE_BOOT_PROFILER
+
+#endif // BOOT_PROFILER_H
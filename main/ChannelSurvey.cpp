@@ -0,0 +1,85 @@
+#include "ChannelSurvey.h"
+
+#if ENABLE_CHANNEL_AGILITY
+
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include <atomic>
+#include <cstring>
+
+static const char *TAG = "ChannelSurvey";
+
+// Written by the promiscuous callback on the Wi-Fi task
+static std::atomic<uint8_t> surveyChannel{0}; // 0 while no channel is being measured
+static std::atomic<uint32_t> busy[ESPNOW_CHANNEL_MAX + 1];
+
+// Share of a Wi-Fi transmission's energy that lands 0-3 channels away: channels are
+// 5 MHz apart and a transmission is about 20 MHz wide
+static const uint8_t spillPercent[] = {100, 75, 40, 10};
+
+static void promiscuousCallback(void *buf, wifi_promiscuous_pkt_type_t type) {
+    uint8_t channel = surveyChannel.load(std::memory_order_relaxed);
+    if (channel == 0) {
+        return;
+    }
+    const auto *packet = static_cast<const wifi_promiscuous_pkt_t *>(buf);
+    busy[channel].fetch_add(packet->rx_ctrl.sig_len, std::memory_order_relaxed);
+}
+
+void ChannelSurvey::begin() {
+    for (auto &bytes : busy) {
+        bytes.store(0, std::memory_order_relaxed);
+    }
+    esp_wifi_set_promiscuous_rx_cb(promiscuousCallback);
+    wifi_promiscuous_filter_t filter = {WIFI_PROMIS_FILTER_MASK_ALL};
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous(true);
+}
+
+void ChannelSurvey::measure(uint8_t channel) {
+    surveyChannel.store(0, std::memory_order_relaxed);
+    esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    surveyChannel.store(channel, std::memory_order_relaxed);
+}
+
+void ChannelSurvey::end(uint8_t home_channel) {
+    surveyChannel.store(0, std::memory_order_relaxed);
+    esp_wifi_set_promiscuous(false);
+    esp_wifi_set_channel(home_channel, WIFI_SECOND_CHAN_NONE);
+
+    for (uint8_t channel = ESPNOW_CHANNEL_MIN; channel <= ESPNOW_CHANNEL_MAX; channel++) {
+        ESP_LOGI(TAG, "Channel %2u: %lu bytes in %d ms, score %lu%s", channel,
+                 static_cast<unsigned long>(busyBytes(channel)), CHANNEL_SURVEY_DWELL_MS,
+                 static_cast<unsigned long>(score(channel)), channel == home_channel ? " (current)" : "");
+    }
+}
+
+uint32_t ChannelSurvey::busyBytes(uint8_t channel) {
+    return channel <= ESPNOW_CHANNEL_MAX ? busy[channel].load(std::memory_order_relaxed) : UINT32_MAX;
+}
+
+uint32_t ChannelSurvey::score(uint8_t channel) {
+    uint64_t total = 0;
+    for (int offset = -3; offset <= 3; offset++) {
+        int neighbour = channel + offset;
+        if (neighbour >= ESPNOW_CHANNEL_MIN && neighbour <= ESPNOW_CHANNEL_MAX) {
+            total += static_cast<uint64_t>(busyBytes(neighbour)) * spillPercent[offset < 0 ? -offset : offset] / 100;
+        }
+    }
+    return total < UINT32_MAX ? static_cast<uint32_t>(total) : UINT32_MAX;
+}
+
+uint8_t ChannelSurvey::best(uint8_t current) {
+    uint8_t quietest = current;
+    for (uint8_t channel = ESPNOW_CHANNEL_MIN; channel <= ESPNOW_CHANNEL_MAX; channel++) {
+        if (score(channel) < score(quietest)) {
+            quietest = channel;
+        }
+    }
+
+    // Moving the fleet costs a few seconds of traffic, so only move for a clear win
+    uint64_t threshold = static_cast<uint64_t>(score(current)) * CHANNEL_SWITCH_HYSTERESIS_PERCENT / 100;
+    return score(quietest) < threshold ? quietest : current;
+}
+
+#endif // ENABLE_CHANNEL_AGILITY
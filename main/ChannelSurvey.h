@@ -0,0 +1,35 @@
+#ifndef CHANNEL_SURVEY_H
+#define CHANNEL_SURVEY_H
+
+#include <cstdint>
+#include "Manager.h"
+#include "config.h"
+
+#if ENABLE_CHANNEL_AGILITY
+
+// Measures how busy each 2.4 GHz channel is by listening in promiscuous mode for
+// CHANNEL_SURVEY_DWELL_MS per channel and counting the bytes of every frame heard
+// while we are silent. The radio is off our channel while a survey runs, so the
+// caller must not transmit until end() returns.
+class ChannelSurvey {
+public:
+    static void begin();
+    static void measure(uint8_t channel); // Hop to `channel` and count until the next call
+    static void end(uint8_t home_channel);
+
+    // Bytes heard on `channel` during the last survey
+    static uint32_t busyBytes(uint8_t channel);
+
+    // How much traffic reaches `channel`: its own busy bytes plus those of the three
+    // channels either side, weighted by how far their transmissions spill over. Frames
+    // from a neighbour mostly cannot be decoded here, so busyBytes alone misses them,
+    // yet they still cost us frames.
+    static uint32_t score(uint8_t channel);
+
+    // Lowest-scoring channel, or `current` unless another is quieter by the hysteresis margin
+    static uint8_t best(uint8_t current);
+};
+
+#endif // ENABLE_CHANNEL_AGILITY
+
+#endif // CHANNEL_SURVEY_H
@@ -0,0 +1,129 @@
+#include "DeferredLog.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <cstdio>
+#include <cstddef>
+
+static_assert((DLOG_RING_SIZE & (DLOG_RING_SIZE - 1)) == 0, "DLOG_RING_SIZE must be a power of two");
+
+static const char *TAG = "DeferredLog";
+
+struct FormatEntry {
+    const char *tag;
+    const char *format;
+};
+
+static const FormatEntry formats[DLOG_FORMAT_COUNT] = {
+#define DLOG_TABLE_ENTRY(id, tag, format) {tag, format},
+    DLOG_FORMATS(DLOG_TABLE_ENTRY)
+#undef DLOG_TABLE_ENTRY
+};
+
+// Bounded multi-producer ring (Vyukov). Each slot's sequence number says whether it
+// is free for the producer at position `seq` or holds a record for the consumer at
+// `seq - 1`, so producers never take a lock and never wait on the consumer.
+struct Slot {
+    std::atomic<uint32_t> seq;
+    DlogRecord record;
+};
+
+static Slot ring[DLOG_RING_SIZE];
+static std::atomic<uint32_t> head{0}; // Next position to claim, shared by producers
+static std::atomic<uint32_t> tail{0}; // Next position to drain, only advanced by the drain task
+static std::atomic<uint32_t> dropped{0};
+static TaskHandle_t drainTask = nullptr;
+
+void DeferredLog::init() {
+    for (uint32_t i = 0; i < DLOG_RING_SIZE; i++) {
+        ring[i].seq.store(i, std::memory_order_relaxed);
+    }
+    xTaskCreate(drainLoop, "dlogDrain", 3072, nullptr, 1, &drainTask);
+}
+
+void DeferredLog::writeRecord(esp_log_level_t level, DlogFormat format, const uint32_t *args, uint8_t argc) {
+    uint32_t pos = head.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+        slot = &ring[pos & (DLOG_RING_SIZE - 1)];
+        int32_t diff = static_cast<int32_t>(slot->seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full: losing a log line is better than stalling the radio
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+
+    DlogRecord &record = slot->record;
+    record.timestamp_us = static_cast<uint32_t>(esp_timer_get_time());
+    record.format_id = format;
+    record.level = level;
+    record.argc = argc;
+    for (uint8_t i = 0; i < argc; i++) {
+        record.args[i] = args[i];
+    }
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+    // Only wake the drain task early when the ring is getting full
+    if (pos - tail.load(std::memory_order_relaxed) == DLOG_RING_SIZE * 3 / 4 && drainTask) {
+        xTaskNotifyGive(drainTask);
+    }
+}
+
+void DeferredLog::drainLoop(void *pvParameter) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DLOG_DRAIN_INTERVAL_MS));
+
+        uint32_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot &slot = ring[pos & (DLOG_RING_SIZE - 1)];
+            if (slot.seq.load(std::memory_order_acquire) != pos + 1) {
+                break;
+            }
+            DlogRecord record = slot.record;
+            slot.seq.store(pos + DLOG_RING_SIZE, std::memory_order_release);
+            tail.store(++pos, std::memory_order_relaxed);
+            emit(record);
+        }
+
+        uint32_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0) {
+            ESP_LOGW(TAG, "Dropped %lu log records, ring full", static_cast<unsigned long>(lost));
+        }
+    }
+}
+
+void DeferredLog::emit(const DlogRecord &record) {
+    if (record.format_id >= DLOG_FORMAT_COUNT) {
+        ESP_LOGE(TAG, "Unknown log format id %u", record.format_id);
+        return;
+    }
+
+#if DLOG_TEXT_OUTPUT
+    static const char levelChars[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+    const FormatEntry &entry = formats[record.format_id];
+    const uint32_t *a = record.args;
+    char message[160];
+    snprintf(message, sizeof(message), entry.format, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+    esp_log_write(static_cast<esp_log_level_t>(record.level), entry.tag, "%c (%lu) %s: %s\n",
+                  levelChars[record.level < sizeof(levelChars) ? record.level : 0],
+                  static_cast<unsigned long>(record.timestamp_us / 1000), entry.tag, message);
+#else
+    // Header then only the arguments actually used, all little-endian hex
+    char line[8 + 2 * (8 + DLOG_MAX_ARGS * 4) + 1];
+    int n = snprintf(line, sizeof(line), "DLOG:");
+    const uint8_t *header = reinterpret_cast<const uint8_t *>(&record);
+    size_t len = offsetof(DlogRecord, args) + record.argc * sizeof(uint32_t);
+    for (size_t i = 0; i < len; i++) {
+        n += snprintf(line + n, sizeof(line) - n, "%02x", header[i]);
+    }
+    printf("%s\n", line);
+#endif
+}
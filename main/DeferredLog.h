@@ -0,0 +1,64 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "LogFormats.h"
+#include "config.h"
+
+#define DLOG_MAX_ARGS 8
+
+enum DlogFormat : uint16_t {
+#define DLOG_ENUM_ENTRY(id, tag, format) id,
+    DLOG_FORMATS(DLOG_ENUM_ENTRY)
+#undef DLOG_ENUM_ENTRY
+    DLOG_FORMAT_COUNT,
+};
+
+// One deferred log line: which format to use and the raw arguments for it
+struct DlogRecord {
+    uint32_t timestamp_us; // Low 32 bits of esp_timer_get_time()
+    uint16_t format_id;
+    uint8_t level;         // esp_log_level_t
+    uint8_t argc;
+    uint32_t args[DLOG_MAX_ARGS];
+};
+
+// Deferred binary logger for contexts that must not block on UART formatting, such
+// as ESP-NOW callbacks running on the Wi-Fi task. Producers copy a format id and
+// integer arguments into a lock-free multi-producer ring; a low-priority task
+// drains it and either formats the records on-device or, with DLOG_TEXT_OUTPUT
+// off, prints them as hex for decode_dlog.py to turn back into text.
+class DeferredLog {
+public:
+    static void init();
+
+    template <typename... Args>
+    static void write(esp_log_level_t level, DlogFormat format, Args... args) {
+        static_assert(sizeof...(Args) <= DLOG_MAX_ARGS, "Too many deferred log arguments");
+        const uint32_t packed[] = {static_cast<uint32_t>(args)..., 0};
+        writeRecord(level, format, packed, sizeof...(Args));
+    }
+
+private:
+    static void writeRecord(esp_log_level_t level, DlogFormat format, const uint32_t *args, uint8_t argc);
+    static void drainLoop(void *pvParameter);
+    static void emit(const DlogRecord &record);
+};
+
+// Records below DLOG_LEVEL are discarded at compile time
+#define DLOG(level, format, ...) \
+    do { \
+        if ((level) <= DLOG_LEVEL) { \
+            DeferredLog::write((level), (format), ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define DLOGE(format, ...) DLOG(ESP_LOG_ERROR, format, ##__VA_ARGS__)
+#define DLOGW(format, ...) DLOG(ESP_LOG_WARN, format, ##__VA_ARGS__)
+#define DLOGI(format, ...) DLOG(ESP_LOG_INFO, format, ##__VA_ARGS__)
+#define DLOGD(format, ...) DLOG(ESP_LOG_DEBUG, format, ##__VA_ARGS__)
+
+#endif // DEFERRED_LOG_H
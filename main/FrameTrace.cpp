@@ -0,0 +1,265 @@
+#include "FrameTrace.h"
+
+#if ENABLE_FRAME_TRACE
+
+#include "Manager.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+static_assert((FRAME_TRACE_RING_BYTES & (FRAME_TRACE_RING_BYTES - 1)) == 0, "FRAME_TRACE_RING_BYTES must be a power of two");
+
+static const char *TAG = "FrameTrace";
+
+// Records are stored back to back and may wrap around the end of the ring
+static uint8_t ring[FRAME_TRACE_RING_BYTES];
+static uint32_t head = 0; // Where the next record goes, free-running
+static uint32_t tail = 0; // Oldest record, free-running
+static portMUX_TYPE traceLock = portMUX_INITIALIZER_UNLOCKED;
+static std::atomic<bool> paused{false};
+static esp_now_recv_cb_t target = nullptr;
+
+// Scratch space for one record, used by the console task only
+static uint8_t scratch[sizeof(FrameTraceRecord) + ESP_NOW_MAX_DATA_LEN_V2];
+
+static void ringWrite(uint32_t pos, const void *src, size_t len) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(src);
+    size_t offset = pos & (FRAME_TRACE_RING_BYTES - 1);
+    size_t first = len < FRAME_TRACE_RING_BYTES - offset ? len : FRAME_TRACE_RING_BYTES - offset;
+    std::memcpy(ring + offset, bytes, first);
+    std::memcpy(ring, bytes + first, len - first);
+}
+
+static void ringRead(uint32_t pos, void *dst, size_t len) {
+    uint8_t *bytes = static_cast<uint8_t *>(dst);
+    size_t offset = pos & (FRAME_TRACE_RING_BYTES - 1);
+    size_t first = len < FRAME_TRACE_RING_BYTES - offset ? len : FRAME_TRACE_RING_BYTES - offset;
+    std::memcpy(bytes, ring + offset, first);
+    std::memcpy(bytes + first, ring, len - first);
+}
+
+// Call with traceLock held. Evicts the oldest records until the new one fits.
+static void append(const FrameTraceRecord &header, const uint8_t *data) {
+    size_t need = sizeof(header) + header.len;
+    while (head - tail + need > FRAME_TRACE_RING_BYTES) {
+        FrameTraceRecord oldest;
+        ringRead(tail, &oldest, sizeof(oldest));
+        tail += sizeof(oldest) + oldest.len;
+    }
+    ringWrite(head, &header, sizeof(header));
+    ringWrite(head + sizeof(header), data, header.len);
+    head += need;
+}
+
+// Once this returns, no record() call is still writing and new ones are ignored
+static void pauseRecording() {
+    paused = true;
+    taskENTER_CRITICAL(&traceLock);
+    taskEXIT_CRITICAL(&traceLock);
+}
+
+void FrameTrace::init(esp_now_recv_cb_t replayTarget) {
+    target = replayTarget;
+    if (xTaskCreate(consoleTask, "frameTrace", 4096, nullptr, 1, nullptr) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create frame trace console task");
+        return;
+    }
+    ESP_LOGI(TAG, "Recording frames into a %d-byte ring; send \"trace dump\" to print it", FRAME_TRACE_RING_BYTES);
+}
+
+void FrameTrace::record(uint8_t flags, const uint8_t *peer, int8_t rssi, const uint8_t *data, size_t len) {
+    if (paused || len > ESP_NOW_MAX_DATA_LEN_V2) {
+        return;
+    }
+
+    FrameTraceRecord header;
+    header.timestamp_us = static_cast<uint32_t>(esp_timer_get_time());
+    std::memcpy(header.peer, peer, ESP_NOW_ETH_ALEN);
+    header.rssi = rssi;
+    header.flags = flags;
+    header.len = static_cast<uint16_t>(len);
+
+    taskENTER_CRITICAL(&traceLock);
+    append(header, data);
+    taskEXIT_CRITICAL(&traceLock);
+}
+
+// Polls stdin, which the default console driver does not block on
+void FrameTrace::consoleTask(void *pvParameter) {
+    static char line[sizeof("trace load ") + 2 * sizeof(scratch)];
+    size_t len = 0;
+    while (true) {
+        int c = fgetc(stdin);
+        if (c == EOF) {
+            clearerr(stdin);
+            vTaskDelay(pdMS_TO_TICKS(FRAME_TRACE_CONSOLE_POLL_MS));
+            continue;
+        }
+        if (c == '\n' || c == '\r') {
+            line[len] = '\0';
+            if (len > 0) {
+                handleCommand(line);
+            }
+            len = 0;
+        } else if (len < sizeof(line) - 1) {
+            line[len++] = static_cast<char>(c);
+        }
+    }
+}
+
+void FrameTrace::handleCommand(char *line) {
+    if (std::strncmp(line, "trace ", 6) != 0) {
+        return; // Not for us
+    }
+    const char *command = line + 6;
+
+    if (std::strcmp(command, "dump") == 0) {
+        dump();
+    } else if (std::strcmp(command, "clear") == 0) {
+        taskENTER_CRITICAL(&traceLock);
+        head = tail = 0;
+        taskEXIT_CRITICAL(&traceLock);
+        paused = false;
+        printf("FTRACE:CLEARED\n");
+    } else if (std::strncmp(command, "load ", 5) == 0) {
+        // Loaded records must not be interleaved with live ones
+        pauseRecording();
+        if (!load(command + 5)) {
+            ESP_LOGE(TAG, "Malformed record in trace load");
+        }
+    } else if (std::strcmp(command, "replay") == 0 || std::strcmp(command, "replay fast") == 0) {
+        replay(command[6] != '\0');
+    } else {
+        ESP_LOGW(TAG, "Unknown command: %s", command);
+    }
+}
+
+void FrameTrace::dump() {
+    bool wasPaused = paused;
+    pauseRecording();
+
+    uint32_t records = 0;
+    for (uint32_t pos = tail; pos != head; records++) {
+        FrameTraceRecord header;
+        ringRead(pos, &header, sizeof(header));
+        size_t len = sizeof(header) + header.len;
+        ringRead(pos, scratch, len);
+        pos += len;
+
+        printf("FTRACE:");
+        for (size_t i = 0; i < len; i++) {
+            printf("%02x", scratch[i]);
+        }
+        printf("\n");
+    }
+    printf("FTRACE:END records=%" PRIu32 "\n", records);
+
+    paused = wasPaused;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool FrameTrace::load(const char *hex) {
+    size_t len = 0;
+    while (hex[0] && hex[1] && len < sizeof(scratch)) {
+        int high = hexDigit(hex[0]);
+        int low = hexDigit(hex[1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        scratch[len++] = static_cast<uint8_t>(high << 4 | low);
+        hex += 2;
+    }
+
+    FrameTraceRecord header;
+    if (hex[0] || len < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, scratch, sizeof(header));
+    if (len != sizeof(header) + header.len) {
+        return false;
+    }
+
+    taskENTER_CRITICAL(&traceLock);
+    append(header, scratch + sizeof(header));
+    taskEXIT_CRITICAL(&traceLock);
+    return true;
+}
+
+// Runs the received frames through the real receive path: callback, handoff ring,
+// parser and dispatch. The callback never blocks, so in fast mode frames the consumer
+// cannot keep up with are dropped and counted, as they would be off the air.
+void FrameTrace::replay(bool fast) {
+    if (!target) {
+        return;
+    }
+    pauseRecording();
+
+    uint8_t ownMac[ESP_NOW_ETH_ALEN];
+    uint8_t broadcast[ESP_NOW_ETH_ALEN];
+    esp_wifi_get_mac(static_cast<wifi_interface_t>(ESPNOW_WIFI_IF), ownMac);
+    std::memset(broadcast, 0xFF, sizeof(broadcast));
+
+    uint32_t frames = 0;
+    uint32_t bytes = 0;
+    uint32_t firstTimestamp = 0;
+    int64_t start = esp_timer_get_time();
+    for (uint32_t pos = tail; pos != head;) {
+        FrameTraceRecord header;
+        ringRead(pos, &header, sizeof(header));
+        ringRead(pos + sizeof(header), scratch, header.len);
+        pos += sizeof(header) + header.len;
+        if (!(header.flags & FRAME_TRACE_RX)) {
+            continue;
+        }
+
+        if (!fast) {
+            // Original spacing, to the nearest tick
+            if (frames == 0) {
+                firstTimestamp = header.timestamp_us;
+            }
+            int64_t due = start + static_cast<uint32_t>(header.timestamp_us - firstTimestamp);
+            int64_t left = due - esp_timer_get_time();
+            if (left > 0) {
+                vTaskDelay(pdMS_TO_TICKS(left / 1000) > 0 ? pdMS_TO_TICKS(left / 1000) : 1);
+            }
+        }
+
+        wifi_pkt_rx_ctrl_t rxCtrl = {};
+        rxCtrl.rssi = header.rssi;
+        esp_now_recv_info_t info = {};
+        info.src_addr = header.peer;
+        info.des_addr = (header.flags & FRAME_TRACE_BROADCAST) ? broadcast : ownMac;
+        info.rx_ctrl = &rxCtrl;
+        target(&info, scratch, header.len);
+        frames++;
+        bytes += header.len;
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    printf("FTRACE:REPLAYED frames=%" PRIu32 " bytes=%" PRIu32 " us=%" PRId64 "\n", frames, bytes, elapsed);
+    if (elapsed > 0) {
+        ESP_LOGI(TAG, "Replayed %" PRIu32 " frames in %" PRId64 " us (%" PRId64 " frames/s)",
+                 frames, elapsed, static_cast<int64_t>(frames) * 1000000 / elapsed);
+    }
+    paused = false;
+}
+
+#endif // ENABLE_FRAME_TRACE
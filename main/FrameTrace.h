@@ -0,0 +1,54 @@
+#ifndef FRAME_TRACE_H
+#define FRAME_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_now.h"
+#include "config.h"
+
+#if ENABLE_FRAME_TRACE
+
+#define FRAME_TRACE_RX 0x01        // Heard by this board
+#define FRAME_TRACE_TX 0x02        // Sent by this board
+#define FRAME_TRACE_BROADCAST 0x04 // Addressed to the broadcast MAC
+
+// Header of one recorded frame; the raw frame bytes follow it
+struct FrameTraceRecord {
+    uint32_t timestamp_us;        // Low 32 bits of esp_timer_get_time()
+    uint8_t peer[ESP_NOW_ETH_ALEN]; // Source for received frames, destination for sent ones
+    int8_t rssi;
+    uint8_t flags;                // FRAME_TRACE_* bits
+    uint16_t len;
+} __attribute__((packed));
+
+// Flight recorder for raw ESP-NOW frames. Frames go into a byte ring that drops the
+// oldest records when full, so the last FRAME_TRACE_RING_BYTES of traffic are
+// always available after a field failure. Driven by lines on the serial console:
+//
+//   trace dump           print every record as "FTRACE:<hex>", then "FTRACE:END"
+//   trace clear          empty the ring
+//   trace load <hex>     append a record in dump format (frame_trace.py uploads captures this way)
+//   trace replay [fast]  feed the received frames back through the receive callback,
+//                        with their original spacing or back to back, and log the rate
+//
+// Recording stops at the first "trace load" and resumes once a replay finishes or
+// the ring is cleared.
+class FrameTrace {
+public:
+    // `replayTarget` is the role's ESP-NOW receive callback
+    static void init(esp_now_recv_cb_t replayTarget);
+
+    // Safe on the Wi-Fi task
+    static void record(uint8_t flags, const uint8_t *peer, int8_t rssi, const uint8_t *data, size_t len);
+
+private:
+    static void consoleTask(void *pvParameter);
+    static void handleCommand(char *line);
+    static void dump();
+    static bool load(const char *hex);
+    static void replay(bool fast);
+};
+
+#endif // ENABLE_FRAME_TRACE
+
+#endif // FRAME_TRACE_H
@@ -0,0 +1,160 @@
+#include "Latency.h"
+
+#if ENABLE_LATENCY_TRACING
+
+#include "esp_log.h"
+#include "esp_mac.h"
+#include <climits>
+#include <initializer_list>
+
+static const char *TAG = "Latency";
+
+// Histograms owned by the receiver's recvLoop task
+static LatencyHistogram queueWaitHistogram; // Sender enqueue -> transmit
+static LatencyHistogram airHistogram;       // Transmit -> receive callback, relative to the fastest frame
+static LatencyHistogram dispatchHistogram;  // Receive callback -> handler
+
+// Smallest (rx - transmit) seen so far. The two clocks are not synchronized, so air
+// latency is reported relative to this floor rather than as an absolute value.
+static int32_t minClockOffset = INT32_MAX;
+
+size_t LatencyHistogram::bucketIndex(uint32_t us) {
+    if (us < (1u << SUB_BUCKET_BITS)) {
+        return us;
+    }
+    size_t msb = 31 - __builtin_clz(us);
+    if (msb >= MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    size_t sub = (us >> (msb - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1);
+    return (msb - 1) * (1 << SUB_BUCKET_BITS) + sub;
+}
+
+uint32_t LatencyHistogram::bucketLowerBound(size_t index) {
+    if (index < (1u << SUB_BUCKET_BITS)) {
+        return index;
+    }
+    if (index >= BUCKET_COUNT - 1) {
+        return 1u << MAX_EXPONENT;
+    }
+    size_t msb = index / (1 << SUB_BUCKET_BITS) + 1;
+    size_t sub = index % (1 << SUB_BUCKET_BITS);
+    return (1u << msb) + (sub << (msb - SUB_BUCKET_BITS));
+}
+
+void LatencyHistogram::record(uint32_t us) {
+    uint16_t &bucket = buckets[bucketIndex(us)];
+    if (bucket < UINT16_MAX) {
+        bucket++;
+    }
+    total++;
+}
+
+uint32_t LatencyHistogram::percentile(uint8_t pct) const {
+    uint32_t seen = 0;
+    uint32_t sum = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        sum += buckets[i];
+    }
+    uint32_t target = (sum * pct + 99) / 100;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (buckets[i] && seen >= target) {
+            return bucketLowerBound(i);
+        }
+    }
+    return 0;
+}
+
+size_t LatencyHistogram::encode(uint8_t *buf, size_t len) const {
+    size_t nonEmpty = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        nonEmpty += buckets[i] != 0;
+    }
+    size_t needed = 1 + nonEmpty * 3;
+    if (len < needed) {
+        return 0;
+    }
+
+    uint8_t *p = buf;
+    *p++ = static_cast<uint8_t>(nonEmpty);
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        if (buckets[i]) {
+            *p++ = static_cast<uint8_t>(i);
+            *p++ = buckets[i] & 0xFF;
+            *p++ = buckets[i] >> 8;
+        }
+    }
+    return needed;
+}
+
+size_t LatencyHistogram::decode(const uint8_t *buf, size_t len) {
+    if (len < 1) {
+        return 0;
+    }
+    size_t nonEmpty = buf[0];
+    size_t needed = 1 + nonEmpty * 3;
+    if (len < needed) {
+        return 0;
+    }
+
+    *this = {};
+    const uint8_t *p = buf + 1;
+    for (size_t i = 0; i < nonEmpty; i++, p += 3) {
+        if (p[0] >= BUCKET_COUNT) {
+            return 0;
+        }
+        buckets[p[0]] = p[1] | (p[2] << 8);
+        total += buckets[p[0]];
+    }
+    return needed;
+}
+
+void LatencyTracer::recordFrame(const TraceExtension &trace, uint32_t rx_us, uint32_t dispatch_us) {
+    queueWaitHistogram.record(trace.transmit_us - trace.enqueue_us);
+
+    int32_t offset = static_cast<int32_t>(rx_us - trace.transmit_us);
+    if (offset < minClockOffset) {
+        minClockOffset = offset;
+    }
+    airHistogram.record(static_cast<uint32_t>(offset - minClockOffset));
+
+    dispatchHistogram.record(dispatch_us - rx_us);
+}
+
+size_t LatencyTracer::encodeReport(uint8_t *buf, size_t len) {
+    size_t written = 0;
+    for (const LatencyHistogram *histogram : {&queueWaitHistogram, &airHistogram, &dispatchHistogram}) {
+        size_t n = histogram->encode(buf + written, len - written);
+        if (n == 0) {
+            ESP_LOGE(TAG, "Latency report does not fit in %zu bytes", len);
+            return 0;
+        }
+        written += n;
+    }
+    return written;
+}
+
+void LatencyTracer::logReport(const uint8_t *src_mac, const uint8_t *payload, size_t len) {
+    static const char *names[] = {"queue", "air", "dispatch"};
+    size_t offset = 0;
+
+    for (const char *name : names) {
+        LatencyHistogram histogram;
+        size_t n = histogram.decode(payload + offset, len - offset);
+        if (n == 0) {
+            ESP_LOGE(TAG, "Malformed latency report from MAC=" MACSTR, MAC2STR(src_mac));
+            return;
+        }
+        offset += n;
+
+        ESP_LOGI(TAG, MACSTR " %-8s n=%lu p50=%luus p90=%luus p99=%luus max=%luus", MAC2STR(src_mac), name,
+                 static_cast<unsigned long>(histogram.count()),
+                 static_cast<unsigned long>(histogram.percentile(50)),
+                 static_cast<unsigned long>(histogram.percentile(90)),
+                 static_cast<unsigned long>(histogram.percentile(99)),
+                 static_cast<unsigned long>(histogram.percentile(100)));
+    }
+}
+
+#endif // ENABLE_LATENCY_TRACING
@@ -0,0 +1,55 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "config.h"
+
+#if ENABLE_LATENCY_TRACING
+
+#include <cstddef>
+#include <cstdint>
+#include "Messages.h"
+
+// Fixed-memory log-linear histogram of microsecond latencies. Values below 4 us get
+// their own bucket; above that every power of two is split into 4 sub-buckets, so
+// the relative error is at most 25%. Anything at or above ~1 s lands in the last bucket.
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKET_BITS = 2;
+    static constexpr size_t MAX_EXPONENT = 20; // 2^20 us
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - 1) * (1 << SUB_BUCKET_BITS) + 1;
+
+    void record(uint32_t us);
+    uint32_t count() const { return total; }
+    // Lower bound of the bucket containing the given percentile (0-100)
+    uint32_t percentile(uint8_t pct) const;
+
+    // Sparse encoding: bucket count, then (index, u16 count) for each non-empty bucket.
+    size_t encode(uint8_t *buf, size_t len) const;
+    // Returns bytes consumed, or 0 on malformed input.
+    size_t decode(const uint8_t *buf, size_t len);
+
+    static size_t bucketIndex(uint32_t us);
+    static uint32_t bucketLowerBound(size_t index);
+
+private:
+    uint16_t buckets[BUCKET_COUNT] = {}; // Saturating counters
+    uint32_t total = 0;
+};
+
+// Receiver-side latency tracing for frames carrying a TraceExtension
+class LatencyTracer {
+public:
+    // Record one traced frame. `rx_us` is when the receive callback saw it and
+    // `dispatch_us` when recvLoop hands it to its handler, both on our clock.
+    static void recordFrame(const TraceExtension &trace, uint32_t rx_us, uint32_t dispatch_us);
+
+    // Encode the queue wait, air and dispatch histograms for a LatencyReport payload.
+    static size_t encodeReport(uint8_t *buf, size_t len);
+
+    // Decode a LatencyReport payload received by the sender and log its percentiles.
+    static void logReport(const uint8_t *src_mac, const uint8_t *payload, size_t len);
+};
+
+#endif // ENABLE_LATENCY_TRACING
+
+#endif // LATENCY_H
@@ -0,0 +1,32 @@
+#ifndef LOG_FORMATS_H
+#define LOG_FORMATS_H
+
+// Format table for DeferredLog. Records carry only the entry's index and its
+// arguments; the strings live here and in decode_dlog.py's parse of this file.
+// Append new entries at the end so existing captures keep decoding, and leave entries
+// that are no longer logged in place rather than removing them (DLOG_SENDER_PEER_ADDED,
+// DLOG_SENDER_PEER_ADD_FAILED and DLOG_SENDER_ENQUEUE_FAILED are such). Arguments are
+// stored as 32-bit words, so only integer conversions are allowed (no %s, %p, %ll).
+//
+// X(id, tag, format)
+#define DLOG_FORMATS(X) \
+    X(DLOG_SENDER_SEND_CB, "Sender", "Send callback: MAC= " MACSTR ", status=%d") \
+    X(DLOG_SENDER_SEND_FAILED, "Sender", "Send failed: MAC=" MACSTR) \
+    X(DLOG_SENDER_SEND_CB_NULL_MAC, "Sender", "Send callback error: null MAC address") \
+    X(DLOG_SENDER_RECV_CB, "Sender", "Receive callback: MAC=" MACSTR ", len=%d") \
+    X(DLOG_SENDER_RECV_CB_INVALID, "Sender", "Receive callback error: invalid arguments") \
+    X(DLOG_SENDER_RECV_TOO_SHORT, "Sender", "Received data too short to be valid: len=%d") \
+    X(DLOG_SENDER_REGISTER_REQUEST, "Sender", "Received Register Request from MAC=" MACSTR) \
+    X(DLOG_SENDER_PEER_ADDED, "Sender", "Added peer: MAC=" MACSTR) \
+    X(DLOG_SENDER_PEER_ADD_FAILED, "Sender", "Failed to add peer: MAC=" MACSTR ", error=0x%x") \
+    X(DLOG_SENDER_ENQUEUE_FAILED, "Sender", "Failed to enqueue message of type %d") \
+    X(DLOG_SENDER_INCOMING_FULL, "Sender", "Incoming queue full, dropping message from MAC=" MACSTR) \
+    X(DLOG_RECEIVER_RECV_CB, "Receiver", "Received ESPNOW data from MAC= " MACSTR ", len=%d, rssi=%d") \
+    X(DLOG_RECEIVER_RECV_CB_INVALID, "Receiver", "Receive callback error: invalid arguments (len=%d)") \
+    X(DLOG_RECEIVER_RECV_TOO_LONG, "Receiver", "Received data length exceeds buffer size: len=%d") \
+    X(DLOG_RECEIVER_QUEUE_FAILED, "Receiver", "Failed to queue received message from MAC=" MACSTR) \
+    X(DLOG_SENDER_INCOMING_HIGH_WATER, "Sender", "Incoming queue at %d of %d frames") \
+    X(DLOG_RECEIVER_QUEUE_HIGH_WATER, "Receiver", "Receive queue at %d of %d frames") \
+    X(DLOG_SENDER_RECV_TOO_LONG, "Sender", "Received data length exceeds buffer size: len=%d")
+
+#endif // LOG_FORMATS_H
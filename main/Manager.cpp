@@ -3,11 +3,19 @@
 #include "esp_now.h"
 #include "esp_wifi.h"
 #include "nvs_flash.h"
+#include "freertos/task.h"
+#include "BootProfiler.h"
+#include "Pairing.h"
 #include <stdexcept>
 #include <cstring>
 
 static const char *TAG = "Manager";
 
+#if FAST_START
+static TaskHandle_t nvsInitWaiter = nullptr; // Task blocked in finishNVSInit
+static esp_err_t nvsInitResult = ESP_OK;
+#endif
+
 Manager::Manager() {
     // Constructor implementation (if needed)
 }
@@ -19,11 +27,17 @@ Manager::~Manager() {
 esp_err_t Manager::init() {
     esp_err_t err;
 
+#if FAST_START
+    // Runs alongside esp_wifi_init; initWiFi waits for it before starting the radio
+    startNVSInit();
+#else
     err = initNVS();
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize NVS: %s", esp_err_to_name(err));
         return err;
     }
+    BootProfiler::mark("nvs");
+#endif
 
     err = initWiFi();
     if (err != ESP_OK) {
@@ -36,6 +50,7 @@ esp_err_t Manager::init() {
         ESP_LOGE(TAG, "Failed to initialize ESPNOW: %s", esp_err_to_name(err));
         return err;
     }
+    BootProfiler::mark("espnow");
 
     return ESP_OK;
 }
@@ -53,15 +68,68 @@ esp_err_t Manager::initNVS() {
     return ret;
 }
 
+#if FAST_START
+void Manager::startNVSInit() {
+    nvsInitWaiter = xTaskGetCurrentTaskHandle();
+    // Same priority as app_main: both chips are single-core, so the win comes from NVS
+    // running while app_main is blocked inside the Wi-Fi driver, not from preempting it
+    if (xTaskCreate(nvsInitTask, "nvsInit", 4096, this, uxTaskPriorityGet(nullptr), nullptr) != pdPASS) {
+        // Fall back to doing it inline
+        nvsInitResult = initNVS();
+        xTaskNotifyGive(nvsInitWaiter);
+    }
+}
+
+void Manager::nvsInitTask(void *pvParameter) {
+    nvsInitResult = static_cast<Manager *>(pvParameter)->initNVS();
+    xTaskNotifyGive(nvsInitWaiter);
+    vTaskDelete(nullptr);
+}
+
+esp_err_t Manager::finishNVSInit() {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    BootProfiler::mark("nvs wait");
+    if (nvsInitResult != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize NVS: %s", esp_err_to_name(nvsInitResult));
+    }
+    return nvsInitResult;
+}
+#endif
+
 esp_err_t Manager::initWiFi() {
+#if !FAST_START
+    // Only the TCP/IP stack needs this; ESP-NOW does not
     ESP_ERROR_CHECK(esp_netif_init());
+    BootProfiler::mark("netif");
+#endif
+    // Kept even in fast-start mode: the Wi-Fi driver posts its events to this loop
     ESP_ERROR_CHECK(esp_event_loop_create_default());
+    BootProfiler::mark("event loop");
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+#if FAST_START
+    // Wi-Fi settings are kept in RAM below, so the driver has no reason to wait for NVS
+    cfg.nvs_enable = 0;
+#endif
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    BootProfiler::mark("wifi init");
     ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
     ESP_ERROR_CHECK(esp_wifi_set_mode(ESPNOW_WIFI_MODE));
+#if FAST_START
+    // Starting the radio loads PHY calibration data from NVS
+    esp_err_t err = finishNVSInit();
+    if (err != ESP_OK) {
+        return err;
+    }
+#endif
     ESP_ERROR_CHECK(esp_wifi_start());
+    BootProfiler::mark("wifi start");
+#if ENABLE_CHANNEL_AGILITY && ENABLE_PAIRING_PERSISTENCE
+    // Come back up on the channel the fleet last moved to
+    ESP_ERROR_CHECK(esp_wifi_set_channel(Pairing::loadChannel(CONFIG_ESPNOW_CHANNEL), WIFI_SECOND_CHAN_NONE));
+#else
     ESP_ERROR_CHECK(esp_wifi_set_channel(CONFIG_ESPNOW_CHANNEL, WIFI_SECOND_CHAN_NONE));
+#endif
+    BootProfiler::mark("channel");
 
 #if CONFIG_ESPNOW_ENABLE_LONG_RANGE
     ESP_ERROR_CHECK(esp_wifi_set_protocol(ESPNOW_WIFI_IF, WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N | WIFI_PROTOCOL_LR));
@@ -73,11 +141,35 @@ esp_err_t Manager::initWiFi() {
 esp_err_t Manager::initESPNOW() {
     ESP_ERROR_CHECK(esp_now_init());
 #if CONFIG_ESPNOW_ENABLE_POWER_SAVE
-    ESP_ERROR_CHECK(esp_now_set_wake_window(CONFIG_ESPNOW_WAKE_WINDOW));
-    ESP_ERROR_CHECK(esp_wifi_connectionless_module_set_wake_interval(CONFIG_ESPNOW_WAKE_INTERVAL));
+    // With wake alignment only the receivers sleep; the sender stays awake so it hears
+    // uplink frames whenever they come
+    if (!ENABLE_WAKE_ALIGNMENT || DEVICE_ROLE == DEVICE_ROLE_RECEIVER) {
+        ESP_ERROR_CHECK(esp_now_set_wake_window(CONFIG_ESPNOW_WAKE_WINDOW));
+        ESP_ERROR_CHECK(esp_wifi_connectionless_module_set_wake_interval(CONFIG_ESPNOW_WAKE_INTERVAL));
+    }
 #endif
 
     ESP_ERROR_CHECK(esp_now_set_pmk(reinterpret_cast<const uint8_t *>(CONFIG_ESPNOW_PMK)));
 
     return ESP_OK;
 }
+
+esp_err_t Manager::switchChannel(uint8_t channel) {
+    esp_err_t err = esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to switch to channel %u: %s", channel, esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Switched to channel %u", channel);
+#if ENABLE_PAIRING_PERSISTENCE
+    Pairing::saveChannel(channel);
+#endif
+    return ESP_OK;
+}
+
+uint8_t Manager::currentChannel() {
+    uint8_t primary = CONFIG_ESPNOW_CHANNEL;
+    wifi_second_chan_t second;
+    esp_wifi_get_channel(&primary, &second);
+    return primary;
+}
@@ -7,6 +7,7 @@
 #include "freertos/queue.h"
 #include "esp_now.h"
 #include "Messages.h"
+#include "config.h"
 
 /* ESPNOW can work in both station and softap mode. It is configured in menuconfig. */
 #if CONFIG_ESPNOW_WIFI_MODE_STATION
@@ -20,6 +21,36 @@
 #define ESPNOW_QUEUE_SIZE 6
 #define ESPNOW_MAXDELAY 512
 
+// Any frame from the sender doubles as a keepalive. An explicit keepalive is only
+// sent once the link has been idle for ESPNOW_KEEPALIVE_IDLE_MS, and receivers
+// restart registration after ESPNOW_KEEPALIVE_TIMEOUT_MS without hearing anything.
+#define ESPNOW_KEEPALIVE_IDLE_MS 5000
+#define ESPNOW_KEEPALIVE_TIMEOUT_MS 10000
+
+// Real ESP-NOW peer slots the sender keeps for unicast, recycled least recently used
+// first. Fleet traffic is broadcast, so this does not limit the number of receivers;
+// it must stay below ESP_NOW_MAX_TOTAL_PEER_NUM to leave room for the broadcast peer.
+#define ESPNOW_PEER_CACHE_SIZE 16
+
+// Receivers retry registration with exponential backoff and full jitter: each wait is
+// uniform in [0, min(MAX, BASE * 2^attempt)], so a fleet powering up together spreads
+// out instead of broadcasting in lockstep. The sender collects the requests that
+// arrive within ESPNOW_REGISTRATION_BATCH_WINDOW_MS and acknowledges them together.
+#define ESPNOW_REGISTRATION_BACKOFF_BASE_MS 500
+#define ESPNOW_REGISTRATION_BACKOFF_MAX_MS 8000
+#define ESPNOW_REGISTRATION_BATCH_WINDOW_MS 200
+
+// Channel migration. The sender announces a switch ESPNOW_CHANNEL_SWITCH_DELAY_MS
+// ahead, repeating the announcement with the remaining countdown so every receiver
+// hops at about the same moment. Peers are added with channel 0 ("the current
+// channel") so they follow the radio. A receiver looking for the sender waits
+// ESPNOW_REGISTRATION_SCAN_DWELL_MS on each channel for a reply.
+#define ESPNOW_CHANNEL_MIN 1
+#define ESPNOW_CHANNEL_MAX 13
+#define ESPNOW_CHANNEL_SWITCH_DELAY_MS 2000
+#define ESPNOW_CHANNEL_SWITCH_REPEATS 4
+#define ESPNOW_REGISTRATION_SCAN_DWELL_MS 300
+
 class Manager {
 public:
     Manager();
@@ -27,8 +58,17 @@ public:
 
     esp_err_t init();
 
+    // Move the radio to `channel` and remember it for the next boot
+    static esp_err_t switchChannel(uint8_t channel);
+    static uint8_t currentChannel();
+
 private:
     esp_err_t initNVS();
+#if FAST_START
+    void startNVSInit();
+    static void nvsInitTask(void *pvParameter);
+    esp_err_t finishNVSInit();
+#endif
     esp_err_t initWiFi();
     esp_err_t initESPNOW();
     void deinitESPNOW();
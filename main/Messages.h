@@ -1,15 +1,30 @@
 #ifndef MESSAGES_H
 #define MESSAGES_H
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <cstring>
 #include "esp_now.h"
 #include "esp_log.h"
-#include <variant>
+#include "esp_crc.h"
+#include "config.h"
 #include <vector>
 #include "Manager.h"
 #include <string>
+#include <string_view>
+
+// Logical node addresses. The sender hands out node IDs at registration so frames
+// for one receiver can travel as broadcast and be filtered by ID, instead of every
+// receiver needing one of ESP-NOW's ~20 peer slots.
+typedef uint16_t NodeId;
+#define NODE_ID_NONE 0           // Not registered yet
+#define NODE_ID_BROADCAST 0xFFFF // Every node; never carried in a DestinationExtension
+
+// Zones a receiver belongs to, one bit per group. The sender assigns them with a
+// GroupAssign; frames carrying a GroupsExtension reach the members of any group listed.
+typedef uint32_t GroupMask;
+#define GROUP_COUNT 32
 
 // Define the payload types
 struct ChangePatternPayload {
@@ -23,10 +38,71 @@ struct ChangeBrightnessPayload {
 // Payload type that receivers broadcast to register themselves with the sender
 struct RegisterRequestPayload {};
 
-struct RegistrationSuccessfulPayload {};
+// Sender's reply to a RegisterRequest, assigning the receiver its node ID
+struct RegistrationSuccessfulPayload {
+    NodeId node_id;
+} __attribute__((packed));
+
+// One receiver's entry in a RegistrationBatch, which is a plain array of these
+struct RegistrationBatchEntry {
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    NodeId node_id;
+} __attribute__((packed));
 
 struct KeepalivePayload {}; // Minimal payload for keepalive messages
 
+// Sender moves the fleet to another channel
+struct ChannelSwitchPayload {
+    uint8_t channel;
+    uint16_t switch_in_ms; // Countdown from when this frame was sent
+} __attribute__((packed));
+
+// Sender tells receivers how often to send telemetry
+struct TelemetryConfigPayload {
+    uint16_t interval_s; // Mean reporting interval for each receiver
+} __attribute__((packed));
+
+// Start of a TDMA superframe; receivers time their uplink slots from its arrival
+struct TdmaBeaconPayload {
+    uint16_t superframe;    // Counts up by one every beacon
+    uint16_t superframe_ms; // Beacon period
+    uint16_t contention_ms; // Open to nodes without a slot, straight after the beacon
+    uint16_t slot_count;    // Slots after the contention period
+    uint8_t slot_ms;
+    uint8_t cycle;          // Superframes before a node's slot comes round again
+} __attribute__((packed));
+
+// Sender puts one receiver in exactly these groups; the receiver keeps them across reboots
+struct GroupAssignPayload {
+    GroupMask groups;
+} __attribute__((packed));
+
+// Show state version (see ShowState.h), carried as the body of keepalives
+struct StateVersionPayload {
+    uint16_t epoch;   // Picked by the sender at boot; versions only compare within one
+    uint32_t version; // Bumped by every change to the show state
+} __attribute__((packed));
+
+// Receiver asks for the show state changes it is missing
+struct StateRequestPayload {
+    uint16_t epoch;        // 0 when the receiver has nothing usable
+    uint32_t have_version;
+} __attribute__((packed));
+
+// Start of a StateDelta; the values of the fields in field_mask follow in field order.
+// It brings any receiver at base_version or later up to version.
+struct StateDeltaHeader {
+    uint16_t epoch;
+    uint32_t base_version; // 0 for a full snapshot
+    uint32_t version;
+    uint16_t field_mask;   // Bit per ShowField
+} __attribute__((packed));
+
+// Receiver tells the sender when its power-save wake window opens
+struct WakePhasePayload {
+    uint16_t window_start_ms; // Position in the sender's wake interval cycle (see WakeSchedule.h)
+} __attribute__((packed));
+
 static constexpr uint8_t broadcastMac[ESP_NOW_ETH_ALEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 #define IS_BROADCAST_ADDR(addr) (memcmp(addr, broadcastMac, ESP_NOW_ETH_ALEN) == 0)
 
@@ -36,57 +112,367 @@ enum {
     ESPNOW_DATA_MAX,
 };
 
-// Define a variant to hold different payload types
-using Payload = std::variant<ChangePatternPayload, ChangeBrightnessPayload, RegisterRequestPayload, RegistrationSuccessfulPayload>;
-
 enum class PayloadType : uint8_t {
     RegisterPeer,
     ChangePattern,
     ChangeBrightness,
     RegisterRequest,
     RegistrationSuccessful,
-    Keepalive
+    Keepalive,
+    LatencyReportRequest, // Sender asks receivers for their latency histograms
+    LatencyReport,        // Receiver's encoded latency histograms
+    Telemetry,            // Receiver's delta-encoded health report
+    TelemetryConfig,      // Sender tells receivers how often to report
+    RegistrationBatch,    // Broadcast acknowledgement of several RegisterRequests
+    ChannelSwitch,        // Announced, countdown-synchronised channel change
+    WakePhase,            // Receiver's power-save wake window on the sender's clock
+    TdmaBeacon,           // Superframe start for slotted uplink
+    GroupAssign,          // Sender sets a receiver's group membership
+    StateRequest,         // Receiver asks for the show state changes it missed
+    StateDelta,           // Show state fields changed since a base version
+    Count,                // Not a payload type: the number of them
+};
+
+// How Sender::send turns an application payload into frame bytes: its PayloadType
+// and an encoder writing straight into the outgoing slot. encode returns false if
+// the payload does not fit in `capacity`. Specialise it to make a payload sendable.
+template <typename PayloadT>
+struct PayloadTraits;
+
+template <>
+struct PayloadTraits<ChangePatternPayload> {
+    static constexpr PayloadType type = PayloadType::ChangePattern;
+    // The name's bytes, unterminated; the receiver takes the whole payload as the name
+    static bool encode(const ChangePatternPayload &payload, uint8_t *out, size_t capacity, size_t &len) {
+        if (payload.patternName.empty() || payload.patternName.size() > capacity) {
+            return false;
+        }
+        std::memcpy(out, payload.patternName.data(), payload.patternName.size());
+        len = payload.patternName.size();
+        return true;
+    }
+};
+
+template <>
+struct PayloadTraits<ChangeBrightnessPayload> {
+    static constexpr PayloadType type = PayloadType::ChangeBrightness;
+    static bool encode(const ChangeBrightnessPayload &payload, uint8_t *out, size_t capacity, size_t &len) {
+        if (capacity < sizeof(payload)) {
+            return false;
+        }
+        std::memcpy(out, &payload, sizeof(payload));
+        len = sizeof(payload);
+        return true;
+    }
+};
+
+// Payload bytes exactly as received
+struct PayloadBytes {
+    const uint8_t *data;
+    size_t len;
+};
+
+// How the receiver presents a payload of type `Type` to its handler: straight over
+// the frame bytes, nothing copied. Fixed-size payloads are viewed as their struct,
+// which the parser has already checked the frame is long enough for; the packed
+// structs have no alignment to violate. Types without a specialisation get the raw
+// bytes.
+template <PayloadType Type>
+struct PayloadView {
+    typedef PayloadBytes type;
+    static type get(const uint8_t *data, size_t len) { return {data, len}; }
+};
+
+template <typename PayloadT>
+struct StructPayloadView {
+    static_assert(alignof(PayloadT) == 1, "Viewed in place in the frame, so it must not need alignment");
+    typedef const PayloadT &type;
+    static type get(const uint8_t *data, size_t len) { return *reinterpret_cast<const PayloadT *>(data); }
 };
 
-// Message contains the payload as well as potentially the parsed payload.
-// This struct is used both for sending and receiving messages and various fields
-// might be empty depending on the context. 
-struct Message {
-    uint8_t type;                    // Type of the message (e.g., broadcast or unicast)
-    PayloadType payload_type;  // Type of the payload
-    Payload parsed_payload;    // Parsed payload as a variant
+// The pattern name's bytes, which are not NUL-terminated
+template <>
+struct PayloadView<PayloadType::ChangePattern> {
+    typedef std::string_view type;
+    static type get(const uint8_t *data, size_t len) { return {reinterpret_cast<const char *>(data), len}; }
 };
 
+// The show state version, or nullptr from a sender without ENABLE_SHOW_STATE
+template <>
+struct PayloadView<PayloadType::Keepalive> {
+    typedef const StateVersionPayload *type;
+    static type get(const uint8_t *data, size_t len) {
+        return len >= sizeof(StateVersionPayload) ? reinterpret_cast<const StateVersionPayload *>(data) : nullptr;
+    }
+};
+
+template <> struct PayloadView<PayloadType::ChangeBrightness> : StructPayloadView<ChangeBrightnessPayload> {};
+template <> struct PayloadView<PayloadType::TelemetryConfig> : StructPayloadView<TelemetryConfigPayload> {};
+template <> struct PayloadView<PayloadType::ChannelSwitch> : StructPayloadView<ChannelSwitchPayload> {};
+template <> struct PayloadView<PayloadType::TdmaBeacon> : StructPayloadView<TdmaBeaconPayload> {};
+template <> struct PayloadView<PayloadType::GroupAssign> : StructPayloadView<GroupAssignPayload> {};
+
+// MessageData::flags, announcing optional header extensions that sit between the
+// fixed header and the payload, in the order the flags are listed here.
+#define MESSAGE_FLAG_TRACE 0x01       // TraceExtension present
+#define MESSAGE_FLAG_DESTINATION 0x02 // DestinationExtension present
+#define MESSAGE_FLAG_RELAY 0x04       // RelayExtension present
+#define MESSAGE_FLAG_AUTH 0x08        // AuthExtension present
+#define MESSAGE_FLAG_WAKE_PHASE 0x10  // WakePhaseExtension present
+#define MESSAGE_FLAG_GROUPS 0x20      // GroupsExtension present
+#define MESSAGE_FLAG_NODE_BITMAP 0x40 // NodeBitmapExtension present
+
 // MessageData is the raw message going over the wire/air.
 struct MessageData {
     uint16_t seq_num;                     //Sequence number of ESPNOW data.
     uint16_t crc;                         //CRC16 value of ESPNOW data.
     uint8_t payload_type;                  //Payload type of ESPNOW data.
-    uint8_t payload[];                    //Real payload of ESPNOW data.
+    uint8_t flags;                        //MESSAGE_FLAG_* bits.
+    uint8_t payload[];                    //Header extensions, then the real payload of ESPNOW data.
 } __attribute__((packed));
 // The __attribute__((packed)) directive is used to ensure that the struct is packed without padding
 
-struct MessageEnvelope {
-    uint8_t src_mac[ESP_NOW_ETH_ALEN]; // MAC address of the source device
-    uint8_t *data;                     // Raw received data
-    size_t data_len;                   // Actual length of the received data
+// Sender-side timestamps (low 32 bits of esp_timer_get_time()) used for latency tracing
+struct TraceExtension {
+    uint32_t enqueue_us;  // When the frame was built and queued
+    uint32_t transmit_us; // When it was handed to esp_now_send
+} __attribute__((packed));
+
+// Frame meant for a single node. Receivers drop it before parsing when it arrives
+// as broadcast and the ID is not theirs.
+struct DestinationExtension {
+    NodeId node_id;
+} __attribute__((packed));
 
-    // Constructor to allocate memory for data
-    MessageEnvelope(size_t len) : data_len(len) {
-        data = new uint8_t[len];
+// Lets receivers rebroadcast a fleet frame further from the sender. Relays keep the
+// origin so receivers track sequence numbers and reply per sender, not per relay.
+struct RelayExtension {
+    uint8_t origin[ESP_NOW_ETH_ALEN]; // Sender that built the frame
+    uint8_t hops_left;                // Further rebroadcasts allowed; each relay decrements it
+} __attribute__((packed));
+
+// Group-key authentication tag and replay counter (see Auth.h)
+#define AUTH_TAG_LEN 8
+struct AuthExtension {
+    uint32_t counter;          // Never repeats for a given sender, even across reboots
+    uint8_t tag[AUTH_TAG_LEN]; // SipHash-2-4 over the frame, mutable fields zeroed
+} __attribute__((packed));
+
+// Where the sender was in its wake interval cycle when the frame went out. Receivers
+// learn their wake window from the frames they manage to hear (see WakeSchedule.h).
+struct WakePhaseExtension {
+    uint16_t phase_ms; // Stamped by transmit(), so every copy of a held frame differs
+} __attribute__((packed));
+
+// Frame for every node in any of `groups`
+struct GroupsExtension {
+    GroupMask groups;
+} __attribute__((packed));
+
+// Frame for an arbitrary set of nodes: bit i of `bits` (LSB first) stands for node
+// first_node + i. A fixed size keeps the header layout static; a set spread over more
+// than NODE_BITMAP_BYTES * 8 consecutive IDs takes several frames.
+#define NODE_BITMAP_BYTES 16
+struct NodeBitmapExtension {
+    NodeId first_node;
+    uint8_t bits[NODE_BITMAP_BYTES];
+} __attribute__((packed));
+
+inline bool nodeBitmapHas(const NodeBitmapExtension &bitmap, NodeId node) {
+    uint32_t bit = static_cast<uint32_t>(node - bitmap.first_node);
+    return node >= bitmap.first_node && bit < NODE_BITMAP_BYTES * 8 && (bitmap.bits[bit / 8] & (1 << (bit % 8)));
+}
+
+// Adds `node`, false if it lies outside the range the bitmap already covers. The
+// first node added fixes first_node, rounded down to a multiple of 8.
+inline bool nodeBitmapAdd(NodeBitmapExtension &bitmap, NodeId node) {
+    bool empty = true;
+    for (uint8_t byte : bitmap.bits) {
+        empty = empty && byte == 0;
+    }
+    if (empty) {
+        bitmap.first_node = node & ~static_cast<NodeId>(7);
+    }
+    uint32_t bit = static_cast<uint32_t>(node - bitmap.first_node);
+    if (node < bitmap.first_node || bit >= NODE_BITMAP_BYTES * 8) {
+        return false;
+    }
+    bitmap.bits[bit / 8] |= 1 << (bit % 8);
+    return true;
+}
+
+// Offset of the extension announced by `flag` in a frame whose header carries `flags`
+constexpr size_t messageExtensionOffset(uint8_t flags, uint8_t flag) {
+    size_t offset = sizeof(MessageData);
+    if ((flags & MESSAGE_FLAG_TRACE) && flag > MESSAGE_FLAG_TRACE) {
+        offset += sizeof(TraceExtension);
+    }
+    if ((flags & MESSAGE_FLAG_DESTINATION) && flag > MESSAGE_FLAG_DESTINATION) {
+        offset += sizeof(DestinationExtension);
+    }
+    if ((flags & MESSAGE_FLAG_RELAY) && flag > MESSAGE_FLAG_RELAY) {
+        offset += sizeof(RelayExtension);
+    }
+    if ((flags & MESSAGE_FLAG_AUTH) && flag > MESSAGE_FLAG_AUTH) {
+        offset += sizeof(AuthExtension);
+    }
+    if ((flags & MESSAGE_FLAG_WAKE_PHASE) && flag > MESSAGE_FLAG_WAKE_PHASE) {
+        offset += sizeof(WakePhaseExtension);
+    }
+    if ((flags & MESSAGE_FLAG_GROUPS) && flag > MESSAGE_FLAG_GROUPS) {
+        offset += sizeof(GroupsExtension);
+    }
+    return offset;
+}
+
+// Length of the fixed header plus the extensions announced in `flags`. Receivers
+// always honour this, even with tracing compiled out, so they can find the payload.
+constexpr size_t messageHeaderLength(uint8_t flags) {
+    size_t len = sizeof(MessageData);
+    if (flags & MESSAGE_FLAG_TRACE) {
+        len += sizeof(TraceExtension);
+    }
+    if (flags & MESSAGE_FLAG_DESTINATION) {
+        len += sizeof(DestinationExtension);
     }
+    if (flags & MESSAGE_FLAG_RELAY) {
+        len += sizeof(RelayExtension);
+    }
+    if (flags & MESSAGE_FLAG_AUTH) {
+        len += sizeof(AuthExtension);
+    }
+    if (flags & MESSAGE_FLAG_WAKE_PHASE) {
+        len += sizeof(WakePhaseExtension);
+    }
+    if (flags & MESSAGE_FLAG_GROUPS) {
+        len += sizeof(GroupsExtension);
+    }
+    if (flags & MESSAGE_FLAG_NODE_BITMAP) {
+        len += sizeof(NodeBitmapExtension);
+    }
+    return len;
+}
+
+// Frames addressed to a subset of the fleet through groups or a node bitmap. They
+// are numbered in a stream of their own, since each receiver only sees some of them.
+#define MESSAGE_FLAGS_TARGETED (MESSAGE_FLAG_GROUPS | MESSAGE_FLAG_NODE_BITMAP)
 
-    // Destructor to free allocated memory
-    ~MessageEnvelope() {
-        delete[] data;
+// Whether a frame is meant for `node`, a member of `groups`. Reads only the fixed
+// size addressing extensions, so the cost does not depend on the frame. Frames
+// with none of them are for everyone; truncated ones for no one.
+inline bool frameAddressedTo(const uint8_t *data, size_t len, NodeId node, GroupMask groups) {
+    if (len < sizeof(MessageData)) {
+        return false;
     }
+    uint8_t flags = reinterpret_cast<const MessageData *>(data)->flags;
+    if (!(flags & (MESSAGE_FLAG_DESTINATION | MESSAGE_FLAGS_TARGETED))) {
+        return true;
+    }
+    if (len < messageHeaderLength(flags)) {
+        return false;
+    }
+    if (flags & MESSAGE_FLAG_DESTINATION) {
+        DestinationExtension destination;
+        std::memcpy(&destination, data + messageExtensionOffset(flags, MESSAGE_FLAG_DESTINATION), sizeof(destination));
+        if (destination.node_id != node) {
+            return false;
+        }
+    }
+    if (flags & MESSAGE_FLAG_GROUPS) {
+        GroupsExtension target;
+        std::memcpy(&target, data + messageExtensionOffset(flags, MESSAGE_FLAG_GROUPS), sizeof(target));
+        if (!(target.groups & groups)) {
+            return false;
+        }
+    }
+    if (flags & MESSAGE_FLAG_NODE_BITMAP) {
+        NodeBitmapExtension bitmap;
+        std::memcpy(&bitmap, data + messageExtensionOffset(flags, MESSAGE_FLAG_NODE_BITMAP), sizeof(bitmap));
+        if (!nodeBitmapHas(bitmap, node)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Which receivers a frame from the sender is for: every node, one node, the members
+// of some groups, or the nodes in a bitmap
+struct FrameTarget {
+    uint8_t flag;                  // Addressing extension to carry, 0 for every node
+    NodeId node;                   // MESSAGE_FLAG_DESTINATION
+    GroupMask groups;              // MESSAGE_FLAG_GROUPS
+    NodeBitmapExtension bitmap;    // MESSAGE_FLAG_NODE_BITMAP
+
+    static FrameTarget all() { return FrameTarget{}; }
+    static FrameTarget toNode(NodeId node) {
+        FrameTarget target = {};
+        if (node != NODE_ID_BROADCAST) {
+            target.flag = MESSAGE_FLAG_DESTINATION;
+            target.node = node;
+        }
+        return target;
+    }
+    static FrameTarget toGroups(GroupMask groups) {
+        FrameTarget target = {};
+        target.flag = MESSAGE_FLAG_GROUPS;
+        target.groups = groups;
+        return target;
+    }
+    // Fill `bitmap` with nodeBitmapAdd
+    static FrameTarget toNodes(const NodeBitmapExtension &bitmap) {
+        FrameTarget target = {};
+        target.flag = MESSAGE_FLAG_NODE_BITMAP;
+        target.bitmap = bitmap;
+        return target;
+    }
+};
+
+// CRC16 over a whole frame as if its crc field were zero. The crc field of `data`
+// is temporarily cleared and then restored.
+inline uint16_t computeMessageCrc(uint8_t *data, size_t len) {
+    MessageData *message = reinterpret_cast<MessageData *>(data);
+    uint16_t savedCrc = message->crc;
+    message->crc = 0;
+    uint16_t crc = esp_crc16_le(UINT16_MAX, data, len);
+    message->crc = savedCrc;
+    return crc;
+}
+
+// The same for a frame that must not be written to, such as the radio's receive
+// buffer: the bytes either side of the crc field are chained around two zero bytes.
+// `len` must cover at least the MessageData header.
+inline uint16_t computeMessageCrc(const uint8_t *data, size_t len) {
+    static const uint8_t zeroCrc[sizeof(MessageData::crc)] = {0};
+    const size_t crcAt = offsetof(MessageData, crc);
+    uint16_t crc = esp_crc16_le(UINT16_MAX, data, crcAt);
+    crc = esp_crc16_le(crc, zeroCrc, sizeof(zeroCrc));
+    return esp_crc16_le(crc, data + crcAt + sizeof(zeroCrc), len - crcAt - sizeof(zeroCrc));
+}
+
+// A received frame as handed from the receive callback to its consumer. Lives in a
+// RecvHandoff ring slot, so the frame is stored inline.
+struct MessageEnvelope {
+    uint8_t src_mac[ESP_NOW_ETH_ALEN]; // MAC address of the source device
+    size_t data_len;                   // Actual length of the received data
+    int8_t rssi;                       // RSSI reported by the radio for this frame
+    bool broadcast;                    // Sent to the broadcast address rather than to us
+#if ENABLE_LATENCY_TRACING || ENABLE_TDMA
+    uint32_t rx_time_us;               // When the receive callback saw the frame
+#endif
+#if ENABLE_WAKE_ALIGNMENT
+    uint16_t wake_phase_ms;            // From the WakePhaseExtension; WAKE_PHASE_UNKNOWN if absent or relayed
+#endif
+#if ENABLE_CHANNEL_AGILITY
+    uint8_t channel;                   // Channel the radio heard the frame on, 0 if unknown
+#endif
+    uint8_t data[ESP_NOW_MAX_DATA_LEN_V2]; // Raw received data
 };
 
 struct SendParams {
     uint8_t raw_data[ESP_NOW_MAX_DATA_LEN_V2]; // Store raw data directly
-     // Destination MAC address. Only used if we're sending to a specific peer. It will be
-     // empty in most cases.
-    uint8_t dest_mac[ESP_NOW_ETH_ALEN];      
+    // Destination MAC address. Only set for frames that must go out as real unicast
+    // (and so need an ESP-NOW peer slot); all zero means broadcast.
+    uint8_t dest_mac[ESP_NOW_ETH_ALEN];
     size_t data_len;                        // Actual length of the data
 
     SendParams() : raw_data{0}, dest_mac{0}, data_len(0) {}
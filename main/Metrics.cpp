@@ -0,0 +1,161 @@
+#include "Metrics.h"
+
+#if ENABLE_METRICS
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/timers.h"
+
+static const char *TAG = "Metrics";
+
+struct TrackedTask {
+    TaskHandle_t handle;
+    const char *name;
+};
+
+struct TrackedQueue {
+    QueueHandle_t handle;
+    size_t (*depth)(); // Used instead of the handle when set
+    const char *name;
+    uint8_t peak;
+};
+
+static TrackedTask tasks[METRICS_MAX_TASKS];
+static TrackedQueue queues[METRICS_MAX_QUEUES];
+static uint8_t taskCount = 0;
+static uint8_t queueCount = 0;
+static portMUX_TYPE registryLock = portMUX_INITIALIZER_UNLOCKED;
+
+static void metricsTimerCallback(TimerHandle_t timer) {
+    MetricsSnapshot snapshot;
+    Metrics::sample(snapshot);
+    Metrics::log(snapshot);
+}
+
+void Metrics::start() {
+    // Keepalive and metrics callbacks run on the timer service task
+    registerTask(xTimerGetTimerDaemonTaskHandle(), "timerService");
+
+    TimerHandle_t timer = xTimerCreate("metrics", pdMS_TO_TICKS(METRICS_INTERVAL_MS), pdTRUE, nullptr, metricsTimerCallback);
+    if (!timer || xTimerStart(timer, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start metrics timer");
+    }
+}
+
+void Metrics::registerTask(TaskHandle_t task, const char *name) {
+    if (!task) {
+        return;
+    }
+    taskENTER_CRITICAL(&registryLock);
+    bool added = taskCount < METRICS_MAX_TASKS;
+    if (added) {
+        tasks[taskCount++] = {task, name};
+    }
+    taskEXIT_CRITICAL(&registryLock);
+
+    if (!added) {
+        ESP_LOGW(TAG, "Task table full, not tracking %s", name);
+    }
+}
+
+static void addQueue(const TrackedQueue &queue) {
+    taskENTER_CRITICAL(&registryLock);
+    bool added = queueCount < METRICS_MAX_QUEUES;
+    if (added) {
+        queues[queueCount++] = queue;
+    }
+    taskEXIT_CRITICAL(&registryLock);
+
+    if (!added) {
+        ESP_LOGW(TAG, "Queue table full, not tracking %s", queue.name);
+    }
+}
+
+void Metrics::registerQueue(QueueHandle_t queue, const char *name) {
+    if (queue) {
+        addQueue({queue, nullptr, name, 0});
+    }
+}
+
+void Metrics::registerQueue(size_t (*depth)(), const char *name) {
+    if (depth) {
+        addQueue({nullptr, depth, name, 0});
+    }
+}
+
+void Metrics::sample(MetricsSnapshot &snapshot) {
+    snapshot = {};
+    snapshot.uptime_s = static_cast<uint32_t>(esp_timer_get_time() / 1000000);
+    snapshot.free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    snapshot.min_free_heap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    snapshot.largest_free_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+    snapshot.task_count = taskCount;
+    for (uint8_t i = 0; i < snapshot.task_count; i++) {
+        snapshot.stack_hwm[i] = static_cast<uint16_t>(uxTaskGetStackHighWaterMark(tasks[i].handle) * sizeof(StackType_t));
+    }
+
+    snapshot.queue_count = queueCount;
+    for (uint8_t i = 0; i < snapshot.queue_count; i++) {
+        size_t depth = queues[i].depth ? queues[i].depth() : uxQueueMessagesWaiting(queues[i].handle);
+        snapshot.queue_depth[i] = depth > UINT8_MAX ? UINT8_MAX : static_cast<uint8_t>(depth);
+        if (snapshot.queue_depth[i] > queues[i].peak) {
+            queues[i].peak = snapshot.queue_depth[i];
+        }
+        snapshot.queue_peak[i] = queues[i].peak;
+    }
+}
+
+static uint8_t *putU16(uint8_t *p, uint16_t v) {
+    *p++ = v & 0xFF;
+    *p++ = v >> 8;
+    return p;
+}
+
+static uint8_t *putU32(uint8_t *p, uint32_t v) {
+    p = putU16(p, v & 0xFFFF);
+    return putU16(p, v >> 16);
+}
+
+size_t Metrics::encode(const MetricsSnapshot &snapshot, uint8_t *buf, size_t len) {
+    size_t needed = 1 + 16 + 2 + snapshot.task_count * 2 + snapshot.queue_count * 2;
+    if (!buf || len < needed) {
+        return 0;
+    }
+
+    uint8_t *p = buf;
+    *p++ = METRICS_SNAPSHOT_VERSION;
+    p = putU32(p, snapshot.uptime_s);
+    p = putU32(p, snapshot.free_heap);
+    p = putU32(p, snapshot.min_free_heap);
+    p = putU32(p, snapshot.largest_free_block);
+    *p++ = snapshot.task_count;
+    *p++ = snapshot.queue_count;
+    for (uint8_t i = 0; i < snapshot.task_count; i++) {
+        p = putU16(p, snapshot.stack_hwm[i]);
+    }
+    for (uint8_t i = 0; i < snapshot.queue_count; i++) {
+        *p++ = snapshot.queue_depth[i];
+        *p++ = snapshot.queue_peak[i];
+    }
+    return p - buf;
+}
+
+void Metrics::log(const MetricsSnapshot &snapshot) {
+    ESP_LOGI(TAG, "uptime=%lus heap free=%lu min=%lu largest=%lu",
+             static_cast<unsigned long>(snapshot.uptime_s), static_cast<unsigned long>(snapshot.free_heap),
+             static_cast<unsigned long>(snapshot.min_free_heap), static_cast<unsigned long>(snapshot.largest_free_block));
+    for (uint8_t i = 0; i < snapshot.task_count; i++) {
+        ESP_LOGI(TAG, "task %-16s stack free at peak: %u bytes", tasks[i].name, snapshot.stack_hwm[i]);
+    }
+    for (uint8_t i = 0; i < snapshot.queue_count; i++) {
+        ESP_LOGI(TAG, "queue %-16s depth=%u peak=%u", queues[i].name, snapshot.queue_depth[i], snapshot.queue_peak[i]);
+    }
+
+    uint8_t encoded[METRICS_ENCODED_MAX_LEN];
+    size_t encodedLen = encode(snapshot, encoded, sizeof(encoded));
+    ESP_LOG_BUFFER_HEX_LEVEL(TAG, encoded, encodedLen, ESP_LOG_DEBUG);
+}
+
+#endif // ENABLE_METRICS
@@ -0,0 +1,71 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "config.h"
+
+#define METRICS_MAX_TASKS 6
+#define METRICS_MAX_QUEUES 4
+#define METRICS_SNAPSHOT_VERSION 1
+
+// Point-in-time view of the resources we are most likely to run out of.
+// Task and queue entries are in registration order.
+struct MetricsSnapshot {
+    uint32_t uptime_s;
+    uint32_t free_heap;
+    uint32_t min_free_heap;      // Lowest free heap since boot
+    uint32_t largest_free_block; // Fragmentation indicator
+    uint8_t task_count;
+    uint8_t queue_count;
+    uint16_t stack_hwm[METRICS_MAX_TASKS]; // Unused stack in bytes at the deepest point so far
+    uint8_t queue_depth[METRICS_MAX_QUEUES];
+    uint8_t queue_peak[METRICS_MAX_QUEUES]; // Deepest depth seen at any sample
+};
+
+// Maximum size of an encoded snapshot, suitable for an ESP-NOW payload
+#define METRICS_ENCODED_MAX_LEN (1 + 16 + 2 + METRICS_MAX_TASKS * 2 + METRICS_MAX_QUEUES * 2)
+
+#if ENABLE_METRICS
+
+class Metrics {
+public:
+    // Start sampling and logging every METRICS_INTERVAL_MS.
+    static void start();
+
+    // Only register tasks that live forever; a deleted task's handle must not be sampled.
+    static void registerTask(TaskHandle_t task, const char *name);
+    static void registerQueue(QueueHandle_t queue, const char *name);
+    // For queues that are not FreeRTOS queues, such as a RecvHandoff ring: `depth`
+    // is called from the metrics timer and must only read.
+    static void registerQueue(size_t (*depth)(), const char *name);
+
+    static void sample(MetricsSnapshot &snapshot);
+
+    // Compact little-endian encoding: version, uptime, heap stats, counts, then
+    // one entry per registered task/queue. Returns bytes written or 0 if `len` is too small.
+    static size_t encode(const MetricsSnapshot &snapshot, uint8_t *buf, size_t len);
+
+    static void log(const MetricsSnapshot &snapshot);
+};
+
+#else
+
+// Metrics compiled out: every call is an empty inline and the snapshot stays zeroed.
+class Metrics {
+public:
+    static void start() {}
+    static void registerTask(TaskHandle_t, const char *) {}
+    static void registerQueue(QueueHandle_t, const char *) {}
+    static void registerQueue(size_t (*)(), const char *) {}
+    static void sample(MetricsSnapshot &snapshot) { snapshot = {}; }
+    static size_t encode(const MetricsSnapshot &, uint8_t *, size_t) { return 0; }
+    static void log(const MetricsSnapshot &) {}
+};
+
+#endif // ENABLE_METRICS
+
+#endif // METRICS_H
@@ -0,0 +1,188 @@
+#include "Pairing.h"
+
+#if ENABLE_PAIRING_PERSISTENCE
+
+#include "PeerRegistry.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "nvs.h"
+#include <cstdio>
+#include <cstring>
+
+static const char *TAG = "Pairing";
+static const char *NVS_NAMESPACE = "pairing";
+
+#define PAIRING_CHUNK_PEERS 32 // MACs per NVS blob
+
+// Sender: version and how many peers the chunks hold
+struct PeerTableHeader {
+    uint8_t version;
+    uint16_t count;
+} __attribute__((packed));
+
+static ReceiverPairing savedPairing = {}; // Last pairing read or written, to skip identical writes
+static size_t savedPeerCount = 0;         // Peers already in flash
+
+static void chunkKey(char *key, size_t len, size_t chunk) {
+    snprintf(key, len, "peers%u", static_cast<unsigned>(chunk));
+}
+
+bool Pairing::loadReceiver(ReceiverPairing &pairing) {
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+    size_t len = sizeof(pairing);
+    esp_err_t err = nvs_get_blob(handle, "receiver", &pairing, &len);
+    nvs_close(handle);
+
+    if (err != ESP_OK || len != sizeof(pairing) || pairing.version != PAIRING_VERSION ||
+        pairing.node_id == NODE_ID_NONE) {
+        return false;
+    }
+    savedPairing = pairing;
+    return true;
+}
+
+esp_err_t Pairing::saveReceiver(const ReceiverPairing &pairing) {
+    if (std::memcmp(&pairing, &savedPairing, sizeof(pairing)) == 0) {
+        return ESP_OK;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, "receiver", &pairing, sizeof(pairing));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+
+    if (err == ESP_OK) {
+        savedPairing = pairing;
+        ESP_LOGI(TAG, "Saved pairing: sender=" MACSTR ", node %u", MAC2STR(pairing.sender_mac), pairing.node_id);
+    } else {
+        ESP_LOGE(TAG, "Failed to save pairing: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+size_t Pairing::restorePeers() {
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return 0;
+    }
+
+    PeerTableHeader header = {};
+    size_t len = sizeof(header);
+    if (nvs_get_blob(handle, "peerhdr", &header, &len) != ESP_OK || len != sizeof(header) ||
+        header.version != PAIRING_VERSION) {
+        nvs_close(handle);
+        return 0;
+    }
+
+    size_t restored = 0;
+    uint8_t chunk[PAIRING_CHUNK_PEERS][ESP_NOW_ETH_ALEN];
+    for (size_t first = 0; first < header.count; first += PAIRING_CHUNK_PEERS) {
+        char key[16];
+        chunkKey(key, sizeof(key), first / PAIRING_CHUNK_PEERS);
+        len = sizeof(chunk);
+        if (nvs_get_blob(handle, key, chunk, &len) != ESP_OK) {
+            ESP_LOGE(TAG, "Missing peer chunk %s, restored %zu of %u peers", key, restored, header.count);
+            break;
+        }
+
+        for (size_t i = 0; i < len / ESP_NOW_ETH_ALEN && first + i < header.count; i++) {
+            bool created;
+            PeerEntry *peer = PeerRegistry::add(chunk[i], created);
+            // IDs are handed out in order, so anything else means the table is corrupt
+            if (!peer || !created || peer->node_id != first + i + 1) {
+                ESP_LOGE(TAG, "Saved peer table is inconsistent, stopping at %zu peers", restored);
+                nvs_close(handle);
+                savedPeerCount = restored;
+                return restored;
+            }
+            restored++;
+        }
+    }
+    nvs_close(handle);
+
+    savedPeerCount = restored;
+    ESP_LOGI(TAG, "Restored %zu peers", restored);
+    return restored;
+}
+
+esp_err_t Pairing::savePeers() {
+    size_t count = PeerRegistry::size();
+    if (count == savedPeerCount) {
+        return ESP_OK;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // Only the chunk the last save ended in and the ones after it have changed
+    uint8_t chunk[PAIRING_CHUNK_PEERS][ESP_NOW_ETH_ALEN];
+    for (size_t first = savedPeerCount - savedPeerCount % PAIRING_CHUNK_PEERS; first < count && err == ESP_OK;
+         first += PAIRING_CHUNK_PEERS) {
+        size_t n = 0;
+        for (const PeerEntry *peer = PeerRegistry::begin() + first; peer != PeerRegistry::end() && n < PAIRING_CHUNK_PEERS; ++peer) {
+            std::memcpy(chunk[n++], peer->mac, ESP_NOW_ETH_ALEN);
+        }
+        char key[16];
+        chunkKey(key, sizeof(key), first / PAIRING_CHUNK_PEERS);
+        err = nvs_set_blob(handle, key, chunk, n * ESP_NOW_ETH_ALEN);
+    }
+
+    // The header goes last so a failed save never claims more peers than were written
+    if (err == ESP_OK) {
+        PeerTableHeader header = {PAIRING_VERSION, static_cast<uint16_t>(count)};
+        err = nvs_set_blob(handle, "peerhdr", &header, sizeof(header));
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Saved %zu peers (%zu new)", count, count - savedPeerCount);
+        savedPeerCount = count;
+    } else {
+        ESP_LOGE(TAG, "Failed to save peers: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+uint8_t Pairing::loadChannel(uint8_t fallback) {
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return fallback;
+    }
+    uint8_t channel = 0;
+    esp_err_t err = nvs_get_u8(handle, "channel", &channel);
+    nvs_close(handle);
+    return err == ESP_OK && channel != 0 ? channel : fallback;
+}
+
+esp_err_t Pairing::saveChannel(uint8_t channel) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_u8(handle, "channel", channel);
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save channel: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+#endif // ENABLE_PAIRING_PERSISTENCE
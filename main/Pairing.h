@@ -0,0 +1,46 @@
+#ifndef PAIRING_H
+#define PAIRING_H
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "esp_now.h"
+#include "Messages.h"
+#include "config.h"
+
+#if ENABLE_PAIRING_PERSISTENCE
+
+#define PAIRING_VERSION 2
+
+// What a receiver needs to resume its session with the sender after a reboot
+struct ReceiverPairing {
+    uint8_t version;
+    uint8_t sender_mac[ESP_NOW_ETH_ALEN];
+    NodeId node_id;
+    GroupMask groups;              // Last GroupAssign
+    uint16_t telemetry_interval_s; // Last TelemetryConfig, 0 if none was received
+} __attribute__((packed));
+
+// Pairing state kept in NVS so boards skip rediscovery after a power cycle.
+// NVS spreads writes over its pages itself; on top of that we only write what
+// changed. The sender's peer table is append-only, so it is stored in chunks and
+// a save rewrites just the chunks that gained peers.
+class Pairing {
+public:
+    // Receiver side. saveReceiver does nothing when the pairing is unchanged.
+    static bool loadReceiver(ReceiverPairing &pairing);
+    static esp_err_t saveReceiver(const ReceiverPairing &pairing);
+
+    // Sender side. restorePeers re-adds saved MACs to PeerRegistry in node ID
+    // order, so every receiver keeps the ID it was given before the reboot.
+    static size_t restorePeers();
+    static esp_err_t savePeers();
+
+    // Both roles: the channel the fleet last moved to, or `fallback` if it never moved
+    static uint8_t loadChannel(uint8_t fallback);
+    static esp_err_t saveChannel(uint8_t channel);
+};
+
+#endif // ENABLE_PAIRING_PERSISTENCE
+
+#endif // PAIRING_H
@@ -0,0 +1,69 @@
+#include "PeerRegistry.h"
+#include <cstring>
+
+// At most half full, so probe sequences stay short
+#define PEER_INDEX_SIZE 512
+
+static_assert((PEER_INDEX_SIZE & (PEER_INDEX_SIZE - 1)) == 0, "PEER_INDEX_SIZE must be a power of two");
+static_assert(PEER_INDEX_SIZE >= 2 * PEER_REGISTRY_CAPACITY, "PEER_INDEX_SIZE too small for the registry");
+static_assert(PEER_REGISTRY_CAPACITY < NODE_ID_BROADCAST, "Node IDs must not reach NODE_ID_BROADCAST");
+
+PeerEntry PeerRegistry::entries[PEER_REGISTRY_CAPACITY];
+size_t PeerRegistry::count = 0;
+
+// Node ID (index into `entries` plus one) for each hash slot, NODE_ID_NONE when unused
+static NodeId macIndex[PEER_INDEX_SIZE];
+
+static uint32_t hashMac(const uint8_t *mac) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < ESP_NOW_ETH_ALEN; i++) {
+        hash = (hash ^ mac[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Slot holding `mac`, or the empty slot where it would go
+size_t PeerRegistry::slotFor(const uint8_t *mac) {
+    size_t slot = hashMac(mac) & (PEER_INDEX_SIZE - 1);
+    while (macIndex[slot] != NODE_ID_NONE &&
+           memcmp(entries[macIndex[slot] - 1].mac, mac, ESP_NOW_ETH_ALEN) != 0) {
+        slot = (slot + 1) & (PEER_INDEX_SIZE - 1);
+    }
+    return slot;
+}
+
+PeerEntry *PeerRegistry::add(const uint8_t *mac, bool &created) {
+    created = false;
+    size_t slot = slotFor(mac);
+    if (macIndex[slot] != NODE_ID_NONE) {
+        return &entries[macIndex[slot] - 1];
+    }
+    if (count == PEER_REGISTRY_CAPACITY) {
+        return nullptr;
+    }
+
+    PeerEntry &entry = entries[count];
+    entry = {};
+    memcpy(entry.mac, mac, ESP_NOW_ETH_ALEN);
+    entry.node_id = static_cast<NodeId>(++count);
+#if ENABLE_WAKE_ALIGNMENT
+    entry.wake_start_ms = WAKE_PHASE_UNKNOWN;
+    entry.wake_point = WAKE_POINT_NONE;
+#endif
+    macIndex[slot] = entry.node_id;
+    created = true;
+    return &entry;
+}
+
+PeerEntry *PeerRegistry::find(const uint8_t *mac) {
+    size_t slot = slotFor(mac);
+    return macIndex[slot] == NODE_ID_NONE ? nullptr : &entries[macIndex[slot] - 1];
+}
+
+PeerEntry *PeerRegistry::find(NodeId node_id) {
+    if (node_id == NODE_ID_NONE || node_id > count) {
+        return nullptr;
+    }
+    return &entries[node_id - 1];
+}
@@ -0,0 +1,67 @@
+#ifndef PEER_REGISTRY_H
+#define PEER_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "esp_now.h"
+#include "Messages.h"
+#include "Telemetry.h"
+#include "WakeSchedule.h"
+#include "config.h"
+
+// Most receivers one sender keeps track of. Node IDs run from 1 to this value.
+#define PEER_REGISTRY_CAPACITY 250
+
+#if ENABLE_TELEMETRY
+// Latest health report from a receiver, rebuilt from delta-encoded Telemetry frames
+struct PeerTelemetry {
+    int32_t values[TELEMETRY_FIELD_COUNT];
+    uint8_t last_seq;
+    bool synced;            // False until a keyframe arrives after a lost report
+    bool reported;          // At least one report has arrived
+    TickType_t last_report; // Tick count of the last report
+};
+#endif
+
+// Everything the sender knows about one registered receiver
+struct PeerEntry {
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    NodeId node_id;
+    uint16_t seq_num;       // Last sequence number sent to this node alone
+    TickType_t last_heard;  // Tick count of the last frame from this node
+    GroupMask groups;       // Last membership sent in a GroupAssign; not persisted
+#if ENABLE_TELEMETRY
+    PeerTelemetry telemetry;
+#endif
+#if ENABLE_WAKE_ALIGNMENT
+    uint16_t wake_start_ms; // Reported wake window start, WAKE_PHASE_UNKNOWN until then
+    uint8_t wake_point;     // WakeSchedule transmit point covering this node, or WAKE_POINT_NONE
+#endif
+};
+
+// The sender's own record of its receivers, so the send path never has to ask the
+// ESP-NOW driver who is registered. Entries live in a dense array indexed by node
+// ID, so count, iteration and lookup by ID are O(1); a small open-addressed hash
+// maps MACs to entries. Entries are never removed: a MAC keeps its node ID until
+// the sender reboots. Not thread-safe, owned by the sender's reactor task.
+class PeerRegistry {
+public:
+    // Entry for `mac`, added with the next node ID if it is new. nullptr when full.
+    static PeerEntry *add(const uint8_t *mac, bool &created);
+    static PeerEntry *find(const uint8_t *mac);
+    static PeerEntry *find(NodeId node_id);
+
+    static size_t size() { return count; }
+    static bool empty() { return count == 0; }
+    static PeerEntry *begin() { return entries; }
+    static PeerEntry *end() { return entries + count; }
+
+private:
+    static size_t slotFor(const uint8_t *mac);
+
+    static PeerEntry entries[PEER_REGISTRY_CAPACITY];
+    static size_t count;
+};
+
+#endif // PEER_REGISTRY_H
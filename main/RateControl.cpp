@@ -0,0 +1,250 @@
+#include "RateControl.h"
+
+#if ENABLE_RATE_CONTROL
+
+#include "Manager.h"
+#include "Messages.h"
+#include "PeerRegistry.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_now.h"
+#include "esp_random.h"
+#include "esp_wifi_types.h"
+#include "freertos/FreeRTOS.h"
+#include <cstring>
+
+static const char *TAG = "RateControl";
+
+struct RateInfo {
+    wifi_phy_mode_t mode;
+    wifi_phy_rate_t rate;
+    uint32_t kbps;
+    int8_t sensitivity_dbm; // Typical ESP32-C6 receiver sensitivity
+    const char *name;
+};
+
+// Slowest first
+static const RateInfo rates[] = {
+#if CONFIG_ESPNOW_ENABLE_LONG_RANGE
+    {WIFI_PHY_MODE_LR, WIFI_PHY_RATE_LORA_250K, 250, -105, "LR250K"},
+    {WIFI_PHY_MODE_LR, WIFI_PHY_RATE_LORA_500K, 500, -102, "LR500K"},
+#endif
+    {WIFI_PHY_MODE_11B, WIFI_PHY_RATE_1M_L, 1000, -98, "1M"},
+    {WIFI_PHY_MODE_11B, WIFI_PHY_RATE_2M_L, 2000, -95, "2M"},
+    {WIFI_PHY_MODE_11G, WIFI_PHY_RATE_6M, 6000, -92, "6M"},
+    {WIFI_PHY_MODE_11B, WIFI_PHY_RATE_11M_L, 11000, -88, "11M"},
+    {WIFI_PHY_MODE_11G, WIFI_PHY_RATE_12M, 12000, -88, "12M"},
+    {WIFI_PHY_MODE_11G, WIFI_PHY_RATE_24M, 24000, -84, "24M"},
+    {WIFI_PHY_MODE_HT20, WIFI_PHY_RATE_MCS3_LGI, 26000, -82, "MCS3"},
+    {WIFI_PHY_MODE_HT20, WIFI_PHY_RATE_MCS5_LGI, 52000, -76, "MCS5"},
+    {WIFI_PHY_MODE_HT20, WIFI_PHY_RATE_MCS7_LGI, 65000, -72, "MCS7"},
+};
+#define RATE_COUNT (sizeof(rates) / sizeof(rates[0]))
+#define RATE_BASE 0 // Reaches the furthest
+#define RATE_NONE 0xFF
+
+// A rate whose delivery probability falls below this is abandoned for the next slower one
+#define RATE_FALLBACK_PERMILLE 500
+
+struct RateStats {
+    uint16_t attempts;  // Since the last fold into prob_permille
+    uint16_t successes;
+    uint16_t prob_permille;
+    bool measured;      // prob_permille holds at least one fold
+};
+
+struct PeerRates {
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    bool in_use;
+    uint8_t applied;     // Rate the driver is configured with, RATE_NONE before the first frame
+    uint8_t frames;      // Counts towards the next sampling frame
+    RateStats stats[RATE_COUNT];
+};
+
+static PeerRates peers[ESPNOW_PEER_CACHE_SIZE]; // One per ESP-NOW peer slot
+static portMUX_TYPE statsLock = portMUX_INITIALIZER_UNLOCKED; // Outcomes arrive on the Wi-Fi task
+static uint8_t broadcastRate = RATE_BASE;
+static uint8_t minFleetRssi = 0; // Magnitude of the weakest reported RSSI, for the log
+
+static PeerRates *findPeer(const uint8_t *mac) {
+    for (PeerRates &peer : peers) {
+        if (peer.in_use && std::memcmp(peer.mac, mac, ESP_NOW_ETH_ALEN) == 0) {
+            return &peer;
+        }
+    }
+    return nullptr;
+}
+
+// Fastest rate that a link at `rssi` should carry with the margin to spare
+static uint8_t rateForRssi(int8_t rssi) {
+    uint8_t best = RATE_BASE;
+    for (uint8_t i = 0; i < RATE_COUNT; i++) {
+        if (rates[i].sensitivity_dbm + RATE_BROADCAST_MARGIN_DB <= rssi && rates[i].kbps > rates[best].kbps) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+static bool applyRate(const uint8_t *mac, uint8_t index) {
+    esp_now_rate_config_t config = {};
+    config.phymode = rates[index].mode;
+    config.rate = rates[index].rate;
+    esp_err_t err = esp_now_set_peer_rate_config(mac, &config);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set rate %s for MAC=" MACSTR ": %s", rates[index].name, MAC2STR(mac), esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+static uint32_t expectedKbps(const RateStats &stats, uint8_t index) {
+    return stats.measured ? rates[index].kbps * stats.prob_permille / 1000 : 0;
+}
+
+// Pick the rate for the next frame. Called with statsLock held.
+static uint8_t chooseRate(PeerRates &peer) {
+    uint8_t best = RATE_NONE;
+    for (uint8_t i = 0; i < RATE_COUNT; i++) {
+        RateStats &stats = peer.stats[i];
+        if (stats.attempts >= RATE_MIN_ATTEMPTS) {
+            uint16_t prob = stats.successes * 1000 / stats.attempts;
+            stats.prob_permille = stats.measured
+                                      ? (prob * RATE_EWMA_PERCENT + stats.prob_permille * (100 - RATE_EWMA_PERCENT)) / 100
+                                      : prob;
+            stats.measured = true;
+            stats.attempts = 0;
+            stats.successes = 0;
+        }
+        if (stats.measured && (best == RATE_NONE || expectedKbps(stats, i) > expectedKbps(peer.stats[best], best))) {
+            best = i;
+        }
+    }
+    if (best == RATE_NONE) {
+        return peer.applied;
+    }
+
+    // Step down past a failing rate, even when nothing slower has been measured
+    if (peer.stats[best].prob_permille < RATE_FALLBACK_PERMILLE && best > 0 && !peer.stats[best - 1].measured) {
+        return best - 1;
+    }
+
+    // Now and then try a faster rate that could beat the best one
+    if (++peer.frames >= RATE_SAMPLE_EVERY && best + 1 < static_cast<int>(RATE_COUNT)) {
+        peer.frames = 0;
+        uint8_t candidate = best + 1 + esp_random() % (RATE_COUNT - best - 1);
+        if (rates[candidate].kbps > expectedKbps(peer.stats[best], best)) {
+            return candidate;
+        }
+    }
+    return best;
+}
+
+void RateControl::beforeSend(const uint8_t *mac, int8_t rssi_hint) {
+    PeerRates *peer = findPeer(mac);
+    if (!peer) {
+        for (PeerRates &candidate : peers) {
+            if (!candidate.in_use) {
+                peer = &candidate;
+                break;
+            }
+        }
+        if (!peer) {
+            return; // More peers than ESP-NOW slots; forget() keeps this from happening
+        }
+        taskENTER_CRITICAL(&statsLock);
+        *peer = {};
+        std::memcpy(peer->mac, mac, ESP_NOW_ETH_ALEN);
+        peer->applied = RATE_NONE;
+        peer->in_use = true;
+        taskEXIT_CRITICAL(&statsLock);
+    }
+
+    taskENTER_CRITICAL(&statsLock);
+    uint8_t rate = peer->applied == RATE_NONE ? rateForRssi(rssi_hint ? rssi_hint : INT8_MIN) : chooseRate(*peer);
+    bool changed = rate != peer->applied;
+    taskEXIT_CRITICAL(&statsLock);
+
+    // Outcomes are credited to the applied rate, so only record it once the driver has it
+    if (changed && applyRate(mac, rate)) {
+        taskENTER_CRITICAL(&statsLock);
+        peer->applied = rate;
+        taskEXIT_CRITICAL(&statsLock);
+    }
+}
+
+void RateControl::recordOutcome(const uint8_t *mac, bool acked) {
+    if (IS_BROADCAST_ADDR(mac)) {
+        return;
+    }
+    taskENTER_CRITICAL(&statsLock);
+    PeerRates *peer = findPeer(mac);
+    if (peer && peer->applied != RATE_NONE) {
+        RateStats &stats = peer->stats[peer->applied];
+        if (stats.attempts < UINT16_MAX) {
+            stats.attempts++;
+            stats.successes += acked ? 1 : 0;
+        }
+    }
+    taskEXIT_CRITICAL(&statsLock);
+}
+
+void RateControl::forget(const uint8_t *mac) {
+    taskENTER_CRITICAL(&statsLock);
+    if (PeerRates *peer = findPeer(mac)) {
+        peer->in_use = false;
+    }
+    taskEXIT_CRITICAL(&statsLock);
+}
+
+#if ENABLE_TELEMETRY
+void RateControl::updateBroadcast(const PeerEntry *begin, const PeerEntry *end, uint32_t fleet_loss_permille) {
+    // A node that has not reported could be anywhere, so it holds the fleet at the base rate
+    int8_t weakest = INT8_MAX;
+    for (const PeerEntry *peer = begin; peer != end; ++peer) {
+        int32_t rssi = peer->telemetry.reported ? peer->telemetry.values[TELEMETRY_RSSI] : INT8_MIN;
+        if (rssi < weakest) {
+            weakest = rssi;
+        }
+    }
+    if (begin == end) {
+        return;
+    }
+
+    uint8_t target = rateForRssi(weakest);
+    if (fleet_loss_permille > RATE_BROADCAST_LOSS_PERMILLE && broadcastRate > RATE_BASE && target >= broadcastRate) {
+        target = broadcastRate - 1;
+    } else if (target > broadcastRate + 1) {
+        target = broadcastRate + 1;
+    }
+    minFleetRssi = static_cast<uint8_t>(-weakest);
+
+    if (target != broadcastRate && applyRate(broadcastMac, target)) {
+        ESP_LOGI(TAG, "Broadcast rate %s -> %s (weakest node %d dBm, fleet loss %lu permille)", rates[broadcastRate].name,
+                 rates[target].name, weakest, static_cast<unsigned long>(fleet_loss_permille));
+        broadcastRate = target;
+    }
+}
+#endif
+
+// Airtime of a frame of `len` bytes, preamble included
+static uint32_t airtimeUs(uint8_t index, size_t len) {
+    uint32_t preambleUs = rates[index].mode == WIFI_PHY_MODE_11B ? 192 : rates[index].mode == WIFI_PHY_MODE_LR ? 400 : 20;
+    return preambleUs + len * 8 * 1000 / rates[index].kbps;
+}
+
+void RateControl::logRates() {
+    ESP_LOGI(TAG, "Broadcast at %s (weakest node -%u dBm): %lu us per full frame, %lu us at %s", rates[broadcastRate].name,
+             minFleetRssi, static_cast<unsigned long>(airtimeUs(broadcastRate, ESP_NOW_MAX_DATA_LEN)),
+             static_cast<unsigned long>(airtimeUs(RATE_BASE, ESP_NOW_MAX_DATA_LEN)), rates[RATE_BASE].name);
+    for (const PeerRates &peer : peers) {
+        if (!peer.in_use || peer.applied == RATE_NONE) {
+            continue;
+        }
+        const RateStats &stats = peer.stats[peer.applied];
+        ESP_LOGI(TAG, "  MAC=" MACSTR " at %s, delivery %u permille", MAC2STR(peer.mac), rates[peer.applied].name,
+                 stats.measured ? stats.prob_permille : 0);
+    }
+}
+
+#endif // ENABLE_RATE_CONTROL
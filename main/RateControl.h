@@ -0,0 +1,46 @@
+#ifndef RATE_CONTROL_H
+#define RATE_CONTROL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "config.h"
+
+#if ENABLE_RATE_CONTROL
+
+struct PeerEntry;
+
+// PHY rate selection for the sender, which otherwise sends everything at ESP-NOW's
+// default 1 Mbit/s. Nearby boards can take far faster rates, which cuts airtime.
+//
+// Unicast peers get a Minstrel-style controller. Send-callback results give each
+// rate an EWMA delivery probability, and the peer uses the rate with the best
+// expected throughput (probability times nominal rate). Every RATE_SAMPLE_EVERY-th
+// frame tries a faster rate that might beat it. When the current rate's probability
+// collapses, the peer falls back to the next slower rate, so a rate that stopped
+// working is not kept just because nothing slower has been measured.
+//
+// Broadcasts get no acknowledgements, so the fleet's rate comes from the RSSI each
+// receiver reports in its telemetry. It is the fastest rate whose sensitivity, plus
+// RATE_BROADCAST_MARGIN_DB, is met by the weakest node. High fleet loss steps the
+// rate down. Rising is limited to one step per fleet summary.
+class RateControl {
+public:
+    // Reactor: choose and apply the rate for the next unicast frame to `mac`.
+    // `rssi_hint` (0 if unknown) seeds the first choice for a new peer.
+    static void beforeSend(const uint8_t *mac, int8_t rssi_hint);
+    // Wi-Fi task: delivery result of a unicast frame to `mac`
+    static void recordOutcome(const uint8_t *mac, bool acked);
+    // Reactor: `mac` lost its ESP-NOW peer slot
+    static void forget(const uint8_t *mac);
+
+#if ENABLE_TELEMETRY
+    // Reactor: re-pick the broadcast rate from the peers' reported RSSI
+    static void updateBroadcast(const PeerEntry *begin, const PeerEntry *end, uint32_t fleet_loss_permille);
+#endif
+
+    static void logRates();
+};
+
+#endif // ENABLE_RATE_CONTROL
+
+#endif // RATE_CONTROL_H
@@ -2,154 +2,517 @@
 #include "Messages.h"
 #include "Manager.h"
 #include "config.h"
+#include "Metrics.h"
+#include "Latency.h"
+#include "Telemetry.h"
+#include "DeferredLog.h"
+#include "Pairing.h"
+#include "BootProfiler.h"
+#include "Relay.h"
+#include "Auth.h"
+#include "FrameTrace.h"
+#include "WakeSchedule.h"
+#include "Tdma.h"
+#include "ShowState.h"
+#include "RecvHandoff.h"
+#include "esp_timer.h"
 #include "esp_log.h"
 #include "esp_now.h"
 #include "esp_mac.h"
 #include "esp_crc.h"
 #include "esp_random.h"
+#include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/timers.h"
 #include <cstring>
 #include <cstdlib>
+#include <cstddef>
 #include "freertos/queue.h"
 #include <vector>
 #include <memory>
 #include <new>
 #include <unordered_map>
+#include <atomic>
 
 static const char *TAG = "Receiver";
 
-// receiveQueue expects a MessageEnvelope
-static QueueHandle_t receiveQueue = nullptr;
+static RecvHandoff receivedFrames(DLOG_RECEIVER_QUEUE_FAILED, DLOG_RECEIVER_QUEUE_HIGH_WATER);
+static TaskHandle_t recvLoopTask = nullptr;
+// recvLoop's notification bits. Timers only set a bit: the work runs on recvLoop,
+// which owns senderMac and has the stack for a whole frame.
+#define RECV_EVENT_FRAME (1 << 0)     // A frame landed in the empty receive ring
+#define RECV_EVENT_TELEMETRY (1 << 1) // A telemetry report is due
+#define RECV_EVENT_STATE_REQUEST (1 << 2) // Time to ask the sender for missed show state
+#define RECV_EVENT_CHANNEL_SWITCH (1 << 3) // The sender's announced channel switch is due
+#define RECV_EVENT_SCAN_DONE (1 << 4)      // broadcastRegistration stopped hopping channels
 std::unordered_map<std::string, uint16_t> Receiver::peerLastSequenceNumbers; // Last received sequence numbers per peer
 bool volatile Receiver::isRegistered = false; // Registration status
-static uint32_t lastKeepaliveTime = 0; // Track the last keepalive time
+static TimerHandle_t keepaliveTimer = nullptr; // One-shot, re-armed by every valid frame from the sender
+static uint8_t senderMac[ESP_NOW_ETH_ALEN] = {0}; // Source of the last valid frame, used for replies
+static std::atomic<uint16_t> uplinkSequenceNumber{0}; // Sequence number for frames we send to the sender
+static std::atomic<NodeId> nodeId{NODE_ID_NONE}; // Assigned by the sender at registration
+static std::atomic<GroupMask> groupMask{0}; // Assigned by the sender with GroupAssign
+static uint8_t ownMac[ESP_NOW_ETH_ALEN] = {0}; // Looked up in RegistrationBatch acknowledgements
+#if ENABLE_CHANNEL_AGILITY
+static TimerHandle_t channelSwitchTimer = nullptr; // One-shot, armed by ChannelSwitch announcements
+static uint8_t pendingChannel = 0; // Channel announced by the sender
+static uint8_t scanStartChannel = 0;    // Where broadcastRegistration started hopping from
+static uint8_t registrationChannel = 0; // Channel the last registration ack arrived on
+#define REGISTRATION_SCAN_CHANNELS (ESPNOW_CHANNEL_MAX - ESPNOW_CHANNEL_MIN + 1)
+#else
+#define REGISTRATION_SCAN_CHANNELS 1
+#endif
+#if ENABLE_SHOW_STATE
+static TimerHandle_t stateRequestTimer = nullptr; // One-shot, armed while we are behind the sender's show state
+static uint16_t advertisedEpoch = 0;  // Newest show state version the sender announced
+static uint32_t advertisedVersion = 0;
+#endif
+Receiver::Subscription Receiver::subscriptions[static_cast<size_t>(PayloadType::Count)] = {};
+static portMUX_TYPE subscriptionLock = portMUX_INITIALIZER_UNLOCKED; // Subscribers may come and go while frames arrive
+#if ENABLE_TELEMETRY
+static TimerHandle_t telemetryTimer = nullptr;
+static uint32_t telemetryIntervalMs = TELEMETRY_MIN_INTERVAL_MS; // Mean interval, updated by TelemetryConfig
+#endif
 
 void Receiver::init() {
     esp_log_level_set(TAG, RECEIVER_LOG_LEVEL);
     ESP_LOGI(TAG, "Initializing ESPNOW Receiver");
 
-    // Create a queue for MessageEnvelope.
-    receiveQueue = xQueueCreate(ESPNOW_QUEUE_SIZE, sizeof(MessageEnvelope));
-    if (!receiveQueue) {
+    if (!receivedFrames.init(RECV_HANDOFF_POLICY)) {
         ESP_LOGE(TAG, "Failed to create receive queue");
         return;
     }
 
+    esp_wifi_get_mac(static_cast<wifi_interface_t>(ESPNOW_WIFI_IF), ownMac);
+#if ENABLE_AUTH
+    Auth::restoreWindows();
+#endif
+#if ENABLE_RELAY
+    Relay::init();
+#endif
+#if ENABLE_TDMA
+    Tdma::init();
+#endif
+
+    // The receiver's own share of the protocol, handled like any subscriber's
+    subscribe<PayloadType::Keepalive>(onKeepalive);
+    subscribe<PayloadType::GroupAssign>(onGroupAssign);
+#if ENABLE_TELEMETRY
+    subscribe<PayloadType::TelemetryConfig>(onTelemetryConfig);
+#endif
+#if ENABLE_LATENCY_TRACING
+    subscribe<PayloadType::LatencyReportRequest>(onLatencyReportRequest);
+#endif
+#if ENABLE_TDMA
+    subscribe<PayloadType::TdmaBeacon>(onTdmaBeacon);
+#endif
+#if ENABLE_CHANNEL_AGILITY
+    subscribe<PayloadType::ChannelSwitch>(onChannelSwitch);
+#endif
+#if ENABLE_SHOW_STATE
+    subscribe<PayloadType::StateDelta>(onStateDelta);
+#endif
+
+    keepaliveTimer = xTimerCreate("keepalive", pdMS_TO_TICKS(ESPNOW_KEEPALIVE_TIMEOUT_MS), pdFALSE, nullptr, keepaliveTimeout);
+    if (!keepaliveTimer) {
+        ESP_LOGE(TAG, "Failed to create keepalive timer");
+        return;
+    }
+
+#if ENABLE_CHANNEL_AGILITY
+    channelSwitchTimer = xTimerCreate("channelSwitch", 1, pdFALSE, nullptr, channelSwitchTimeout);
+    if (!channelSwitchTimer) {
+        ESP_LOGE(TAG, "Failed to create channel switch timer");
+        return;
+    }
+#endif
+
+#if ENABLE_SHOW_STATE
+    stateRequestTimer = xTimerCreate("stateRequest", 1, pdFALSE, nullptr, stateRequestTimeout);
+    if (!stateRequestTimer) {
+        ESP_LOGE(TAG, "Failed to create state request timer");
+        return;
+    }
+#endif
+
+#if USE_POINT_TO_POINT
+    bool resumed = false;
+#endif
+#if USE_POINT_TO_POINT && ENABLE_PAIRING_PERSISTENCE
+    ReceiverPairing pairing;
+    if (Pairing::loadReceiver(pairing)) {
+        // Pick the saved session back up. If the sender stays silent, the keepalive
+        // timeout falls back to broadcast registration as usual.
+        std::memcpy(senderMac, pairing.sender_mac, ESP_NOW_ETH_ALEN);
+        nodeId = pairing.node_id;
+        groupMask = pairing.groups;
+#if ENABLE_TELEMETRY
+        if (pairing.telemetry_interval_s > 0) {
+            telemetryIntervalMs = pairing.telemetry_interval_s * 1000;
+        }
+#endif
+        isRegistered = true;
+        xTimerStart(keepaliveTimer, 0);
+        resumed = true;
+        ESP_LOGI(TAG, "Resuming pairing with sender MAC= " MACSTR " as node %u",
+                 MAC2STR(pairing.sender_mac), pairing.node_id);
+    }
+#endif
+
     ESP_LOGI(TAG, "ESPNOW initialized successfully");
 
     // Register receive callback
     ESP_ERROR_CHECK( esp_now_register_recv_cb(recvCallback) );
 
     ESP_LOGI(TAG, "Receive callback registered successfully");
+#if ENABLE_FRAME_TRACE
+    FrameTrace::init(recvCallback);
+#endif
 
     // Increase stack size for recvLoop task
-    xTaskCreate(recvLoop, "recvLoop", 4096, nullptr, 4, nullptr);
+    xTaskCreate(recvLoop, "recvLoop", 4096, nullptr, 4, &recvLoopTask);
+    Metrics::registerTask(recvLoopTask, "recvLoop");
+    Metrics::registerQueue([] { return receivedFrames.depth(); }, "receive");
     ESP_LOGI(TAG, "Receive loop task started");
 
+#if ENABLE_TELEMETRY
+    // After recvLoop exists, since the timer only notifies it
+    telemetryTimer = xTimerCreate("telemetry", pdMS_TO_TICKS(nextTelemetryDelayMs()), pdFALSE, nullptr, telemetryTimeout);
+    if (!telemetryTimer || xTimerStart(telemetryTimer, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start telemetry timer");
+    }
+#endif
+
 #if USE_POINT_TO_POINT
     // Start the broadcast registration task
-    xTaskCreate(broadcastRegistration, "broadcastRegistration", 2048, nullptr, 4, nullptr);
+    if (!resumed) {
+        xTaskCreate(broadcastRegistration, "broadcastRegistration", 2048, nullptr, 4, nullptr);
+    }
 #endif
-
-    // Start the keepalive monitoring task
-    xTaskCreate(checkKeepalive, "checkKeepalive", 2048, nullptr, 2, nullptr);
 }
 
+// Runs on the Wi-Fi task: no formatted logging here, only DLOG records
 void Receiver::recvCallback(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
     if (!recv_info || !data || len <= 0) {
-        ESP_LOGE(TAG, "Receive callback error: invalid arguments (recv_info=%p, data=%p, len=%d)", recv_info, data, len);
+        DLOGE(DLOG_RECEIVER_RECV_CB_INVALID, len);
         return;
     }
 
     if (len > ESP_NOW_MAX_DATA_LEN_V2) { // Use the maximum allowed data length
-        ESP_LOGE(TAG, "Received data length exceeds buffer size: len=%d", len);
+        DLOGE(DLOG_RECEIVER_RECV_TOO_LONG, len);
         return;
     }
 
-    ESP_LOGI(TAG, "Received ESPNOW data from MAC= " MACSTR ", len=%d",
-             MAC2STR(recv_info->src_addr), len);
+    int8_t rssi = recv_info->rx_ctrl ? recv_info->rx_ctrl->rssi : 0;
+    DLOGD(DLOG_RECEIVER_RECV_CB, MAC2STR(recv_info->src_addr), len, rssi);
+
+    bool broadcast = recv_info->des_addr && IS_BROADCAST_ADDR(recv_info->des_addr);
+#if ENABLE_FRAME_TRACE
+    FrameTrace::record(FRAME_TRACE_RX | (broadcast ? FRAME_TRACE_BROADCAST : 0), recv_info->src_addr, rssi, data, len);
+#endif
+#if ENABLE_RELAY
+    // Before the destination filter, so frames for other nodes are still relayed
+    if (broadcast && !Relay::admit(data, len)) {
+        return; // Already heard, directly or through another relay
+    }
+#endif
+
+    // Relayed frames are attributed to the sender that built them, not the relay
+    const uint8_t *source = recv_info->src_addr;
+    if (len >= static_cast<int>(sizeof(MessageData)) &&
+        (reinterpret_cast<const MessageData *>(data)->flags & MESSAGE_FLAG_RELAY)) {
+        uint8_t flags = reinterpret_cast<const MessageData *>(data)->flags;
+        size_t offset = messageExtensionOffset(flags, MESSAGE_FLAG_RELAY);
+        if (static_cast<size_t>(len) < offset + sizeof(RelayExtension)) {
+            return;
+        }
+        source = data + offset + offsetof(RelayExtension, origin);
+    }
+
+    // Broadcast frames addressed to other nodes or groups are dropped here, before any copy
+    if (broadcast && len >= static_cast<int>(sizeof(MessageData)) &&
+        !frameAddressedTo(data, len, nodeId.load(std::memory_order_relaxed), groupMask.load(std::memory_order_relaxed))) {
+        return;
+    }
 
-    // Create a MessageEnvelope object with the correct data length
-    MessageEnvelope *receivedEnvelope = new MessageEnvelope(len);
+    // Never blocks: a full ring drops a frame rather than stalling the Wi-Fi task
+    MessageEnvelope *receivedEnvelope = receivedFrames.beginPush(source);
     if (!receivedEnvelope) {
-        ESP_LOGE(TAG, "Failed to allocate memory for MessageEnvelope");
         return;
     }
 
-    std::memcpy(receivedEnvelope->src_mac, recv_info->src_addr, ESP_NOW_ETH_ALEN);
+    std::memcpy(receivedEnvelope->src_mac, source, ESP_NOW_ETH_ALEN);
     std::memcpy(receivedEnvelope->data, data, len);
-
-    // Send the message to the queue
-    if (xQueueSend(receiveQueue, &receivedEnvelope, portMAX_DELAY) != pdTRUE) {
-        ESP_LOGE(TAG, "Failed to queue received message");
-        delete receivedEnvelope;
+    receivedEnvelope->data_len = len;
+    receivedEnvelope->rssi = rssi;
+    receivedEnvelope->broadcast = broadcast;
+#if ENABLE_LATENCY_TRACING || ENABLE_TDMA
+    receivedEnvelope->rx_time_us = static_cast<uint32_t>(esp_timer_get_time());
+#endif
+#if ENABLE_CHANNEL_AGILITY
+    receivedEnvelope->channel = recv_info->rx_ctrl ? recv_info->rx_ctrl->channel : 0;
+#endif
+#if ENABLE_WAKE_ALIGNMENT
+    // A relayed copy shows when the relay sent it, not when our window let it in
+    receivedEnvelope->wake_phase_ms = WAKE_PHASE_UNKNOWN;
+    if (source == recv_info->src_addr && len >= static_cast<int>(sizeof(MessageData))) {
+        uint8_t flags = reinterpret_cast<const MessageData *>(data)->flags;
+        size_t offset = messageExtensionOffset(flags, MESSAGE_FLAG_WAKE_PHASE);
+        if ((flags & MESSAGE_FLAG_WAKE_PHASE) && static_cast<size_t>(len) >= offset + sizeof(WakePhaseExtension)) {
+            WakePhaseExtension wake;
+            std::memcpy(&wake, data + offset, sizeof(wake));
+            receivedEnvelope->wake_phase_ms = wake.phase_ms;
+        }
     }
+#endif
+
+    receivedFrames.commitPush();
 }
 
 void Receiver::recvLoop(void *pvParameter) {
     ESP_LOGI(TAG, "Receive loop task started");
 
+    receivedFrames.setConsumer(xTaskGetCurrentTaskHandle(), RECV_EVENT_FRAME);
     while (true) {
-        MessageEnvelope *recvMsg;
-        if (xQueueReceive(receiveQueue, &recvMsg, portMAX_DELAY) == pdTRUE) {
-            ESP_LOGI(TAG, "Processing received data from MAC= " MACSTR ", len=%d",
-                     MAC2STR(recvMsg->src_mac), recvMsg->data_len);
-
-            // Create a new Message object
-            Message* message = new Message();
-            if (!message) {
-                ESP_LOGE(TAG, "Failed to allocate memory for Message");
-                delete recvMsg; // Free the received message
-                continue;
-            }
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+#if ENABLE_TELEMETRY
+        if (events & RECV_EVENT_TELEMETRY) {
+            sendTelemetry();
+        }
+#endif
+#if ENABLE_SHOW_STATE
+        if (events & RECV_EVENT_STATE_REQUEST) {
+            requestState();
+        }
+#endif
+#if ENABLE_CHANNEL_AGILITY
+        // Switching saves the channel to NVS, which needs recvLoop's stack
+        if (events & RECV_EVENT_CHANNEL_SWITCH) {
+            applyChannelSwitch();
+        }
+        if (events & RECV_EVENT_SCAN_DONE) {
+            settleRegistrationChannel();
+        }
+#endif
 
-            // Set the message type based on the received MAC address
-            message->type = IS_BROADCAST_ADDR(recvMsg->src_mac) ? ESPNOW_DATA_BROADCAST : ESPNOW_DATA_UNICAST;
+        drainReceivedFrames();
+    }
+}
 
-            // Parse the received data
-            int type = parseESPNOWData(recvMsg->data, recvMsg->data_len, recvMsg->src_mac, message);
-            if (type < 0) {
-                ESP_LOGE(TAG, "Failed to parse ESPNOW data");
-                delete message;
-                delete recvMsg; // Free the received message
-                continue;
-            }
+// Drain the ring before sleeping: only a frame landing in an empty ring notifies us
+void Receiver::drainReceivedFrames() {
+    while (MessageEnvelope *recvMsg = receivedFrames.front()) {
+        processFrame(*recvMsg);
+        receivedFrames.release();
+    }
+}
 
-            if (message->payload_type == PayloadType::RegisterRequest) {
-                // Handle registration request
-                ESP_LOGI(TAG, "Received registration request from MAC= " MACSTR,
-                         MAC2STR(recvMsg->src_mac));
-                isRegistered = true; // Set registration status
-            }
+// Parsed where it lies in the ring; recvLoop releases the slot afterwards
+void Receiver::processFrame(const MessageEnvelope &recvMsg) {
+#if ENABLE_TELEMETRY
+    Telemetry::recordQueueDepth(receivedFrames.depth());
+#endif
+    if (uint32_t dropped = receivedFrames.takeDropped()) {
+        ESP_LOGW(TAG, "Receive queue full: %lu frames dropped", static_cast<unsigned long>(dropped));
+    }
+    ESP_LOGD(TAG, "Processing received data from MAC= " MACSTR ", len=%d",
+             MAC2STR(recvMsg.src_mac), recvMsg.data_len);
 
-            if (message->payload_type == PayloadType::Keepalive) {
-                ESP_LOGD(TAG, "Received keepalive message from MAC= " MACSTR, MAC2STR(recvMsg->src_mac));
-                lastKeepaliveTime = xTaskGetTickCount() * portTICK_PERIOD_MS; // Update the last keepalive time
-                delete message; // No further processing needed for keepalive
-                delete recvMsg;
-                continue;
-            }
+    // Validated where it lies in the slot; nothing is copied out of the frame
+    int type = parseESPNOWData(recvMsg.data, recvMsg.data_len, recvMsg.src_mac);
+    if (type < 0) {
+        ESP_LOGE(TAG, "Failed to parse ESPNOW data");
+        return;
+    }
+    PayloadType payloadType = static_cast<PayloadType>(type);
+
+    std::memcpy(senderMac, recvMsg.src_mac, ESP_NOW_ETH_ALEN);
+    if (payloadType == PayloadType::RegistrationSuccessful || payloadType == PayloadType::RegistrationBatch) {
+        // A batch that does not list us yields NODE_ID_NONE
+        NodeId registeredId = registrationNodeId(payloadType, recvMsg.data, recvMsg.data_len);
+        if (registeredId != NODE_ID_NONE) {
+            nodeId = registeredId;
+            ESP_LOGI(TAG, "Registered with sender MAC= " MACSTR " as node %u",
+                     MAC2STR(recvMsg.src_mac), registeredId);
+            isRegistered = true; // Set registration status
+            resetSequenceTracking(recvMsg.src_mac);
+#if ENABLE_CHANNEL_AGILITY
+            // broadcastRegistration may have hopped on by the time we get here
+            registrationChannel = recvMsg.channel;
+#endif
+#if ENABLE_PAIRING_PERSISTENCE
+            savePairing();
+#endif
+#if ENABLE_WAKE_ALIGNMENT
+            // The sender may have rebooted and forgotten our window
+            WakeSchedule::resetReport();
+#endif
+        }
+    }
 
-            if (!isRegistered && message->type == ESPNOW_DATA_UNICAST) {
-                ESP_LOGI(TAG, "Received unicast message, setting isRegistered to true");
-                isRegistered = true;
+#if ENABLE_WAKE_ALIGNMENT
+    if (recvMsg.wake_phase_ms != WAKE_PHASE_UNKNOWN) {
+        WakeSchedule::recordPhase(recvMsg.wake_phase_ms);
+        uint16_t windowStartMs;
+        if (isRegistered && WakeSchedule::reportDue(windowStartMs)) {
+            ESP_LOGI(TAG, "Wake window opens %u ms into the sender's cycle", windowStartMs);
+            WakePhasePayload wake = {windowStartMs};
+            if (sendToSender(PayloadType::WakePhase, reinterpret_cast<const uint8_t *>(&wake), sizeof(wake)) != ESP_OK) {
+                WakeSchedule::resetReport(); // Try again with the next frame
             }
+        }
+    }
+#endif
 
-            // TODO: Process the parsed message
-            ESP_LOGI(TAG, "Parsed ESPNOW message: type=%d",
-                     static_cast<int>(message->payload_type));
+    // Any valid frame from the sender counts as a keepalive
+    if (isRegistered) {
+        xTimerReset(keepaliveTimer, 0);
+    }
+#if ENABLE_TELEMETRY
+    Telemetry::recordFrame(recvMsg.rssi);
+#endif
+#if ENABLE_LATENCY_TRACING
+    const MessageData *rawMessage = reinterpret_cast<const MessageData *>(recvMsg.data);
+    if (rawMessage->flags & MESSAGE_FLAG_TRACE) {
+        TraceExtension trace;
+        std::memcpy(&trace, rawMessage->payload, sizeof(trace));
+        LatencyTracer::recordFrame(trace, recvMsg.rx_time_us, static_cast<uint32_t>(esp_timer_get_time()));
+    }
+#endif
 
-            // Free the allocated message and received message
-            delete message;
-            delete recvMsg;
-        }
+    dispatch(recvMsg, payloadType);
+}
+
+esp_err_t Receiver::addSubscription(PayloadType type, Invoker invoke, void (*handler)()) {
+    size_t index = static_cast<size_t>(type);
+    if (index >= static_cast<size_t>(PayloadType::Count) || !handler) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    taskENTER_CRITICAL(&subscriptionLock);
+    if (subscriptions[index].handler) {
+        err = ESP_ERR_INVALID_STATE;
+    } else {
+        subscriptions[index] = {invoke, handler};
+    }
+    taskEXIT_CRITICAL(&subscriptionLock);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Payload type %u already has a handler", static_cast<unsigned>(index));
+    }
+    return err;
+}
+
+void Receiver::unsubscribe(PayloadType type) {
+    size_t index = static_cast<size_t>(type);
+    if (index < static_cast<size_t>(PayloadType::Count)) {
+        taskENTER_CRITICAL(&subscriptionLock);
+        subscriptions[index] = {};
+        taskEXIT_CRITICAL(&subscriptionLock);
     }
 }
 
-int Receiver::parseESPNOWData(const uint8_t *data, uint16_t data_len, const uint8_t *src_addr, Message *message) {
-    if (!data || data_len < sizeof(MessageData) || !message) {
-        ESP_LOGE(TAG, "Received ESPNOW data too short, null, or invalid message pointer, len:%d", data_len);
+// One table lookup per frame. The entry is copied under the lock so a handler
+// subscribed or removed meanwhile is seen whole or not at all.
+void Receiver::dispatch(const MessageEnvelope &envelope, PayloadType type) {
+    size_t index = static_cast<size_t>(type);
+    if (index >= static_cast<size_t>(PayloadType::Count)) {
+        return;
+    }
+    taskENTER_CRITICAL(&subscriptionLock);
+    Subscription subscription = subscriptions[index];
+    taskEXIT_CRITICAL(&subscriptionLock);
+
+    if (type == PayloadType::ChangePattern || type == PayloadType::ChangeBrightness) {
+        BootProfiler::markFirstCommand();
+    }
+    if (!subscription.handler) {
+        ESP_LOGD(TAG, "Parsed ESPNOW message: type=%d, no handler", static_cast<int>(type));
+        return;
+    }
+
+    const MessageData *header = reinterpret_cast<const MessageData *>(envelope.data);
+    size_t headerLen = messageHeaderLength(header->flags);
+    ReceivedFrame frame = {envelope, *header, envelope.data + headerLen, envelope.data_len - headerLen};
+    subscription.invoke(subscription.handler, frame);
+}
+
+void Receiver::onKeepalive(const StateVersionPayload *advert, const ReceivedFrame &frame) {
+    ESP_LOGD(TAG, "Received keepalive message from MAC= " MACSTR, MAC2STR(frame.envelope.src_mac));
+#if ENABLE_SHOW_STATE
+    // Absent when the sender does not replicate show state
+    if (advert) {
+        noteStateVersion(*advert);
+    }
+#endif
+}
+
+void Receiver::onGroupAssign(const GroupAssignPayload &assign, const ReceivedFrame &frame) {
+    if (assign.groups != groupMask) {
+        groupMask = assign.groups;
+        ESP_LOGI(TAG, "Group membership set to 0x%08lx", static_cast<unsigned long>(assign.groups));
+#if ENABLE_PAIRING_PERSISTENCE
+        savePairing();
+#endif
+    }
+}
+
+#if ENABLE_TELEMETRY
+void Receiver::onTelemetryConfig(const TelemetryConfigPayload &config, const ReceivedFrame &frame) {
+    telemetryIntervalMs = config.interval_s * 1000;
+    ESP_LOGI(TAG, "Telemetry interval set to %u s", config.interval_s);
+#if ENABLE_PAIRING_PERSISTENCE
+    savePairing();
+#endif
+}
+#endif
+
+#if ENABLE_LATENCY_TRACING
+void Receiver::onLatencyReportRequest(PayloadBytes payload, const ReceivedFrame &frame) {
+    uint8_t report[ESP_NOW_MAX_DATA_LEN - sizeof(MessageData)];
+    size_t reportLen = LatencyTracer::encodeReport(report, sizeof(report));
+    if (reportLen > 0) {
+        sendToSender(PayloadType::LatencyReport, report, reportLen);
+    }
+}
+#endif
+
+#if ENABLE_TDMA
+void Receiver::onTdmaBeacon(const TdmaBeaconPayload &beacon, const ReceivedFrame &frame) {
+    // Slots are timed from when the beacon arrived, not when it was processed
+    int64_t now = esp_timer_get_time();
+    int64_t rxTime = now - static_cast<uint32_t>(static_cast<uint32_t>(now) - frame.envelope.rx_time_us);
+    Tdma::onBeacon(beacon, rxTime);
+}
+#endif
+
+#if ENABLE_CHANNEL_AGILITY
+void Receiver::onChannelSwitch(const ChannelSwitchPayload &announce, const ReceivedFrame &frame) {
+    // Every announcement carries the time left, so the latest one wins
+    TickType_t delay = pdMS_TO_TICKS(announce.switch_in_ms);
+    pendingChannel = announce.channel;
+    xTimerChangePeriod(channelSwitchTimer, delay > 0 ? delay : 1, 0);
+    ESP_LOGI(TAG, "Sender moving to channel %u in %u ms", announce.channel, announce.switch_in_ms);
+}
+#endif
+
+#if ENABLE_SHOW_STATE
+void Receiver::onStateDelta(PayloadBytes payload, const ReceivedFrame &frame) {
+    StateDeltaHeader delta;
+    std::memcpy(&delta, payload.data, sizeof(delta));
+    if (!ShowState::applyDelta(payload.data, payload.len)) {
+        ESP_LOGI(TAG, "Missed show state changes before version %lu", static_cast<unsigned long>(delta.base_version));
+    }
+    noteStateVersion({delta.epoch, delta.version});
+}
+#endif
+
+// Checks a frame without copying it: length for its payload type, CRC, auth tag and
+// sequence number. Returns the payload type, or -1 if the frame is to be dropped.
+int Receiver::parseESPNOWData(const uint8_t *data, uint16_t data_len, const uint8_t *src_addr) {
+    if (!data || data_len < sizeof(MessageData)) {
+        ESP_LOGE(TAG, "Received ESPNOW data too short or null, len:%d", data_len);
         return -1;
     }
 
@@ -162,7 +525,7 @@ int Receiver::parseESPNOWData(const uint8_t *data, uint16_t data_len, const uint
     size_t expectedPayloadSize = 0;
     switch (payloadType) {
         case PayloadType::ChangePattern:
-            expectedPayloadSize = sizeof(ChangePatternPayload);
+            expectedPayloadSize = 1; // The name's bytes, however short
             break;
         case PayloadType::ChangeBrightness:
             expectedPayloadSize = sizeof(ChangeBrightnessPayload);
@@ -170,113 +533,116 @@ int Receiver::parseESPNOWData(const uint8_t *data, uint16_t data_len, const uint
         case PayloadType::RegistrationSuccessful:
             expectedPayloadSize = sizeof(RegistrationSuccessfulPayload);
             break;
-        case PayloadType::Keepalive:
-            expectedPayloadSize = 0; // Keepalive has no additional payload
+        case PayloadType::Keepalive: // May carry a StateVersionPayload, which the handler checks for
+        case PayloadType::LatencyReportRequest:
+        case PayloadType::RegistrationBatch: // Variable length, checked entry by entry
+            expectedPayloadSize = 0; // No additional payload
+            break;
+        case PayloadType::TelemetryConfig:
+            expectedPayloadSize = sizeof(TelemetryConfigPayload);
+            break;
+        case PayloadType::ChannelSwitch:
+            expectedPayloadSize = sizeof(ChannelSwitchPayload);
+            break;
+        case PayloadType::TdmaBeacon:
+            expectedPayloadSize = sizeof(TdmaBeaconPayload);
+            break;
+        case PayloadType::GroupAssign:
+            expectedPayloadSize = sizeof(GroupAssignPayload);
+            break;
+        case PayloadType::StateDelta: // Field values follow, checked by ShowState
+            expectedPayloadSize = sizeof(StateDeltaHeader);
             break;
         default:
             ESP_LOGE(TAG, "Unhandled payload type in switch: %d", static_cast<int>(payloadType));
             return -1;
     }
 
-    // Populate the Message with the payload type
-    message->payload_type = payloadType;
+    // Header extensions sit between the fixed header and the payload
+    size_t headerLen = messageHeaderLength(rawMessage->flags);
 
     // Validate the total data length
-    if (data_len < sizeof(MessageData) + expectedPayloadSize) {
+    if (data_len < headerLen + expectedPayloadSize) {
         ESP_LOGE(TAG, "Data length is insufficient for payload type: %d", static_cast<int>(payloadType));
         return -1;
     }
 
-    // Allocate memory for messageCopy to include the payload
-    MessageData *messageCopy = reinterpret_cast<MessageData *>(malloc(data_len));
-    if (!messageCopy) {
-        ESP_LOGE(TAG, "Failed to allocate memory for messageCopy");
-        return -1;
-    }
-
-    // Copy the entire rawMessage (header + payload) into messageCopy
-    memcpy(messageCopy, rawMessage, data_len);
-
-    // Set the CRC field to 0 before calculating the CRC
-    messageCopy->crc = 0;
-
-    // Calculate CRC over the entire message, including the payload
-    uint16_t calculatedCrc = esp_crc16_le(UINT16_MAX, reinterpret_cast<const uint8_t *>(messageCopy), data_len);
-
-    // Free the allocated memory for messageCopy
-    free(messageCopy);
-
+    // Over the frame as it lies in the slot, with the crc field counted as zero
+    uint16_t calculatedCrc = computeMessageCrc(data, data_len);
     if (calculatedCrc != rawMessage->crc) {
         ESP_LOGE(TAG, "CRC mismatch: calculated %04X, received %04X", calculatedCrc, rawMessage->crc);
         return -1;
     }
 
-    // Check for sequence number wrap-around
-    std::string peerKey(reinterpret_cast<const char *>(src_addr), ESP_NOW_ETH_ALEN);
-    uint16_t lastSeqNum = peerLastSequenceNumbers[peerKey];
-
-    if ((rawMessage->seq_num > lastSeqNum) ||
-        (lastSeqNum > 200 && rawMessage->seq_num < 50)) { // Handle wrap-around
-        peerLastSequenceNumbers[peerKey] = rawMessage->seq_num;
-    } else {
-        ESP_LOGW(TAG, "Ignoring duplicate or out-of-order message: seq_num=%d, lastSeqNum=%d",
-                 rawMessage->seq_num, lastSeqNum);
-        return -1; // Ignore the message
+#if ENABLE_AUTH
+    // Before any sequence or registration state is touched
+    if (!Auth::verify(data, data_len, src_addr)) {
+        return -1;
     }
+#endif
 
-    // Set the message type based on the source address
-    message->type = IS_BROADCAST_ADDR(src_addr) ? ESPNOW_DATA_BROADCAST : ESPNOW_DATA_UNICAST;
-
-
-    // Parse the payload based on the payload type
-    size_t payloadSize = data_len - sizeof(MessageData);
-    switch (message->payload_type) {
-        case PayloadType::ChangePattern: {
-            if (payloadSize < sizeof(ChangePatternPayload)) {
-                ESP_LOGE(TAG, "Payload size mismatch for ChangePatternPayload");
-                return -1;
-            }
-            // Deserialize the payload properly
-            ChangePatternPayload payload;
-            std::string patternName(reinterpret_cast<const char *>(rawMessage->payload), payloadSize);
-            payload.patternName = patternName;
-            message->parsed_payload = payload;
-            break;
-        }
-        case PayloadType::ChangeBrightness: {
-            if (payloadSize < sizeof(ChangeBrightnessPayload)) {
-                ESP_LOGE(TAG, "Payload size mismatch for ChangeBrightnessPayload");
-                return -1;
-            }
-            ChangeBrightnessPayload payload;
-            std::memcpy(&payload, rawMessage->payload, sizeof(ChangeBrightnessPayload));
-            message->parsed_payload = payload;
-            break;
+    // Registration acknowledgements are idempotent and restart the sender's numbering
+    // (it may have rebooted), so they skip the duplicate check
+    bool registrationAck = payloadType == PayloadType::RegistrationSuccessful ||
+                           payloadType == PayloadType::RegistrationBatch;
+    if (!registrationAck) {
+        // Check for sequence number wrap-around. Frames addressed to this node, and
+        // frames for groups or node bitmaps, are numbered separately from fleet
+        // frames, so they are tracked under their own keys.
+        std::string peerKey(reinterpret_cast<const char *>(src_addr), ESP_NOW_ETH_ALEN);
+        bool targeted = rawMessage->flags & MESSAGE_FLAGS_TARGETED;
+        if (rawMessage->flags & MESSAGE_FLAG_DESTINATION) {
+            peerKey.push_back('\x01');
+        } else if (targeted) {
+            peerKey.push_back('\x02');
         }
-        case PayloadType::RegistrationSuccessful: {
-            if (payloadSize < sizeof(RegistrationSuccessfulPayload)) {
-                ESP_LOGE(TAG, "Payload size mismatch for RegistrationSuccessfulPayload");
-                return -1;
+        uint16_t lastSeqNum = peerLastSequenceNumbers[peerKey];
+
+        if ((rawMessage->seq_num > lastSeqNum) ||
+            (lastSeqNum > 200 && rawMessage->seq_num < 50)) { // Handle wrap-around
+#if ENABLE_TELEMETRY
+            // Sequence numbers wrap at 256; a gap means frames were lost in between
+            uint16_t gap = (rawMessage->seq_num - lastSeqNum - 1) & 0xFF;
+            // Targeted frames for other nodes leave gaps in their stream that are not losses
+            if (lastSeqNum != 0 && gap < 128 && !targeted) {
+                Telemetry::recordLoss(gap);
             }
-            RegistrationSuccessfulPayload payload;
-            std::memcpy(&payload, rawMessage->payload, sizeof(RegistrationSuccessfulPayload));
-            message->parsed_payload = payload;
-            break;
-        }
-        case PayloadType::Keepalive: {
-            if (payloadSize < sizeof(KeepalivePayload)) {
-                ESP_LOGE(TAG, "Payload size mismatch for KeepalivePayload");
-                return -1;
-            }
-            // Keepalive has no additional payload
-            break;
+#endif
+            peerLastSequenceNumbers[peerKey] = rawMessage->seq_num;
+        } else {
+            ESP_LOGW(TAG, "Ignoring duplicate or out-of-order message: seq_num=%d, lastSeqNum=%d",
+                     rawMessage->seq_num, lastSeqNum);
+#if ENABLE_TELEMETRY
+            Telemetry::recordDuplicate();
+#endif
+            return -1; // Ignore the message
         }
-        default:
-            ESP_LOGE(TAG, "Unknown payload type: %d", static_cast<int>(message->payload_type));
-            return -1;
     }
 
-    return 0;
+    return static_cast<int>(payloadType);
+}
+
+// The node id a registration acknowledgement gives us, read straight from the frame
+NodeId Receiver::registrationNodeId(PayloadType type, const uint8_t *data, size_t data_len) {
+    size_t headerLen = messageHeaderLength(reinterpret_cast<const MessageData *>(data)->flags);
+    const uint8_t *payloadData = data + headerLen;
+    size_t payloadSize = data_len - headerLen;
+
+    if (type == PayloadType::RegistrationSuccessful) {
+        RegistrationSuccessfulPayload payload;
+        std::memcpy(&payload, payloadData, sizeof(payload));
+        return payload.node_id;
+    }
+    // Only our own entry matters
+    for (size_t offset = 0; offset + sizeof(RegistrationBatchEntry) <= payloadSize;
+         offset += sizeof(RegistrationBatchEntry)) {
+        RegistrationBatchEntry entry;
+        std::memcpy(&entry, payloadData + offset, sizeof(entry));
+        if (std::memcmp(entry.mac, ownMac, ESP_NOW_ETH_ALEN) == 0) {
+            return entry.node_id;
+        }
+    }
+    return NODE_ID_NONE;
 }
 
 // Add a task to broadcast registration requests
@@ -285,12 +651,12 @@ void Receiver::broadcastRegistration(void *pvParameter) {
 
     // Register the broadcast MAC address
     esp_now_peer_info_t peerInfo = {};
-    peerInfo.channel = CONFIG_ESPNOW_CHANNEL;
+    peerInfo.channel = 0; // Follow the radio's current channel
     peerInfo.ifidx = static_cast<wifi_interface_t>(ESPNOW_WIFI_IF);
     peerInfo.encrypt = false;
     std::memcpy(peerInfo.peer_addr, broadcastMac, ESP_NOW_ETH_ALEN);
     esp_err_t result = esp_now_add_peer(&peerInfo);
-    if (result != ESP_OK) {
+    if (result != ESP_OK && result != ESP_ERR_ESPNOW_EXIST) { // Relays keep it permanently
         ESP_LOGE(TAG, "Failed to add broadcast peer: %s", esp_err_to_name(result));
         vTaskDelete(nullptr); // Delete the task if adding the peer fails
         return;
@@ -299,20 +665,48 @@ void Receiver::broadcastRegistration(void *pvParameter) {
     MessageData registrationRequest = {};
     registrationRequest.seq_num = 0;
     registrationRequest.payload_type = static_cast<uint8_t>(PayloadType::RegisterRequest);
-    registrationRequest.crc = 0; // CRC will be calculated by the sender
+    registrationRequest.flags = 0;
+    registrationRequest.crc = computeMessageCrc(reinterpret_cast<uint8_t *>(&registrationRequest), sizeof(registrationRequest));
+
+    // The sender may have moved while we were away, so with channel agility each
+    // round tries every channel, starting with the one we last knew it on
+#if ENABLE_CHANNEL_AGILITY
+    uint8_t homeChannel = Manager::currentChannel();
+    scanStartChannel = homeChannel;
+#endif
+    uint32_t attempt = 0;
+    while (!isRegistered) {
+        // Wait first, so receivers that powered up together do not all broadcast at once
+        vTaskDelay(pdMS_TO_TICKS(registrationBackoffMs(attempt++)));
+#if ENABLE_TDMA
+        // Then for the contention period, to stay out of registered nodes' slots
+        vTaskDelay(pdMS_TO_TICKS(Tdma::msUntilContention()));
+#endif
 
-    while (!isRegistered) { // Check registration status before broadcasting
-        esp_err_t result = esp_now_send(broadcastMac, reinterpret_cast<uint8_t *>(&registrationRequest), sizeof(registrationRequest));
-        if (result == ESP_OK) {
-            ESP_LOGI(TAG, "Broadcasted registration request");
-        } else {
-            ESP_LOGE(TAG, "Failed to broadcast registration request: %s", esp_err_to_name(result));
+        for (uint8_t i = 0; i < REGISTRATION_SCAN_CHANNELS && !isRegistered; i++) {
+#if ENABLE_CHANNEL_AGILITY
+            uint8_t channel = ESPNOW_CHANNEL_MIN + (homeChannel - ESPNOW_CHANNEL_MIN + i) % REGISTRATION_SCAN_CHANNELS;
+            esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+#endif
+            esp_err_t result = esp_now_send(broadcastMac, reinterpret_cast<uint8_t *>(&registrationRequest), sizeof(registrationRequest));
+            if (result == ESP_OK) {
+                ESP_LOGI(TAG, "Broadcasted registration request");
+            } else {
+                ESP_LOGE(TAG, "Failed to broadcast registration request: %s", esp_err_to_name(result));
+            }
+#if ENABLE_CHANNEL_AGILITY
+            // Give the sender time to answer before moving on
+            vTaskDelay(pdMS_TO_TICKS(ESPNOW_REGISTRATION_SCAN_DWELL_MS));
+#endif
         }
-
-        // Delay for 1 second before broadcasting again
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
     }
 
+#if ENABLE_CHANNEL_AGILITY
+    // recvLoop moves the radio back to the channel the sender answered on
+    xTaskNotify(recvLoopTask, RECV_EVENT_SCAN_DONE, eSetBits);
+#endif
+
+#if !ENABLE_RELAY
     // Unregister the broadcast peer after successful registration
     result = esp_now_del_peer(broadcastMac);
     if (result != ESP_OK) {
@@ -320,23 +714,191 @@ void Receiver::broadcastRegistration(void *pvParameter) {
     } else {
         ESP_LOGI(TAG, "Deleted broadcast peer successfully");
     }
+#endif
 
     ESP_LOGI(TAG, "Registration successful, stopping broadcast task");
     vTaskDelete(nullptr); // Delete the task once registration is complete
 }
 
-void Receiver::checkKeepalive(void *pvParameter) {
-    ESP_LOGI(TAG, "Keepalive monitoring task started");
+// Forget the last sequence numbers seen from `src_addr`, on its fleet, addressed
+// and targeted streams
+void Receiver::resetSequenceTracking(const uint8_t *src_addr) {
+    std::string peerKey(reinterpret_cast<const char *>(src_addr), ESP_NOW_ETH_ALEN);
+    peerLastSequenceNumbers.erase(peerKey);
+    peerKey.push_back('\x01');
+    peerLastSequenceNumbers.erase(peerKey);
+    peerKey.back() = '\x02';
+    peerLastSequenceNumbers.erase(peerKey);
+}
 
-    while (true) {
-        uint32_t currentTime = xTaskGetTickCount() * portTICK_PERIOD_MS;
+#if ENABLE_PAIRING_PERSISTENCE
+void Receiver::savePairing() {
+    ReceiverPairing pairing = {};
+    pairing.version = PAIRING_VERSION;
+    std::memcpy(pairing.sender_mac, senderMac, ESP_NOW_ETH_ALEN);
+    pairing.node_id = nodeId;
+    pairing.groups = groupMask;
+#if ENABLE_TELEMETRY
+    pairing.telemetry_interval_s = telemetryIntervalMs / 1000;
+#endif
+    Pairing::saveReceiver(pairing);
+}
+#endif
+
+// Full jitter: uniform in [0, min(ESPNOW_REGISTRATION_BACKOFF_MAX_MS, BASE * 2^attempt)]
+uint32_t Receiver::registrationBackoffMs(uint32_t attempt) {
+    uint32_t ceiling = ESPNOW_REGISTRATION_BACKOFF_MAX_MS;
+    if (attempt < 16 && (ESPNOW_REGISTRATION_BACKOFF_BASE_MS << attempt) < ESPNOW_REGISTRATION_BACKOFF_MAX_MS) {
+        ceiling = ESPNOW_REGISTRATION_BACKOFF_BASE_MS << attempt;
+    }
+    return esp_random() % (ceiling + 1);
+}
+
+// Fires when nothing has been heard from the sender for ESPNOW_KEEPALIVE_TIMEOUT_MS.
+// Runs in the timer service task, so it only flips state and hands off to a task.
+void Receiver::keepaliveTimeout(TimerHandle_t timer) {
+    if (!isRegistered) {
+        return;
+    }
+
+    ESP_LOGW(TAG, "Keepalive timeout. Restarting registration broadcast.");
+    isRegistered = false;
+    xTaskCreate(broadcastRegistration, "broadcastRegistration", 2048, nullptr, 4, nullptr);
+}
+
+#if ENABLE_CHANNEL_AGILITY
+// Runs in the timer service task once the announced switch time arrives
+void Receiver::channelSwitchTimeout(TimerHandle_t timer) {
+    xTaskNotify(recvLoopTask, RECV_EVENT_CHANNEL_SWITCH, eSetBits);
+}
+
+// Runs on recvLoop
+void Receiver::applyChannelSwitch() {
+    if (pendingChannel != 0 && Manager::switchChannel(pendingChannel) == ESP_OK) {
+        pendingChannel = 0;
+    }
+}
 
-        if (isRegistered && (currentTime - lastKeepaliveTime > 10000)) { // 10-second timeout
-            ESP_LOGW(TAG, "Keepalive timeout. Restarting registration broadcast.");
-            isRegistered = false;
-            xTaskCreate(broadcastRegistration, "broadcastRegistration", 2048, nullptr, 4, nullptr);
+// Runs on recvLoop once the registration scan stops. Stays on, and remembers, the
+// channel the sender answered on, which need not be where the scan stopped.
+void Receiver::settleRegistrationChannel() {
+    uint8_t channel = registrationChannel;
+    registrationChannel = 0;
+    if (channel != 0 && (channel != scanStartChannel || channel != Manager::currentChannel())) {
+        Manager::switchChannel(channel);
+    }
+}
+#endif
+
+#if ENABLE_SHOW_STATE
+// Called from recvLoop with every show state version the sender announces. When we
+// are behind, wait a random moment before asking: the delta another receiver asks
+// for reaches us too, and may arrive first.
+void Receiver::noteStateVersion(const StateVersionPayload &advert) {
+    advertisedEpoch = advert.epoch;
+    advertisedVersion = advert.version;
+    if (ShowState::behind(advert)) {
+        if (!xTimerIsTimerActive(stateRequestTimer)) {
+            xTimerChangePeriod(stateRequestTimer, pdMS_TO_TICKS(esp_random() % STATE_REQUEST_JITTER_MS) + 1, 0);
         }
+    } else {
+        xTimerStop(stateRequestTimer, 0);
+    }
+}
+
+// Runs in the timer service task, whose stack is too small to build a frame on
+void Receiver::stateRequestTimeout(TimerHandle_t timer) {
+    xTaskNotify(recvLoopTask, RECV_EVENT_STATE_REQUEST, eSetBits);
+}
 
-        vTaskDelay(1000 / portTICK_PERIOD_MS); // Check every second
+// Runs on recvLoop; re-arms the timer until we have caught up
+void Receiver::requestState() {
+    StateVersionPayload advert = {advertisedEpoch, advertisedVersion};
+    if (!ShowState::behind(advert)) {
+        return;
     }
+    StateRequestPayload request = ShowState::request(advert);
+    ESP_LOGI(TAG, "Asking for show state since version %lu", static_cast<unsigned long>(request.have_version));
+    sendToSender(PayloadType::StateRequest, reinterpret_cast<const uint8_t *>(&request), sizeof(request));
+    xTimerChangePeriod(stateRequestTimer, pdMS_TO_TICKS(STATE_REQUEST_RETRY_MS), 0);
+}
+#endif
+
+#if ENABLE_TELEMETRY
+// Uniformly jittered between 50% and 150% of the mean interval so a fleet that
+// powered up together does not report in lockstep.
+uint32_t Receiver::nextTelemetryDelayMs() {
+    return telemetryIntervalMs / 2 + esp_random() % (telemetryIntervalMs + 1);
+}
+
+// Runs in the timer service task, whose stack is too small to build a frame on
+void Receiver::telemetryTimeout(TimerHandle_t timer) {
+    xTaskNotify(recvLoopTask, RECV_EVENT_TELEMETRY, eSetBits);
+}
+
+// Runs on recvLoop
+void Receiver::sendTelemetry() {
+    if (isRegistered) {
+        uint8_t report[TELEMETRY_MAX_ENCODED_LEN];
+        size_t reportLen = Telemetry::encodeReport(report, sizeof(report));
+        if (reportLen > 0) {
+            sendToSender(PayloadType::Telemetry, report, reportLen);
+        }
+    }
+    xTimerChangePeriod(telemetryTimer, pdMS_TO_TICKS(nextTelemetryDelayMs()), 0);
+}
+#endif
+
+esp_err_t Receiver::sendToSender(PayloadType payload_type, const uint8_t *payload, size_t payload_len) {
+    static const uint8_t noMac[ESP_NOW_ETH_ALEN] = {0};
+    if (std::memcmp(senderMac, noMac, ESP_NOW_ETH_ALEN) == 0) {
+        ESP_LOGW(TAG, "No sender known yet, dropping uplink message type=%d", static_cast<int>(payload_type));
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (payload_len > ESP_NOW_MAX_DATA_LEN - sizeof(MessageData)) {
+        ESP_LOGE(TAG, "Uplink payload too large: %zu", payload_len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Unicast requires the sender to be in our peer list
+    if (!esp_now_is_peer_exist(senderMac)) {
+        esp_now_peer_info_t peerInfo = {};
+        peerInfo.channel = 0; // Follow the radio's current channel
+        peerInfo.ifidx = static_cast<wifi_interface_t>(ESPNOW_WIFI_IF);
+        peerInfo.encrypt = false;
+        std::memcpy(peerInfo.peer_addr, senderMac, ESP_NOW_ETH_ALEN);
+        esp_err_t result = esp_now_add_peer(&peerInfo);
+        if (result != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to add sender as peer: %s", esp_err_to_name(result));
+            return result;
+        }
+    }
+
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    MessageData *messageData = reinterpret_cast<MessageData *>(frame);
+    messageData->seq_num = ++uplinkSequenceNumber;
+    messageData->payload_type = static_cast<uint8_t>(payload_type);
+    messageData->flags = 0;
+    std::memcpy(messageData->payload, payload, payload_len);
+
+    size_t frameLen = sizeof(MessageData) + payload_len;
+    messageData->crc = computeMessageCrc(frame, frameLen);
+
+#if ENABLE_TDMA
+    if (Tdma::synced()) {
+        return Tdma::submit(senderMac, frame, frameLen, nodeId.load());
+    }
+#endif
+
+    esp_err_t result = esp_now_send(senderMac, frame, frameLen);
+    if (result != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send uplink message: %s", esp_err_to_name(result));
+    }
+#if ENABLE_FRAME_TRACE
+    if (result == ESP_OK) {
+        FrameTrace::record(FRAME_TRACE_TX, senderMac, 0, frame, frameLen);
+    }
+#endif
+    return result;
 }
@@ -4,20 +4,99 @@
 #include <cstdint>
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/timers.h"
 #include "esp_now.h"
 #include "Messages.h"
+#include "config.h"
 #include <unordered_map>
 
+// A frame as its subscriber sees it. Everything points into the receive ring, so it
+// is only valid for the duration of the handler call.
+struct ReceivedFrame {
+    const MessageEnvelope &envelope; // Source, RSSI and when it arrived
+    const MessageData &header;
+    const uint8_t *payload;
+    size_t payload_len;
+};
+
 class Receiver {
 public:
     static void init();
     static void broadcastRegistration(void *pvParameter);
 
+    // Hand every valid frame of payload type `Type` to `handler`, with the payload
+    // viewed in place as PayloadView<Type> presents it. One handler per type; the
+    // receiver's own protocol handlers are subscribed by init. Handlers run on the
+    // receive loop task, in arrival order, and should not block.
+    template <PayloadType Type>
+    static esp_err_t subscribe(void (*handler)(typename PayloadView<Type>::type payload, const ReceivedFrame &frame)) {
+        return addSubscription(Type, &invoke<Type>, reinterpret_cast<void (*)()>(handler));
+    }
+    static void unsubscribe(PayloadType type);
+
+    friend class Bench;
+    friend class HostHarness; // Host tools in test/host
+
 private:
+    // Restores the handler's real type, which only the subscribe<Type> that stored it knows
+    typedef void (*Invoker)(void (*handler)(), const ReceivedFrame &frame);
+    template <PayloadType Type>
+    static void invoke(void (*handler)(), const ReceivedFrame &frame) {
+        typedef void (*Handler)(typename PayloadView<Type>::type, const ReceivedFrame &);
+        reinterpret_cast<Handler>(handler)(PayloadView<Type>::get(frame.payload, frame.payload_len), frame);
+    }
+    struct Subscription {
+        Invoker invoke;
+        void (*handler)(); // nullptr when nothing handles the type
+    };
+    static Subscription subscriptions[static_cast<size_t>(PayloadType::Count)]; // Indexed by PayloadType
+    static esp_err_t addSubscription(PayloadType type, Invoker invoke, void (*handler)());
+    static void dispatch(const MessageEnvelope &envelope, PayloadType type);
+
+    static void onKeepalive(const StateVersionPayload *advert, const ReceivedFrame &frame);
+    static void onGroupAssign(const GroupAssignPayload &assign, const ReceivedFrame &frame);
+#if ENABLE_TELEMETRY
+    static void onTelemetryConfig(const TelemetryConfigPayload &config, const ReceivedFrame &frame);
+#endif
+#if ENABLE_LATENCY_TRACING
+    static void onLatencyReportRequest(PayloadBytes payload, const ReceivedFrame &frame);
+#endif
+#if ENABLE_TDMA
+    static void onTdmaBeacon(const TdmaBeaconPayload &beacon, const ReceivedFrame &frame);
+#endif
+#if ENABLE_CHANNEL_AGILITY
+    static void onChannelSwitch(const ChannelSwitchPayload &announce, const ReceivedFrame &frame);
+#endif
+#if ENABLE_SHOW_STATE
+    static void onStateDelta(PayloadBytes payload, const ReceivedFrame &frame);
+#endif
+
     static void recvCallback(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len);
     static void recvLoop(void *pvParameter);
-    static int parseESPNOWData(const uint8_t *data, uint16_t data_len, const uint8_t *src_addr, Message *message);
-    static void checkKeepalive(void *pvParameter);
+    static void drainReceivedFrames();
+    static void processFrame(const MessageEnvelope &recvMsg);
+    static int parseESPNOWData(const uint8_t *data, uint16_t data_len, const uint8_t *src_addr);
+    static NodeId registrationNodeId(PayloadType type, const uint8_t *data, size_t data_len);
+    static uint32_t registrationBackoffMs(uint32_t attempt);
+    static void resetSequenceTracking(const uint8_t *src_addr);
+#if ENABLE_PAIRING_PERSISTENCE
+    static void savePairing();
+#endif
+    static void keepaliveTimeout(TimerHandle_t timer);
+#if ENABLE_SHOW_STATE
+    static void noteStateVersion(const StateVersionPayload &advert);
+    static void stateRequestTimeout(TimerHandle_t timer);
+    static void requestState();
+#endif
+#if ENABLE_CHANNEL_AGILITY
+    static void channelSwitchTimeout(TimerHandle_t timer);
+    static void applyChannelSwitch();
+    static void settleRegistrationChannel();
+#endif
+    static uint32_t nextTelemetryDelayMs();
+    static void telemetryTimeout(TimerHandle_t timer);
+    static void sendTelemetry();
+    static esp_err_t sendToSender(PayloadType payload_type, const uint8_t *payload, size_t payload_len);
 
     static std::unordered_map<std::string, uint16_t> peerLastSequenceNumbers; // Last received sequence numbers per peer
     static volatile bool isRegistered;
@@ -0,0 +1,65 @@
+#include "RecvHandoff.h"
+#include "esp_mac.h"
+#include <new>
+
+#define RECV_HIGH_WATER ((RECV_RING_SLOTS * RECV_HIGH_WATER_PERCENT + 99) / 100)
+
+bool RecvHandoff::init(HandoffPolicy policy) {
+    this->policy = policy;
+    ring = new (std::nothrow) Ring();
+    return ring != nullptr;
+}
+
+void RecvHandoff::setConsumer(TaskHandle_t task, uint32_t notifyBits) {
+    this->notifyBits = notifyBits;
+    consumer.store(task);
+    // Pairs with the fence in SpscRing::commitWrite: a frame committed before the
+    // consumer was visible to its producer is seen here
+    if (ring->size() > 0) {
+        xTaskNotify(task, notifyBits, eSetBits);
+    }
+}
+
+// Runs on the Wi-Fi task: no formatted logging here, only DLOG records
+MessageEnvelope *RecvHandoff::beginPush(const uint8_t *src_mac) {
+#if ENABLE_FRAME_TRACE
+    taskENTER_CRITICAL(&producerLock);
+#endif
+    MessageEnvelope *slot = ring->beginWrite();
+    if (!slot && policy == HandoffPolicy::DropOldest && ring->dropOldest()) {
+        // The slot freed is the one we write next, so it still holds the dropped frame
+        slot = ring->beginWrite();
+        DLOGW(dropFormat, MAC2STR(slot->src_mac));
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    } else if (!slot) {
+        // Full, or the consumer is reading the oldest frame
+        DLOGW(dropFormat, MAC2STR(src_mac));
+        dropped.fetch_add(1, std::memory_order_relaxed);
+#if ENABLE_FRAME_TRACE
+        taskEXIT_CRITICAL(&producerLock);
+#endif
+    }
+    return slot;
+}
+
+void RecvHandoff::commitPush() {
+    bool wasEmpty = ring->commitWrite();
+    size_t waiting = ring->size();
+#if ENABLE_FRAME_TRACE
+    taskEXIT_CRITICAL(&producerLock);
+#endif
+    if (wasEmpty) {
+        if (TaskHandle_t task = consumer.load()) {
+            xTaskNotify(task, notifyBits, eSetBits);
+        }
+    }
+
+    if (waiting >= RECV_HIGH_WATER) {
+        if (!alarmed) {
+            alarmed = true;
+            DLOGW(highWaterFormat, waiting, RECV_RING_SLOTS);
+        }
+    } else if (waiting < RECV_RING_SLOTS / 2) {
+        alarmed = false;
+    }
+}
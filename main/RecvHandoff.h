@@ -0,0 +1,78 @@
+#ifndef RECV_HANDOFF_H
+#define RECV_HANDOFF_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "DeferredLog.h"
+#include "Messages.h"
+#include "SpscRing.h"
+#include "config.h"
+
+// Which frame goes when a handoff queue is full
+enum class HandoffPolicy : uint8_t {
+    DropNewest, // Keep what is queued and drop the frame being handed off
+    DropOldest, // Make room by dropping the frame that has waited longest
+};
+
+constexpr HandoffPolicy RECV_HANDOFF_POLICY =
+    RECV_OVERFLOW_POLICY == RECV_DROP_OLDEST ? HandoffPolicy::DropOldest : HandoffPolicy::DropNewest;
+
+// Passes received frames from the ESP-NOW receive callback to the task that handles
+// them. push never blocks, so a consumer that falls behind costs frames instead of
+// stalling the Wi-Fi task and with it the whole radio. Drops are counted for the
+// consumer to report. When the queue fills to RECV_HIGH_WATER_PERCENT, a DLOG warning
+// fires once, and again only after the queue has drained below half.
+//
+// Frames live in the slots of an SpscRing: the callback copies the radio's buffer
+// straight into a slot and the consumer parses it where it lies, with no allocation
+// and no critical section. The consumer is woken with a task notification, and only
+// when a frame lands in an empty ring, because it drains the ring before sleeping.
+class RecvHandoff {
+public:
+    // `dropFormat` and `highWaterFormat` are the caller's DLOG records for a dropped
+    // frame (its source MAC) and for the alarm (depth, capacity).
+    RecvHandoff(DlogFormat dropFormat, DlogFormat highWaterFormat)
+        : dropFormat(dropFormat), highWaterFormat(highWaterFormat) {}
+
+    // Allocates the ring, so only the role in use pays for it (about 12 KB, see config.h)
+    bool init(HandoffPolicy policy);
+    // Task to notify with `notifyBits` when frames arrive. Frames that arrived before
+    // it was set wake it straight away.
+    void setConsumer(TaskHandle_t task, uint32_t notifyBits);
+
+    // Receive callback: a slot to fill for a frame from `src_mac`, or nullptr if the
+    // frame is dropped. A slot must be committed before the callback returns.
+    MessageEnvelope *beginPush(const uint8_t *src_mac);
+    void commitPush();
+
+    // Consumer: the oldest frame, or nullptr if there is none. It stays valid, and
+    // may be modified, until release().
+    MessageEnvelope *front() { return ring->beginRead(); }
+    void release() { ring->endRead(); }
+
+    size_t depth() const { return ring->size(); }
+    // Frames dropped since the last call
+    uint32_t takeDropped() { return dropped.exchange(0, std::memory_order_relaxed); }
+
+private:
+    typedef SpscRing<MessageEnvelope, RECV_RING_SLOTS> Ring;
+
+    Ring *ring = nullptr;
+    HandoffPolicy policy = HandoffPolicy::DropNewest;
+    DlogFormat dropFormat;
+    DlogFormat highWaterFormat;
+    std::atomic<TaskHandle_t> consumer{nullptr};
+    uint32_t notifyBits = 0;
+    std::atomic<uint32_t> dropped{0};
+    bool alarmed = false; // Producer side only
+#if ENABLE_FRAME_TRACE
+    // Trace replay runs the receive callback from the console task as well, and the
+    // ring allows one producer at a time
+    portMUX_TYPE producerLock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+};
+
+#endif // RECV_HANDOFF_H
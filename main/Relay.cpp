@@ -0,0 +1,210 @@
+#include "Relay.h"
+
+#if ENABLE_RELAY
+
+#include "Metrics.h"
+#include "Auth.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <cstddef>
+#include <cstring>
+
+static_assert((RELAY_SEEN_SIZE & (RELAY_SEEN_SIZE - 1)) == 0, "RELAY_SEEN_SIZE must be a power of two");
+
+static const char *TAG = "Relay";
+
+struct PendingRelay {
+    uint32_t key;      // Fingerprint of the frame, 0 when the slot is free
+    TickType_t due;    // When to rebroadcast
+    uint8_t heard;     // Copies heard from other relays while waiting
+    size_t len;
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN_V2];
+};
+
+// admit() runs on the Wi-Fi task and relayLoop() in its own task
+static portMUX_TYPE relayLock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t seen[RELAY_SEEN_SIZE]; // Fingerprints, 0 when empty
+static PendingRelay pending[RELAY_PENDING_SLOTS];
+static TaskHandle_t relayTask = nullptr;
+
+// A collision only evicts the older fingerprint, so the worst case is relaying a
+// frame twice; the receivers' sequence check still drops the repeat. The auth tag,
+// when there is one, is mixed in so a forged copy cannot shadow the real frame.
+static uint32_t frameKey(const uint8_t *origin, uint16_t seq_num, NodeId destination, const uint8_t *tag) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](uint8_t byte) {
+        hash ^= byte;
+        hash *= 16777619u;
+    };
+    for (size_t i = 0; i < ESP_NOW_ETH_ALEN; i++) {
+        mix(origin[i]);
+    }
+    mix(seq_num & 0xFF);
+    mix(seq_num >> 8);
+    mix(destination & 0xFF);
+    mix(destination >> 8);
+    for (size_t i = 0; tag && i < 4; i++) {
+        mix(tag[i]);
+    }
+    return hash ? hash : 1;
+}
+
+void Relay::init() {
+    // Rebroadcasts go to everyone, for as long as we run
+    if (!esp_now_is_peer_exist(broadcastMac)) {
+        esp_now_peer_info_t peerInfo = {};
+        peerInfo.channel = 0; // Follow the radio's current channel
+        peerInfo.ifidx = static_cast<wifi_interface_t>(ESPNOW_WIFI_IF);
+        peerInfo.encrypt = false;
+        std::memcpy(peerInfo.peer_addr, broadcastMac, ESP_NOW_ETH_ALEN);
+        esp_err_t result = esp_now_add_peer(&peerInfo);
+        if (result != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to add broadcast peer: %s", esp_err_to_name(result));
+            return;
+        }
+    }
+
+    if (xTaskCreate(relayLoop, "relay", 3072, nullptr, 4, &relayTask) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create relay task");
+        return;
+    }
+    Metrics::registerTask(relayTask, "relay");
+}
+
+// Runs on the Wi-Fi task: no logging here
+bool Relay::admit(const uint8_t *data, size_t len) {
+    const MessageData *message = reinterpret_cast<const MessageData *>(data);
+    if (len < sizeof(MessageData) || !(message->flags & MESSAGE_FLAG_RELAY)) {
+        return true; // Not from a relaying sender; nothing to deduplicate
+    }
+    if (len < messageHeaderLength(message->flags)) {
+        return false;
+    }
+    // Before anything is marked seen: a corrupted copy must not shadow the good ones
+    // still on their way, nor count as a relay covering the frame
+    if (computeMessageCrc(data, len) != message->crc) {
+        return false;
+    }
+
+    RelayExtension relay;
+    std::memcpy(&relay, data + messageExtensionOffset(message->flags, MESSAGE_FLAG_RELAY), sizeof(relay));
+    // Targeted frames are numbered in their own stream, so they must not share keys with fleet frames
+    DestinationExtension destination = {static_cast<NodeId>((message->flags & MESSAGE_FLAGS_TARGETED) ? NODE_ID_NONE : NODE_ID_BROADCAST)};
+    if (message->flags & MESSAGE_FLAG_DESTINATION) {
+        std::memcpy(&destination, data + messageExtensionOffset(message->flags, MESSAGE_FLAG_DESTINATION),
+                    sizeof(destination));
+    }
+    const uint8_t *tag = nullptr;
+    if (message->flags & MESSAGE_FLAG_AUTH) {
+        tag = data + messageExtensionOffset(message->flags, MESSAGE_FLAG_AUTH) + offsetof(AuthExtension, tag);
+    }
+    uint32_t key = frameKey(relay.origin, message->seq_num, destination.node_id, tag);
+    uint32_t &entry = seen[key & (RELAY_SEEN_SIZE - 1)];
+
+    bool wake = false;
+    taskENTER_CRITICAL(&relayLock);
+    if (entry == key) {
+        // Another relay covered this frame, which counts against rebroadcasting it ourselves
+        for (auto &slot : pending) {
+            if (slot.key == key && slot.heard < UINT8_MAX) {
+                slot.heard++;
+            }
+        }
+        taskEXIT_CRITICAL(&relayLock);
+        return false;
+    }
+    entry = key;
+
+    if (relay.hops_left > 0 && len <= sizeof(PendingRelay::frame)) {
+        // With every slot taken the frame is still delivered, just not relayed
+        for (auto &slot : pending) {
+            if (slot.key == 0) {
+                slot.key = key;
+                slot.due = xTaskGetTickCount() + pdMS_TO_TICKS(esp_random() % (RELAY_MAX_DELAY_MS + 1));
+                slot.heard = 0;
+                slot.len = len;
+                std::memcpy(slot.frame, data, len);
+                wake = true;
+                break;
+            }
+        }
+    }
+    taskEXIT_CRITICAL(&relayLock);
+
+    if (wake && relayTask) {
+        xTaskNotifyGive(relayTask);
+    }
+    return true;
+}
+
+// Sleeps until the earliest pending rebroadcast is due, or admit() adds a new one
+void Relay::relayLoop(void *pvParameter) {
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN_V2];
+    while (true) {
+        size_t len = 0;
+        uint32_t suppressed = 0;
+        TickType_t wait = portMAX_DELAY;
+
+        taskENTER_CRITICAL(&relayLock);
+        TickType_t now = xTaskGetTickCount();
+        for (auto &slot : pending) {
+            if (slot.key == 0) {
+                continue;
+            }
+            if (slot.heard >= RELAY_SUPPRESS_COUNT) {
+                slot.key = 0;
+                suppressed++;
+                continue;
+            }
+            int32_t left = static_cast<int32_t>(slot.due - now);
+            if (left <= 0 && len == 0) {
+                len = slot.len;
+                std::memcpy(frame, slot.frame, len);
+                slot.key = 0;
+            } else if (left > 0 && static_cast<TickType_t>(left) < wait) {
+                wait = left;
+            }
+        }
+        taskEXIT_CRITICAL(&relayLock);
+
+        if (suppressed > 0) {
+            ESP_LOGD(TAG, "Suppressed %lu rebroadcasts already covered by other relays",
+                     static_cast<unsigned long>(suppressed));
+        }
+        if (len > 0) {
+            rebroadcast(frame, len);
+            continue; // Another slot may be due as well
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+void Relay::rebroadcast(uint8_t *frame, size_t len) {
+    MessageData *message = reinterpret_cast<MessageData *>(frame);
+    RelayExtension *relay = reinterpret_cast<RelayExtension *>(
+        frame + messageExtensionOffset(message->flags, MESSAGE_FLAG_RELAY));
+    // The CRC was checked by admit()
+#if ENABLE_AUTH
+    if (!Auth::verifyTag(frame, len, relay->origin)) {
+        ESP_LOGW(TAG, "Not relaying unauthenticated frame: seq_num=%u", message->seq_num);
+        return;
+    }
+#endif
+
+    relay->hops_left--;
+    message->crc = computeMessageCrc(frame, len);
+
+    esp_err_t result = esp_now_send(broadcastMac, frame, len);
+    if (result == ESP_OK) {
+        ESP_LOGD(TAG, "Relayed frame from " MACSTR ": seq_num=%u, hops_left=%u",
+                 MAC2STR(relay->origin), message->seq_num, relay->hops_left);
+    } else {
+        ESP_LOGW(TAG, "Failed to relay frame: %s", esp_err_to_name(result));
+    }
+}
+
+#endif // ENABLE_RELAY
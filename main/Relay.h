@@ -0,0 +1,37 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Messages.h"
+#include "config.h"
+
+#if ENABLE_RELAY
+
+// Receiver-side rebroadcasting of fleet frames so installations larger than one
+// radio hop are still covered. The sender marks frames with a RelayExtension; the
+// first time a receiver hears one it schedules a rebroadcast after a random delay
+// and cancels it if RELAY_SUPPRESS_COUNT other relays get there first, so dense
+// areas relay far less than naive flooding. Copies already seen are recognised by
+// a fingerprint of (origin, sequence number, destination) in a small direct-mapped
+// table and dropped before they are queued. Only copies with a good CRC are
+// fingerprinted, so a corrupted copy cannot hide the frame from us.
+//
+// Relaying is downstream only: replies to the sender still have to reach it directly.
+class Relay {
+public:
+    static void init();
+
+    // Called from the receive callback for every frame that arrived as broadcast.
+    // Returns false for a copy of a frame already seen, or a corrupted one, which
+    // should be dropped.
+    static bool admit(const uint8_t *data, size_t len);
+
+private:
+    static void relayLoop(void *pvParameter);
+    static void rebroadcast(uint8_t *frame, size_t len);
+};
+
+#endif // ENABLE_RELAY
+
+#endif // RELAY_H
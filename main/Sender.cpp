@@ -7,36 +7,192 @@
 #include "esp_random.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "TimerHeap.h"
+#include "Metrics.h"
+#include "Latency.h"
+#include "Telemetry.h"
+#include "DeferredLog.h"
+#include "PeerRegistry.h"
+#include "Pairing.h"
+#include "ChannelSurvey.h"
+#include "Auth.h"
+#include "FrameTrace.h"
+#include "WakeSchedule.h"
+#include "Tdma.h"
+#include "RateControl.h"
+#include "ShowState.h"
+#include "RecvHandoff.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include <atomic>
 #include <cstring>
 #include <cstdlib>
-#include <unordered_map>
+#include <climits>
+#include <algorithm>
 
 static const char *TAG = "Sender";
 
-static QueueHandle_t outgoingMessageQueue = nullptr;
-static std::unordered_map<std::string, uint16_t> peerSequenceNumbers; // Sequence numbers per peer
+// Period of the demo traffic generator that stands in for the application
+#define SENDER_APP_SEND_INTERVAL_MS 1000
+// How often the reactor reports its wakeup count and stack usage
+#define SENDER_STATS_INTERVAL_MS 60000
+// Group assignments waiting for the reactor
+#define SENDER_GROUP_QUEUE_SIZE 8
+
+// Notification bits used to wake the reactor task
+enum ReactorEvent : uint32_t {
+    EVENT_OUTGOING = 1 << 0, // Sender::send committed slots to readySlotQueue
+    EVENT_INCOMING = 1 << 1, // incomingFrames has items
+    EVENT_GROUPS = 1 << 2,   // groupQueue has items
+    EVENT_SHOW_STATE = 1 << 3, // The show state changed
+};
+
+// Group membership change requested through Sender::assignGroups
+struct GroupAssignment {
+    NodeId node;
+    GroupMask groups;
+};
+
+// Timers kept in the reactor's timer heap
+enum SenderTimer : uint8_t {
+    TIMER_APP_SEND,
+    TIMER_KEEPALIVE, // Re-armed on every fleet broadcast
+    TIMER_STATS,
+    TIMER_REGISTRATION_ACK, // End of the current registration batch window
+#if ENABLE_PAIRING_PERSISTENCE
+    TIMER_PAIRING_SAVE,     // Batches peer table writes to flash
+#endif
+#if ENABLE_CHANNEL_AGILITY
+    TIMER_CHANNEL_SURVEY,   // Next survey, or the next channel of the one running
+    TIMER_CHANNEL_SWITCH,   // Next ChannelSwitch announcement, or the switch itself
+#endif
+#if ENABLE_LATENCY_TRACING
+    TIMER_LATENCY_REPORT,
+#endif
+#if ENABLE_TELEMETRY
+    TIMER_TELEMETRY_CONFIG, // Debounced after membership changes
+    TIMER_FLEET_SUMMARY,
+#endif
+#if ENABLE_WAKE_ALIGNMENT
+    TIMER_WAKE_WINDOW,      // Next transmit point that held frames are waiting for
+    TIMER_WAKE_PROBE,       // Next unaligned probe
+#endif
+#if ENABLE_TDMA
+    TIMER_TDMA_BEACON,      // Start of the next uplink superframe
+#endif
+#if ENABLE_SHOW_STATE
+    TIMER_STATE_ADVERTISE,  // Re-armed whenever the state version goes out
+    TIMER_STATE_REPLY,      // End of the window gathering StateRequests
+#endif
+    TIMER_COUNT,
+};
+
+OutgoingSlot Sender::outgoingSlots[SENDER_SEND_SLOTS];
+static QueueHandle_t freeSlotQueue = nullptr;  // Indices of idle outgoingSlots
+static QueueHandle_t readySlotQueue = nullptr; // Indices of filled ones, oldest first
+static std::atomic<uint32_t> sendDroppedOldest{0}; // Since the last stats report
+static std::atomic<uint32_t> sendRejected{0};
+static QueueHandle_t groupQueue = nullptr;
+static RecvHandoff incomingFrames(DLOG_SENDER_INCOMING_FULL, DLOG_SENDER_INCOMING_HIGH_WATER); // Uplink frames from recvCallback
+static TaskHandle_t reactorTask = nullptr;
+static TimerHeap<TIMER_COUNT> timers; // Only touched by the reactor task
+static SendParams reactorSendParams;  // Scratch frame for broadcasts originating in the reactor
+static SendParams reactorUnicastParams; // Scratch frame for unicast replies from the reactor
+static uint32_t reactorWakeups = 0;
+static uint32_t reactorFramesSent = 0;
+static size_t loggedPeerCount = 0; // Registry size when TIMER_STATS last listed it
+
+// Most acknowledgements that fit one RegistrationBatch frame, whatever extensions it carries
+#define REGISTRATION_BATCH_MAX \
+    ((ESP_NOW_MAX_DATA_LEN - messageHeaderLength(MESSAGE_FLAG_TRACE | MESSAGE_FLAG_RELAY | MESSAGE_FLAG_AUTH | MESSAGE_FLAG_WAKE_PHASE)) / \
+     sizeof(RegistrationBatchEntry))
+
+static NodeId pendingRegistrations[REGISTRATION_BATCH_MAX]; // Registered but not yet acknowledged
+static size_t pendingRegistrationCount = 0;
+static uint16_t fleetSequenceNumber = 0;
+static uint16_t targetedSequenceNumber = 0; // Frames for groups or node bitmaps
+#if ENABLE_SHOW_STATE
+static uint32_t lastDeltaVersion = 0; // Show state version the last delta brought receivers to
+static bool stateRequested = false;   // StateRequests are waiting for TIMER_STATE_REPLY
+static uint32_t stateRequestBase = 0; // Oldest version among them, 0 if any needs a snapshot
+#endif
+#if ENABLE_RELAY
+static uint8_t ownMac[ESP_NOW_ETH_ALEN] = {0}; // Origin in our RelayExtensions
+#endif
+
+#if ENABLE_CHANNEL_AGILITY
+static uint8_t homeChannel = CONFIG_ESPNOW_CHANNEL; // Channel the fleet is on
+static uint8_t surveyNext = 0;     // Next channel to measure, 0 when no survey is running
+static uint8_t pendingChannel = 0; // Channel announced in ChannelSwitch, 0 when not migrating
+static TickType_t switchAt = 0;    // When the announced switch happens
+static TickType_t lastSurveyAt = 0; // When the last survey finished
+static uint32_t deferredTimers = 0; // Bit per SenderTimer that expired during the survey
+static_assert(TIMER_COUNT <= 32, "deferredTimers has a bit per timer");
+#endif // Frames to every node; per-node streams live in PeerRegistry
+
+// True while a survey has the radio away from the fleet's channel
+static bool surveying() {
+#if ENABLE_CHANNEL_AGILITY
+    return surveyNext != 0;
+#else
+    return false;
+#endif
+}
+
+#if ENABLE_WAKE_ALIGNMENT
+// Fleet frame waiting for the wake windows it has not been sent in yet
+struct HeldFrame {
+    SendParams params;
+    uint8_t pending;    // Bit per WakeSchedule transmit point still to go, 0 when the slot is free
+    int64_t held_at_us;
+};
+static HeldFrame heldFrames[WAKE_HOLD_SLOTS];
+static bool wakePlanStale = true;  // A peer registered or reported a new window
+static uint32_t wakeFramesHeld = 0; // Since the last stats report
+static uint32_t wakeCopiesSent = 0;
+static uint64_t wakeHoldMsTotal = 0; // Summed over every copy
+#endif
+
+// Real ESP-NOW peer entries, only needed for frames sent as unicast
+struct PeerSlot {
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    uint32_t last_used; // peerSlotClock when the slot was last used
+    bool in_use;
+};
+static PeerSlot peerSlots[ESPNOW_PEER_CACHE_SIZE];
+static uint32_t peerSlotClock = 0;
 
 esp_err_t Sender::init() {
     esp_log_level_set(TAG, SENDER_LOG_LEVEL);
     ESP_LOGI(TAG, "Initializing ESPNOW Sender");
 
-    // Create a queue for outgoing messages
-    outgoingMessageQueue = xQueueCreate(ESPNOW_QUEUE_SIZE, sizeof(SendParams*));
-    if (!outgoingMessageQueue) {
-        ESP_LOGE(TAG, "Failed to create outgoing message queue");
+    if (initSendSlots() != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    // Frames from receivers are handled by the reactor, not the Wi-Fi task
+    if (!incomingFrames.init(RECV_HANDOFF_POLICY)) {
+        ESP_LOGE(TAG, "Failed to create incoming message queue");
+        return ESP_FAIL;
+    }
+
+    groupQueue = xQueueCreate(SENDER_GROUP_QUEUE_SIZE, sizeof(GroupAssignment));
+    if (!groupQueue) {
+        ESP_LOGE(TAG, "Failed to create group assignment queue");
         return ESP_FAIL;
     }
 
     // Register send and receive callbacks
     ESP_ERROR_CHECK(esp_now_register_send_cb(Sender::sendCallback));
     ESP_ERROR_CHECK(esp_now_register_recv_cb(Sender::recvCallback));
+#if ENABLE_FRAME_TRACE
+    FrameTrace::init(Sender::recvCallback);
+#endif
     
-    // If we're not using point-to-point, add a broadcast peer
-#if !USE_POINT_TO_POINT
-    // Add broadcast peer
+    // Fleet traffic always goes out as broadcast, addressed by node ID where needed
     if (!esp_now_is_peer_exist(broadcastMac)) {
         esp_now_peer_info_t peerInfo = {};
-        peerInfo.channel = CONFIG_ESPNOW_CHANNEL;
+        peerInfo.channel = 0; // Follow the radio's current channel
         peerInfo.ifidx = static_cast<wifi_interface_t>(ESPNOW_WIFI_IF);
         peerInfo.encrypt = false;
         std::memcpy(peerInfo.peer_addr, broadcastMac, ESP_NOW_ETH_ALEN);
@@ -50,287 +206,1187 @@ esp_err_t Sender::init() {
     } else {
         ESP_LOGW(TAG, "Broadcast peer already exists: MAC=" MACSTR, MAC2STR(broadcastMac));
     }
+
+#if ENABLE_RELAY
+    esp_wifi_get_mac(static_cast<wifi_interface_t>(ESPNOW_WIFI_IF), ownMac);
+#endif
+#if ENABLE_AUTH
+    Auth::restoreCounter();
+#endif
+#if ENABLE_PAIRING_PERSISTENCE
+    Pairing::restorePeers();
+#endif
+#if ENABLE_CHANNEL_AGILITY
+    homeChannel = Manager::currentChannel();
+#endif
+#if ENABLE_SHOW_STATE
+    ShowState::begin();
 #endif
 
-    // Start the testing loop task
-    xTaskCreate(sendLoop, "sendLoop", 2048, nullptr, 4, nullptr);
-    xTaskCreate(processOutgoingMessages, "processOutgoingMessages", 2048, nullptr, 4, nullptr);
-    xTaskCreate(sendKeepalive, "sendKeepalive", 2048, nullptr, 2, nullptr);
+    // A single reactor task handles queued frames, keepalives and the test traffic
+    if (xTaskCreate(reactorLoop, "senderReactor", 3072, nullptr, 4, &reactorTask) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create sender reactor task");
+        return ESP_FAIL;
+    }
+    Metrics::registerTask(reactorTask, "senderReactor");
+    incomingFrames.setConsumer(reactorTask, EVENT_INCOMING);
+    Metrics::registerQueue(readySlotQueue, "outgoing");
+    Metrics::registerQueue([] { return incomingFrames.depth(); }, "incoming");
 
     return ESP_OK;
 }
 
-uint16_t Sender::getNextSequenceNumber(const uint8_t *mac_addr) {
-    std::string peerKey(reinterpret_cast<const char *>(mac_addr), ESP_NOW_ETH_ALEN);
-
-    // Check if the MAC address is already in the map
-    if (peerSequenceNumbers.find(peerKey) == peerSequenceNumbers.end()) {
-        // Initialize the sequence number for this MAC address
-        peerSequenceNumbers[peerKey] = 0;
-    }
+// Fleet frames and frames for each node are separate streams, so a receiver never
+// sees gaps caused by frames that were addressed to someone else. Frames for groups
+// and node bitmaps share a third stream, whose gaps receivers do not count as loss.
+uint16_t Sender::getNextSequenceNumber(const FrameTarget &target) {
+    PeerEntry *peer = target.flag == MESSAGE_FLAG_DESTINATION ? PeerRegistry::find(target.node) : nullptr;
+    uint16_t &seq = peer                                   ? peer->seq_num
+                    : (target.flag & MESSAGE_FLAGS_TARGETED) ? targetedSequenceNumber
+                                                             : fleetSequenceNumber;
 
     // Increment and return the next sequence number, wrapping around at 255
-    peerSequenceNumbers[peerKey] = (peerSequenceNumbers[peerKey] + 1) % 256;
-    return peerSequenceNumbers[peerKey];
+    seq = (seq + 1) % 256;
+    return seq;
 }
 
+// Runs on the Wi-Fi task: no formatted logging here, only DLOG records
 void Sender::sendCallback(const uint8_t *mac_addr, esp_now_send_status_t status) {
     if (!mac_addr) {
-        ESP_LOGE(TAG, "Send callback error: null MAC address");
+        DLOGE(DLOG_SENDER_SEND_CB_NULL_MAC);
         return;
     }
-    ESP_LOGI(TAG, "Send callback: MAC= " MACSTR ", status=%d",
-             MAC2STR(mac_addr),
-             status);
+    DLOGD(DLOG_SENDER_SEND_CB, MAC2STR(mac_addr), status);
 
     if (status != ESP_NOW_SEND_SUCCESS) {
-        ESP_LOGW(TAG, "Send failed: MAC=" MACSTR, MAC2STR(mac_addr));
+        DLOGW(DLOG_SENDER_SEND_FAILED, MAC2STR(mac_addr));
     }
+#if ENABLE_RATE_CONTROL
+    RateControl::recordOutcome(mac_addr, status == ESP_NOW_SEND_SUCCESS);
+#endif
 }
 
-// Update recvCallback to enqueue responses to outgoingMessageQueue
+// Runs on the Wi-Fi task: no formatted logging here, only DLOG records
 void Sender::recvCallback(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len) {
     if (!recv_info || !data || len <= 0) {
-        ESP_LOGE(TAG, "Receive callback error: invalid arguments");
+        DLOGE(DLOG_SENDER_RECV_CB_INVALID);
         return;
     }
-    ESP_LOGI(TAG, "Receive callback: MAC=" MACSTR ", len=%d",
-             MAC2STR(recv_info->src_addr), len);
+    DLOGD(DLOG_SENDER_RECV_CB, MAC2STR(recv_info->src_addr), len);
+#if ENABLE_FRAME_TRACE
+    bool broadcast = recv_info->des_addr && IS_BROADCAST_ADDR(recv_info->des_addr);
+    FrameTrace::record(FRAME_TRACE_RX | (broadcast ? FRAME_TRACE_BROADCAST : 0), recv_info->src_addr,
+                       recv_info->rx_ctrl ? recv_info->rx_ctrl->rssi : 0, data, len);
+#endif
 
     // Parse the received data as an MessageData
-    if (len < sizeof(MessageData)) {
-        ESP_LOGE(TAG, "Received data too short to be valid");
+    if (len < static_cast<int>(sizeof(MessageData))) {
+        DLOGE(DLOG_SENDER_RECV_TOO_SHORT, len);
+        return;
+    }
+    if (len > ESP_NOW_MAX_DATA_LEN_V2) {
+        DLOGE(DLOG_SENDER_RECV_TOO_LONG, len);
         return;
     }
 
     auto *messageData = reinterpret_cast<const MessageData *>(data);
+    if (messageData->flags & MESSAGE_FLAG_RELAY) {
+        return; // Our own fleet frame, rebroadcast by a receiver
+    }
+    if (static_cast<PayloadType>(messageData->payload_type) == PayloadType::RegisterRequest) {
+        DLOGI(DLOG_SENDER_REGISTER_REQUEST, MAC2STR(recv_info->src_addr));
+    }
+
+    // Everything, registration included, is handled by the reactor rather than on the Wi-Fi task
+    MessageEnvelope *envelope = incomingFrames.beginPush(recv_info->src_addr);
+    if (!envelope) {
+        return;
+    }
+    std::memcpy(envelope->src_mac, recv_info->src_addr, ESP_NOW_ETH_ALEN);
+    std::memcpy(envelope->data, data, len);
+    envelope->data_len = len;
+    envelope->rssi = recv_info->rx_ctrl ? recv_info->rx_ctrl->rssi : 0;
+    incomingFrames.commitPush(); // Wakes the reactor with EVENT_INCOMING
+}
+
+esp_err_t Sender::assignGroups(NodeId node, GroupMask groups) {
+    GroupAssignment assignment = {node, groups};
+    if (xQueueSend(groupQueue, &assignment, 0) != pdTRUE) {
+        return ESP_ERR_NO_MEM;
+    }
+    xTaskNotify(reactorTask, EVENT_GROUPS, eSetBits);
+    return ESP_OK;
+}
+
+#if ENABLE_SHOW_STATE
+void Sender::setShowPattern(const char *name) {
+    ShowState::setPattern(name);
+    xTaskNotify(reactorTask, EVENT_SHOW_STATE, eSetBits);
+}
+
+void Sender::setShowBrightness(uint8_t level) {
+    ShowState::setBrightness(level);
+    xTaskNotify(reactorTask, EVENT_SHOW_STATE, eSetBits);
+}
+
+void Sender::setShowParam(uint8_t index, int16_t value) {
+    ShowState::setParam(index, value);
+    xTaskNotify(reactorTask, EVENT_SHOW_STATE, eSetBits);
+}
+#endif
+
+// Every slot index sits in exactly one place: freeSlotQueue, readySlotQueue, or with
+// the producer or reactor that took it. Both queues hold every index, so moving one
+// between them never blocks.
+esp_err_t Sender::initSendSlots() {
+    static_assert(SENDER_SEND_SLOTS <= UINT8_MAX, "Slot indices travel as uint8_t");
+    static_assert(SENDER_MAX_PAYLOAD_LEN <= UINT8_MAX, "OutgoingSlot::len is a uint8_t");
+    freeSlotQueue = xQueueCreate(SENDER_SEND_SLOTS, sizeof(uint8_t));
+    readySlotQueue = xQueueCreate(SENDER_SEND_SLOTS, sizeof(uint8_t));
+    if (!freeSlotQueue || !readySlotQueue) {
+        ESP_LOGE(TAG, "Failed to create outgoing slot queues");
+        return ESP_FAIL;
+    }
+    for (uint8_t index = 0; index < SENDER_SEND_SLOTS; index++) {
+        xQueueSend(freeSlotQueue, &index, 0);
+    }
+    return ESP_OK;
+}
+
+SendStatus Sender::acquireSlot(const SendOptions &options, uint8_t &index) {
+    if (!freeSlotQueue) {
+        return SendStatus::NotStarted;
+    }
+    TickType_t wait = options.overflow == OverflowPolicy::Wait ? options.wait_ticks : 0;
+    if (xQueueReceive(freeSlotQueue, &index, wait) == pdTRUE) {
+        return SendStatus::Queued;
+    }
+    // Whoever takes an index from readySlotQueue owns it, so the reactor can never be
+    // reading a slot we take here
+    if (options.overflow == OverflowPolicy::DropOldest && xQueueReceive(readySlotQueue, &index, 0) == pdTRUE) {
+        sendDroppedOldest++;
+        return SendStatus::QueuedDroppedOldest;
+    }
+    sendRejected++;
+    return SendStatus::Full;
+}
+
+void Sender::commitSlot(uint8_t index) {
+    xQueueSend(readySlotQueue, &index, 0);
+    if (reactorTask) {
+        xTaskNotify(reactorTask, EVENT_OUTGOING, eSetBits);
+    }
+}
+
+bool Sender::takeCommittedSlot(uint8_t &index, TickType_t ticksToWait) {
+    return xQueueReceive(readySlotQueue, &index, ticksToWait) == pdTRUE;
+}
+
+void Sender::releaseSlot(uint8_t index) {
+    xQueueSend(freeSlotQueue, &index, 0);
+}
+
+// The reactor sleeps on its task notification until either a producer signals new
+// work or the earliest timer in the heap expires. Everything the sender transmits
+// goes through this one task.
+void Sender::reactorLoop(void *pvParameter) {
+    ESP_LOGI(TAG, "Sender reactor task started");
+
+    timers.schedule(TIMER_STATS, xTaskGetTickCount() + pdMS_TO_TICKS(SENDER_STATS_INTERVAL_MS));
+#if ENABLE_LATENCY_TRACING
+    timers.schedule(TIMER_LATENCY_REPORT, xTaskGetTickCount() + pdMS_TO_TICKS(LATENCY_REPORT_INTERVAL_MS));
+#endif
+#if ENABLE_TELEMETRY
+    timers.schedule(TIMER_FLEET_SUMMARY, xTaskGetTickCount() + pdMS_TO_TICKS(FLEET_SUMMARY_INTERVAL_MS));
+#endif
+#if ENABLE_CHANNEL_AGILITY
+    // Survey straight away, before there is much fleet traffic to interrupt
+    timers.schedule(TIMER_CHANNEL_SURVEY, xTaskGetTickCount());
+#endif
+#if ENABLE_WAKE_ALIGNMENT
+    timers.schedule(TIMER_WAKE_PROBE, xTaskGetTickCount() + pdMS_TO_TICKS(WAKE_PROBE_INTERVAL_MS));
+#endif
+#if ENABLE_TDMA
+    timers.schedule(TIMER_TDMA_BEACON, xTaskGetTickCount());
+#endif
+#if ENABLE_SHOW_STATE
+    timers.schedule(TIMER_STATE_ADVERTISE, xTaskGetTickCount() + pdMS_TO_TICKS(STATE_ADVERTISE_INTERVAL_MS));
+#endif
+#if !USE_POINT_TO_POINT
+    // Nobody registers, so there is nothing to wait for
+    timers.schedule(TIMER_APP_SEND, xTaskGetTickCount() + pdMS_TO_TICKS(SENDER_APP_SEND_INTERVAL_MS));
+#else
+    if (!PeerRegistry::empty()) {
+        // Peers restored from flash: re-announce their node IDs, which also resets the
+        // receivers' sequence tracking, and resume traffic without waiting for them
+        for (const PeerEntry *peer = PeerRegistry::begin(); peer != PeerRegistry::end(); ++peer) {
+            queueRegistrationAck(peer->node_id);
+        }
+        timers.schedule(TIMER_APP_SEND, xTaskGetTickCount() + pdMS_TO_TICKS(SENDER_APP_SEND_INTERVAL_MS));
+#if ENABLE_TELEMETRY
+        timers.schedule(TIMER_TELEMETRY_CONFIG, xTaskGetTickCount() + pdMS_TO_TICKS(2000));
+#endif
+    }
+#endif
+
+    while (true) {
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, timers.ticksUntilNext(xTaskGetTickCount()));
+        reactorWakeups++;
+
+        // Whatever would transmit while a survey has the radio away from the fleet's
+        // channel stays queued, and resumeAfterSurvey picks it up
+        if ((events & EVENT_OUTGOING) && !surveying()) {
+            drainOutgoingMessages();
+        }
+
+        if (events & EVENT_INCOMING) {
+            drainIncomingMessages();
+        }
+
+        if ((events & EVENT_GROUPS) && !surveying()) {
+            drainGroupAssignments();
+        }
+
+#if ENABLE_SHOW_STATE
+        if ((events & EVENT_SHOW_STATE) && !surveying() && ShowState::current().version != lastDeltaVersion) {
+            // Changes made since the last delta go out together
+            broadcastStateDelta(ShowState::current().epoch, lastDeltaVersion);
+        }
+#endif
+
+        uint8_t timerId;
+        while (timers.popExpired(xTaskGetTickCount(), timerId)) {
+#if ENABLE_CHANNEL_AGILITY
+            if (surveying() && timerId != TIMER_CHANNEL_SURVEY) {
+                deferredTimers |= 1u << timerId;
+                continue;
+            }
+#endif
+            handleTimer(timerId);
+        }
+    }
+}
+
+void Sender::drainOutgoingMessages() {
+    uint8_t index;
+    while (takeCommittedSlot(index, 0)) {
+        const OutgoingSlot &slot = outgoingSlots[index];
+        prepareSendParams(reactorSendParams, slot.payload, slot.len, slot.type, slot.target);
+        releaseSlot(index); // The payload is in the frame now
+        transmitAligned(reactorSendParams);
+    }
+}
+
+void Sender::drainGroupAssignments() {
+    GroupAssignment assignment;
+    while (xQueueReceive(groupQueue, &assignment, 0) == pdTRUE) {
+        PeerEntry *peer = PeerRegistry::find(assignment.node);
+        if (!peer) {
+            ESP_LOGW(TAG, "Cannot assign groups to unknown node %u", assignment.node);
+            continue;
+        }
+        peer->groups = assignment.groups;
+        sendGroupAssign(*peer);
+    }
+}
+
+// Unicast, so the radio retries until the receiver has it
+void Sender::sendGroupAssign(const PeerEntry &peer) {
+    GroupAssignPayload payload = {peer.groups};
+    std::memcpy(reactorUnicastParams.dest_mac, peer.mac, ESP_NOW_ETH_ALEN);
+    prepareSendParams(reactorUnicastParams, reinterpret_cast<const uint8_t *>(&payload), sizeof(payload),
+                      PayloadType::GroupAssign, FrameTarget::toNode(peer.node_id));
+    if (transmit(reactorUnicastParams) == ESP_OK) {
+        ESP_LOGI(TAG, "Node %u assigned to groups 0x%08lx", peer.node_id, static_cast<unsigned long>(peer.groups));
+    }
+}
+
+void Sender::drainIncomingMessages() {
+    // Each frame is handled in its ring slot
+    while (MessageEnvelope *envelope = incomingFrames.front()) {
+        handleIncoming(*envelope);
+        incomingFrames.release();
+    }
+}
+
+void Sender::handleIncoming(MessageEnvelope &envelope) {
+    auto *messageData = reinterpret_cast<const MessageData *>(envelope.data);
+    uint16_t calculatedCrc = computeMessageCrc(envelope.data, envelope.data_len);
+    if (calculatedCrc != messageData->crc) {
+        ESP_LOGE(TAG, "CRC mismatch from MAC=" MACSTR ": calculated %04X, received %04X",
+                 MAC2STR(envelope.src_mac), calculatedCrc, messageData->crc);
+        return;
+    }
+
+    size_t headerLen = messageHeaderLength(messageData->flags);
+    if (envelope.data_len < headerLen) {
+        ESP_LOGE(TAG, "Message from MAC=" MACSTR " too short for its header", MAC2STR(envelope.src_mac));
+        return;
+    }
+    const uint8_t *payload = envelope.data + headerLen;
+    size_t payloadLen = envelope.data_len - headerLen;
+
+    if (PeerEntry *peer = PeerRegistry::find(envelope.src_mac)) {
+        peer->last_heard = xTaskGetTickCount();
+    }
 
-    // Handle the payload type
     switch (static_cast<PayloadType>(messageData->payload_type)) {
-        case PayloadType::RegisterRequest: {
-            ESP_LOGI(TAG, "Received Register Request from MAC=" MACSTR, MAC2STR(recv_info->src_addr));
-
-            // Add the peer to the ESP-NOW peer list if not already added
-            if (!esp_now_is_peer_exist(recv_info->src_addr)) {
-                esp_now_peer_info_t peerInfo = {};
-                peerInfo.channel = CONFIG_ESPNOW_CHANNEL;
-                peerInfo.ifidx = static_cast<wifi_interface_t>(ESPNOW_WIFI_IF);
-                peerInfo.encrypt = false;
-                std::memcpy(peerInfo.peer_addr, recv_info->src_addr, ESP_NOW_ETH_ALEN);
-
-                if (esp_now_add_peer(&peerInfo) == ESP_OK) {
-                    ESP_LOGI(TAG, "Added peer: MAC=" MACSTR, MAC2STR(recv_info->src_addr));
-
-                    // Send a Registration Successful message back to the receiver
-                    size_t totalSize = sizeof(MessageData);
-
-                    auto *response = reinterpret_cast<MessageData *>(malloc(totalSize));
-                    if (!response) {
-                        ESP_LOGE(TAG, "Failed to allocate memory for Registration Successful message");
-                        return;
-                    }
-
-                    response->seq_num = getNextSequenceNumber(recv_info->src_addr);
-                    response->payload_type = static_cast<uint8_t>(PayloadType::RegistrationSuccessful);
-
-                    // Enqueue the response instead of sending it directly
-                    auto *responseParams = new SendParams;
-                    memcpy(responseParams->dest_mac, recv_info->src_addr, ESP_NOW_ETH_ALEN);
-                    memcpy(responseParams->raw_data, response, totalSize);
-                    responseParams->data_len = totalSize;
-
-                    if (xQueueSend(outgoingMessageQueue, &responseParams, portMAX_DELAY) != pdTRUE) {
-                        ESP_LOGE(TAG, "Failed to enqueue Registration Successful message");
-                        delete responseParams;
-                    }
-
-                    free(response);
-                } else {
-                    ESP_LOGE(TAG, "Failed to add peer: MAC=" MACSTR, MAC2STR(recv_info->src_addr));
-                }
+        case PayloadType::RegisterRequest:
+            handleRegisterRequest(envelope.src_mac);
+            break;
+
+#if ENABLE_SHOW_STATE
+        case PayloadType::StateRequest: {
+            StateRequestPayload request;
+            if (payloadLen < sizeof(request)) {
+                break;
+            }
+            std::memcpy(&request, payload, sizeof(request));
+            uint32_t base = request.epoch == ShowState::current().epoch ? request.have_version : 0;
+            // One delta from the oldest version asked for serves every requester
+            stateRequestBase = stateRequested ? std::min(stateRequestBase, base) : base;
+            stateRequested = true;
+            if (!timers.isScheduled(TIMER_STATE_REPLY)) {
+                timers.schedule(TIMER_STATE_REPLY, xTaskGetTickCount() + pdMS_TO_TICKS(STATE_REPLY_WINDOW_MS));
             }
             break;
         }
+#endif
+
+#if ENABLE_LATENCY_TRACING
+        case PayloadType::LatencyReport:
+            LatencyTracer::logReport(envelope.src_mac, payload, payloadLen);
+            break;
+#endif
+
+#if ENABLE_TELEMETRY
+        case PayloadType::Telemetry:
+            applyTelemetry(envelope.src_mac, payload, payloadLen);
+            break;
+#endif
+
+#if ENABLE_WAKE_ALIGNMENT
+        case PayloadType::WakePhase: {
+            PeerEntry *peer = PeerRegistry::find(envelope.src_mac);
+            WakePhasePayload wake;
+            if (!peer || payloadLen < sizeof(wake)) {
+                break;
+            }
+            std::memcpy(&wake, payload, sizeof(wake));
+            if (wake.window_start_ms < CONFIG_ESPNOW_WAKE_INTERVAL) {
+                ESP_LOGI(TAG, "Node %u wakes at %u ms into the %d ms cycle", peer->node_id, wake.window_start_ms,
+                         CONFIG_ESPNOW_WAKE_INTERVAL);
+                peer->wake_start_ms = wake.window_start_ms;
+                wakePlanStale = true;
+            }
+            break;
+        }
+#endif
 
         default:
-            ESP_LOGW(TAG, "Unhandled payload type: %d", messageData->payload_type);
+            ESP_LOGW(TAG, "Unhandled incoming payload type: %d (%zu bytes)", messageData->payload_type, payloadLen);
+            (void)payload;
             break;
     }
 }
 
-void Sender::processOutgoingMessages(void *pvParameter) {
-    ESP_LOGI(TAG, "Processing queue task started");
+// Assigns the receiver a node ID, or repeats the one it already has since receivers
+// re-register after missing keepalives. The acknowledgement is deferred so requests
+// arriving together share one frame.
+void Sender::handleRegisterRequest(const uint8_t *mac_addr) {
+    bool created;
+    PeerEntry *peer = PeerRegistry::add(mac_addr, created);
+    if (!peer) {
+        ESP_LOGE(TAG, "Peer registry full, ignoring MAC=" MACSTR, MAC2STR(mac_addr));
+        return;
+    }
+    peer->last_heard = xTaskGetTickCount();
 
-    while (true) {
-        // Log before calling xQueueReceive
-        UBaseType_t queueItems = uxQueueMessagesWaiting(outgoingMessageQueue);
-        ESP_LOGD(TAG, "Queue items before receive: %u", queueItems);
-
-        SendParams *sendParams;
-        if (xQueueReceive(outgoingMessageQueue, &sendParams, portMAX_DELAY) == pdTRUE) {
-            if (!sendParams) {
-                ESP_LOGE(TAG, "Dequeued null sendParams");
-                continue;
+    if (created) {
+        ESP_LOGI(TAG, "Assigned node %u to MAC=" MACSTR, peer->node_id, MAC2STR(mac_addr));
+
+        TickType_t now = xTaskGetTickCount();
+        // The first registration starts the test traffic
+        if (!timers.isScheduled(TIMER_APP_SEND)) {
+            timers.schedule(TIMER_APP_SEND, now + pdMS_TO_TICKS(SENDER_APP_SEND_INTERVAL_MS));
+        }
+#if ENABLE_TELEMETRY
+        // Registrations arrive in bursts; announce the new interval once they settle
+        timers.schedule(TIMER_TELEMETRY_CONFIG, now + pdMS_TO_TICKS(2000));
+#endif
+#if ENABLE_WAKE_ALIGNMENT
+        // Not covered by any transmit point until it reports its window
+        wakePlanStale = true;
+#endif
+#if ENABLE_PAIRING_PERSISTENCE
+        // Not rescheduled, so a steady trickle of registrations still gets saved
+        if (!timers.isScheduled(TIMER_PAIRING_SAVE)) {
+            timers.schedule(TIMER_PAIRING_SAVE, now + pdMS_TO_TICKS(PAIRING_SAVE_DELAY_MS));
+        }
+#endif
+    }
+
+    queueRegistrationAck(peer->node_id);
+}
+
+void Sender::queueRegistrationAck(NodeId node_id) {
+    // A retry while the first request is still waiting adds nothing
+    for (size_t i = 0; i < pendingRegistrationCount; i++) {
+        if (pendingRegistrations[i] == node_id) {
+            return;
+        }
+    }
+    if (pendingRegistrationCount == REGISTRATION_BATCH_MAX) {
+        // Only while a survey holds the batch back; the receiver registers again
+        ESP_LOGW(TAG, "Registration batch full, node %u will retry", node_id);
+        return;
+    }
+    pendingRegistrations[pendingRegistrationCount++] = node_id;
+
+    if (pendingRegistrationCount == REGISTRATION_BATCH_MAX && !surveying()) {
+        timers.cancel(TIMER_REGISTRATION_ACK);
+        flushRegistrations();
+    } else if (!timers.isScheduled(TIMER_REGISTRATION_ACK)) {
+        timers.schedule(TIMER_REGISTRATION_ACK, xTaskGetTickCount() + pdMS_TO_TICKS(ESPNOW_REGISTRATION_BATCH_WINDOW_MS));
+    }
+}
+
+// A lone registration is acknowledged by unicast, which the radio retries until the
+// receiver ACKs. Several are broadcast together in one RegistrationBatch; a receiver
+// that misses it simply registers again after its backoff.
+void Sender::flushRegistrations() {
+    if (pendingRegistrationCount == 1) {
+        PeerEntry *peer = PeerRegistry::find(pendingRegistrations[0]);
+        RegistrationSuccessfulPayload payload = {peer->node_id};
+        std::memcpy(reactorUnicastParams.dest_mac, peer->mac, ESP_NOW_ETH_ALEN);
+        prepareSendParams(reactorUnicastParams, reinterpret_cast<const uint8_t *>(&payload), sizeof(payload),
+                          PayloadType::RegistrationSuccessful, peer->node_id);
+        transmit(reactorUnicastParams);
+    } else if (pendingRegistrationCount > 1) {
+        RegistrationBatchEntry batch[REGISTRATION_BATCH_MAX];
+        for (size_t i = 0; i < pendingRegistrationCount; i++) {
+            PeerEntry *peer = PeerRegistry::find(pendingRegistrations[i]);
+            std::memcpy(batch[i].mac, peer->mac, ESP_NOW_ETH_ALEN);
+            batch[i].node_id = peer->node_id;
+        }
+        ESP_LOGI(TAG, "Acknowledging %zu registrations in one batch", pendingRegistrationCount);
+        prepareSendParams(reactorSendParams, reinterpret_cast<const uint8_t *>(batch),
+                          pendingRegistrationCount * sizeof(RegistrationBatchEntry), PayloadType::RegistrationBatch);
+        transmitAligned(reactorSendParams);
+    }
+
+    // A receiver that registers again may have lost its groups along with its pairing
+    for (size_t i = 0; i < pendingRegistrationCount; i++) {
+        const PeerEntry *peer = PeerRegistry::find(pendingRegistrations[i]);
+        if (peer->groups != 0) {
+            sendGroupAssign(*peer);
+        }
+    }
+    pendingRegistrationCount = 0;
+}
+
+// Makes sure `mac_addr` has a real ESP-NOW peer entry, evicting the least recently
+// used one when all ESPNOW_PEER_CACHE_SIZE slots are taken
+bool Sender::ensurePeerSlot(const uint8_t *mac_addr) {
+    PeerSlot *victim = &peerSlots[0];
+    for (PeerSlot &slot : peerSlots) {
+        if (slot.in_use && std::memcmp(slot.mac, mac_addr, ESP_NOW_ETH_ALEN) == 0) {
+            slot.last_used = ++peerSlotClock;
+            return true;
+        }
+        // Prefer a free slot, otherwise the one idle the longest
+        if (victim->in_use && (!slot.in_use || slot.last_used < victim->last_used)) {
+            victim = &slot;
+        }
+    }
+
+    if (victim->in_use) {
+        ESP_LOGD(TAG, "Evicting peer slot for MAC=" MACSTR, MAC2STR(victim->mac));
+        esp_now_del_peer(victim->mac);
+#if ENABLE_RATE_CONTROL
+        RateControl::forget(victim->mac);
+#endif
+        victim->in_use = false;
+    }
+
+    esp_now_peer_info_t peerInfo = {};
+    peerInfo.channel = 0; // Follow the radio's current channel
+    peerInfo.ifidx = static_cast<wifi_interface_t>(ESPNOW_WIFI_IF);
+    peerInfo.encrypt = false;
+    std::memcpy(peerInfo.peer_addr, mac_addr, ESP_NOW_ETH_ALEN);
+    esp_err_t result = esp_now_add_peer(&peerInfo);
+    if (result != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add peer: MAC=" MACSTR ", error=%s", MAC2STR(mac_addr), esp_err_to_name(result));
+        return false;
+    }
+
+    std::memcpy(victim->mac, mac_addr, ESP_NOW_ETH_ALEN);
+    victim->last_used = ++peerSlotClock;
+    victim->in_use = true;
+    return true;
+}
+
+esp_err_t Sender::transmit(SendParams &sendParams) {
+    static const uint8_t noMac[ESP_NOW_ETH_ALEN] = {0};
+    bool unicast = std::memcmp(sendParams.dest_mac, noMac, ESP_NOW_ETH_ALEN) != 0;
+
+#if ENABLE_CHANNEL_AGILITY
+    // The reactor holds frames back while a survey runs, so this is a bug. The frame
+    // has its sequence number already, and receivers will count it as lost.
+    if (surveying()) {
+        ESP_LOGE(TAG, "Frame type=%d sent during a channel survey", reinterpret_cast<const MessageData *>(sendParams.raw_data)->payload_type);
+        return ESP_ERR_INVALID_STATE;
+    }
+#endif
+
+#if USE_POINT_TO_POINT
+    if (!unicast && PeerRegistry::empty()) {
+        ESP_LOGW(TAG, "No registered nodes. Skipping message send.");
+        return ESP_ERR_ESPNOW_NOT_FOUND;
+    }
+#endif
+
+    if (unicast && !ensurePeerSlot(sendParams.dest_mac)) {
+        return ESP_ERR_ESPNOW_FULL;
+    }
+
+#if ENABLE_RATE_CONTROL
+    if (unicast) {
+        int8_t rssiHint = 0;
+#if ENABLE_TELEMETRY
+        const PeerEntry *peer = PeerRegistry::find(sendParams.dest_mac);
+        if (peer && peer->telemetry.reported) {
+            rssiHint = static_cast<int8_t>(peer->telemetry.values[TELEMETRY_RSSI]);
+        }
+#endif
+        RateControl::beforeSend(sendParams.dest_mac, rssiHint);
+    }
+#endif
+
+#if ENABLE_LATENCY_TRACING || ENABLE_WAKE_ALIGNMENT
+    // Stamp the transmit time as late as possible, which invalidates the CRC
+    auto *messageData = reinterpret_cast<MessageData *>(sendParams.raw_data);
+#if ENABLE_LATENCY_TRACING
+    if (messageData->flags & MESSAGE_FLAG_TRACE) {
+        auto *trace = reinterpret_cast<TraceExtension *>(messageData->payload);
+        trace->transmit_us = static_cast<uint32_t>(esp_timer_get_time());
+    }
+#endif
+#if ENABLE_WAKE_ALIGNMENT
+    if (messageData->flags & MESSAGE_FLAG_WAKE_PHASE) {
+        WakePhaseExtension wake = {WakeSchedule::currentPhaseMs()};
+        std::memcpy(sendParams.raw_data + messageExtensionOffset(messageData->flags, MESSAGE_FLAG_WAKE_PHASE),
+                    &wake, sizeof(wake));
+    }
+#endif
+    messageData->crc = computeMessageCrc(sendParams.raw_data, sendParams.data_len);
+#endif
+
+    esp_err_t result = esp_now_send(unicast ? sendParams.dest_mac : broadcastMac, sendParams.raw_data, sendParams.data_len);
+    if (result == ESP_OK) {
+        reactorFramesSent++;
+#if ENABLE_FRAME_TRACE
+        FrameTrace::record(FRAME_TRACE_TX | (unicast ? 0 : FRAME_TRACE_BROADCAST), unicast ? sendParams.dest_mac : broadcastMac,
+                           0, sendParams.raw_data, sendParams.data_len);
+#endif
+        if (unicast) {
+            ESP_LOGD(TAG, "Message sent successfully to MAC=" MACSTR, MAC2STR(sendParams.dest_mac));
+        } else {
+            ESP_LOGD(TAG, "Message broadcast to %zu nodes", PeerRegistry::size());
+            // A fleet broadcast reaches all nodes, so it also serves as their keepalive.
+            // Targeted ones do not: receivers outside the target drop them unseen.
+            uint8_t flags = reinterpret_cast<const MessageData *>(sendParams.raw_data)->flags;
+            if (!(flags & (MESSAGE_FLAG_DESTINATION | MESSAGE_FLAGS_TARGETED))) {
+                timers.schedule(TIMER_KEEPALIVE, xTaskGetTickCount() + pdMS_TO_TICKS(ESPNOW_KEEPALIVE_IDLE_MS));
+            }
+        }
+    } else {
+        ESP_LOGE(TAG, "Failed to send message error=%s", esp_err_to_name(result));
+    }
+    return result;
+}
+
+void Sender::handleTimer(uint8_t timerId) {
+    switch (timerId) {
+        case TIMER_APP_SEND: {
+            // Test traffic: random bytes sent as a ChangePattern payload
+            static uint8_t payload[128]; // Adjust size as needed
+            esp_fill_random(payload, sizeof(payload));
+            prepareSendParams(reactorSendParams, payload, sizeof(payload), PayloadType::ChangePattern);
+            // Keep generating traffic for as long as there are peers to send to
+            if (transmitAligned(reactorSendParams) != ESP_ERR_ESPNOW_NOT_FOUND) {
+                timers.schedule(TIMER_APP_SEND, xTaskGetTickCount() + pdMS_TO_TICKS(SENDER_APP_SEND_INTERVAL_MS));
+            }
+            break;
+        }
+
+        case TIMER_KEEPALIVE:
+            // Only reached after ESPNOW_KEEPALIVE_IDLE_MS without a fleet broadcast
+            if (sendKeepalive() != ESP_OK) {
+                // Retry after another idle period rather than going silent
+                timers.schedule(TIMER_KEEPALIVE, xTaskGetTickCount() + pdMS_TO_TICKS(ESPNOW_KEEPALIVE_IDLE_MS));
             }
+            break;
+
+#if ENABLE_SHOW_STATE
+        case TIMER_STATE_ADVERTISE:
+            // Busy fleets never go idle long enough for TIMER_KEEPALIVE
+            sendKeepalive();
+            break;
 
-            // Check if there are any registered peers
-            esp_now_peer_num_t peerCount = {};
-            esp_now_get_peer_num(&peerCount);
+        case TIMER_STATE_REPLY:
+            broadcastStateDelta(ShowState::current().epoch, stateRequestBase);
+            stateRequested = false;
+            break;
+#endif
 
-            if (esp_log_level_get(TAG) == ESP_LOG_DEBUG) {
-                ESP_LOGD(TAG, "processOutgoingMessages: Registered peers: %d", peerCount.total_num);
+        case TIMER_STATS:
+            ESP_LOGI(TAG, "Reactor: %lu wakeups, %lu frames sent in the last %d s, stack high-water mark %u bytes",
+                     static_cast<unsigned long>(reactorWakeups), static_cast<unsigned long>(reactorFramesSent),
+                     SENDER_STATS_INTERVAL_MS / 1000, static_cast<unsigned>(uxTaskGetStackHighWaterMark(nullptr) * sizeof(StackType_t)));
+            reactorWakeups = 0;
+            reactorFramesSent = 0;
+#if ENABLE_WAKE_ALIGNMENT
+            if (wakeCopiesSent > 0) {
+                // Radio duty cycle of the receivers against the latency the sender adds
+                ESP_LOGI(TAG, "Wake alignment: %lu frames held for %zu transmit points (%zu nodes unplanned), "
+                         "%lu copies, mean hold %lu ms, receiver duty cycle %d%%",
+                         static_cast<unsigned long>(wakeFramesHeld), WakeSchedule::pointCount(), WakeSchedule::unplannedPeers(),
+                         static_cast<unsigned long>(wakeCopiesSent), static_cast<unsigned long>(wakeHoldMsTotal / wakeCopiesSent),
+                         CONFIG_ESPNOW_WAKE_WINDOW * 100 / CONFIG_ESPNOW_WAKE_INTERVAL);
+            }
+            wakeFramesHeld = 0;
+            wakeCopiesSent = 0;
+            wakeHoldMsTotal = 0;
+#endif
+            if (uint32_t dropped = incomingFrames.takeDropped()) {
+                ESP_LOGW(TAG, "Incoming queue full: %lu uplink frames dropped", static_cast<unsigned long>(dropped));
+            }
+            if (sendDroppedOldest > 0 || sendRejected > 0) {
+                ESP_LOGW(TAG, "Outgoing slots full: %lu frames dropped for newer ones, %lu sends rejected",
+                         static_cast<unsigned long>(sendDroppedOldest.exchange(0)), static_cast<unsigned long>(sendRejected.exchange(0)));
+            }
+#if ENABLE_RATE_CONTROL
+            RateControl::logRates();
+#endif
+            // Nodes are only ever added, so a changed count means new members
+            if (PeerRegistry::size() != loggedPeerCount) {
                 logRegisteredPeers();
+                loggedPeerCount = PeerRegistry::size();
             }
+            timers.schedule(TIMER_STATS, xTaskGetTickCount() + pdMS_TO_TICKS(SENDER_STATS_INTERVAL_MS));
+            break;
 
-            if (peerCount.total_num == 0) {
-                ESP_LOGW(TAG, "No registered peers. Skipping message send.");
-                delete sendParams;
-                continue;
+        case TIMER_REGISTRATION_ACK:
+            flushRegistrations();
+            break;
+
+#if ENABLE_PAIRING_PERSISTENCE
+        case TIMER_PAIRING_SAVE:
+            Pairing::savePeers();
+            break;
+#endif
+
+#if ENABLE_CHANNEL_AGILITY
+        case TIMER_CHANNEL_SURVEY:
+            stepChannelSurvey();
+            break;
+
+        case TIMER_CHANNEL_SWITCH:
+            stepChannelSwitch();
+            break;
+#endif
+
+#if ENABLE_TELEMETRY
+        case TIMER_TELEMETRY_CONFIG: {
+            TelemetryConfigPayload config = {};
+            config.interval_s = Telemetry::intervalForFleet(PeerRegistry::size()) / 1000;
+            prepareSendParams(reactorSendParams, reinterpret_cast<const uint8_t *>(&config), sizeof(config), PayloadType::TelemetryConfig);
+            transmitAligned(reactorSendParams);
+            break;
+        }
+
+        case TIMER_FLEET_SUMMARY: {
+            logFleetSummary();
+#if ENABLE_CHANNEL_AGILITY || ENABLE_RATE_CONTROL
+            // Loss since the previous summary; reading it resets the window
+            uint32_t fleetLoss = recentFleetLossPermille();
+#endif
+#if ENABLE_CHANNEL_AGILITY
+            if (fleetLoss > CHANNEL_LOSS_TRIGGER_PERMILLE && surveyNext == 0 && pendingChannel == 0 &&
+                xTaskGetTickCount() - lastSurveyAt >= pdMS_TO_TICKS(CHANNEL_LOSS_SURVEY_GAP_MS)) {
+                ESP_LOGW(TAG, "High fleet loss on channel %u, surveying early", homeChannel);
+                timers.schedule(TIMER_CHANNEL_SURVEY, xTaskGetTickCount());
             }
+#endif
+#if ENABLE_RATE_CONTROL
+            RateControl::updateBroadcast(PeerRegistry::begin(), PeerRegistry::end(), fleetLoss);
+#endif
+            timers.schedule(TIMER_FLEET_SUMMARY, xTaskGetTickCount() + pdMS_TO_TICKS(FLEET_SUMMARY_INTERVAL_MS));
+            break;
+        }
+#endif
+
+#if ENABLE_WAKE_ALIGNMENT
+        case TIMER_WAKE_WINDOW:
+            flushWakeWindow();
+            break;
 
-            // Get number of peers registered
-            esp_err_t result = esp_now_send(nullptr, sendParams->raw_data, sendParams->data_len);
-            if (result == ESP_OK) {
-                ESP_LOGI(TAG, "Message sent successfully to %d receivers", peerCount.total_num);
-            } else {
-                ESP_LOGE(TAG, "Failed to send message error=%s", esp_err_to_name(result));
+        case TIMER_WAKE_PROBE: {
+            // Sent straight away, at a random phase, so receivers keep hearing frames
+            // all across their windows and not just at the points we aim for
+            uint8_t probePayload[1] = {0};
+            if (!PeerRegistry::empty()) {
+                prepareSendParams(reactorSendParams, probePayload, sizeof(probePayload), PayloadType::Keepalive);
+                transmit(reactorSendParams);
             }
+            uint32_t delayMs = WAKE_PROBE_INTERVAL_MS / 2 + esp_random() % WAKE_PROBE_INTERVAL_MS;
+            timers.schedule(TIMER_WAKE_PROBE, xTaskGetTickCount() + pdMS_TO_TICKS(delayMs));
+            break;
+        }
+#endif
 
-            delete sendParams;
+#if ENABLE_TDMA
+        case TIMER_TDMA_BEACON: {
+            // Sent straight away: receivers time their slots from its arrival
+            TdmaBeaconPayload beacon;
+            Tdma::nextBeacon(beacon, PeerRegistry::size());
+            if (!PeerRegistry::empty()) {
+                prepareSendParams(reactorSendParams, reinterpret_cast<const uint8_t *>(&beacon), sizeof(beacon),
+                                  PayloadType::TdmaBeacon);
+                transmit(reactorSendParams);
+            }
+            timers.schedule(TIMER_TDMA_BEACON, xTaskGetTickCount() + pdMS_TO_TICKS(TDMA_SUPERFRAME_MS));
+            break;
         }
+#endif
+
+#if ENABLE_LATENCY_TRACING
+        case TIMER_LATENCY_REPORT: {
+            prepareSendParams(reactorSendParams, nullptr, 0, PayloadType::LatencyReportRequest);
+            transmitAligned(reactorSendParams);
+            timers.schedule(TIMER_LATENCY_REPORT, xTaskGetTickCount() + pdMS_TO_TICKS(LATENCY_REPORT_INTERVAL_MS));
+            break;
+        }
+#endif
+
+        default:
+            ESP_LOGW(TAG, "Unknown reactor timer: %d", timerId);
+            break;
     }
 }
 
-void Sender::prepareSendParams(SendParams &sendParams, const uint8_t *payload, size_t payload_len, PayloadType payload_type) {
-    // Log payload length and buffer sizes
-    ESP_LOGD(TAG, "Payload length: %zu, raw_data size: %zu", payload_len, sizeof(sendParams.raw_data));
+#if ENABLE_CHANNEL_AGILITY
+// Measures one channel per call, CHANNEL_SURVEY_DWELL_MS apart, so the reactor keeps
+// handling other work during a survey. Afterwards migrates the fleet if another
+// channel is clearly quieter.
+void Sender::stepChannelSurvey() {
+    TickType_t now = xTaskGetTickCount();
+    if (pendingChannel != 0) {
+        // Still migrating from the last survey
+        timers.schedule(TIMER_CHANNEL_SURVEY, now + pdMS_TO_TICKS(CHANNEL_SURVEY_INTERVAL_MS));
+        return;
+    }
 
-    // Validate payload length
-    if (payload_len > ESP_NOW_MAX_DATA_LEN_V2 - sizeof(MessageData)) {
-        ESP_LOGE(TAG, "Payload length exceeds maximum allowed: %zu", payload_len);
+    if (surveyNext == 0) {
+        ESP_LOGI(TAG, "Surveying channels %d-%d", ESPNOW_CHANNEL_MIN, ESPNOW_CHANNEL_MAX);
+        ChannelSurvey::begin();
+        surveyNext = ESPNOW_CHANNEL_MIN;
+    }
+    if (surveyNext <= ESPNOW_CHANNEL_MAX) {
+        ChannelSurvey::measure(surveyNext++);
+        timers.schedule(TIMER_CHANNEL_SURVEY, now + pdMS_TO_TICKS(CHANNEL_SURVEY_DWELL_MS));
         return;
     }
 
-    // Calculate the total size needed for MessageData and the payload
-    size_t messageDataSize = sizeof(MessageData) + payload_len;
+    surveyNext = 0;
+    lastSurveyAt = now;
+    ChannelSurvey::end(homeChannel);
+    timers.schedule(TIMER_CHANNEL_SURVEY, now + pdMS_TO_TICKS(CHANNEL_SURVEY_INTERVAL_MS));
+    resumeAfterSurvey();
+
+    uint8_t best = ChannelSurvey::best(homeChannel);
+    if (best != homeChannel) {
+        ESP_LOGI(TAG, "Moving fleet from channel %u to %u in %d ms", homeChannel, best, ESPNOW_CHANNEL_SWITCH_DELAY_MS);
+        pendingChannel = best;
+        switchAt = now + pdMS_TO_TICKS(ESPNOW_CHANNEL_SWITCH_DELAY_MS);
+        stepChannelSwitch();
+    }
+}
+
+// Sends what queued up while the survey had the radio: committed slots, group
+// assignments, show state changes, and every timer that expired meanwhile
+void Sender::resumeAfterSurvey() {
+    TickType_t now = xTaskGetTickCount();
+    for (uint8_t timerId = 0; timerId < TIMER_COUNT; timerId++) {
+        if (deferredTimers & (1u << timerId)) {
+            timers.schedule(timerId, now);
+        }
+    }
+    deferredTimers = 0;
+
+    drainOutgoingMessages();
+    drainGroupAssignments();
+#if ENABLE_SHOW_STATE
+    if (ShowState::current().version != lastDeltaVersion) {
+        broadcastStateDelta(ShowState::current().epoch, lastDeltaVersion);
+    }
+#endif
+}
 
-    // Dynamically allocate memory for MessageData and its payload
-    MessageData *messageData = reinterpret_cast<MessageData *>(malloc(messageDataSize));
-    if (!messageData) {
-        ESP_LOGE(TAG, "Failed to allocate memory for MessageData");
+// Each announcement carries the time left, so a receiver that only hears the last
+// one still switches together with everyone else
+void Sender::stepChannelSwitch() {
+    TickType_t now = xTaskGetTickCount();
+    TickType_t remaining = static_cast<int32_t>(switchAt - now) > 0 ? switchAt - now : 0;
+    if (remaining == 0) {
+        Manager::switchChannel(pendingChannel);
+        homeChannel = pendingChannel;
+        pendingChannel = 0;
         return;
     }
 
-    // Initialize the fixed fields of MessageData
-    messageData->seq_num = getNextSequenceNumber(sendParams.dest_mac);
-    messageData->payload_type = static_cast<uint8_t>(payload_type);
+    ChannelSwitchPayload payload = {pendingChannel, static_cast<uint16_t>(pdTICKS_TO_MS(remaining))};
+    prepareSendParams(reactorSendParams, reinterpret_cast<const uint8_t *>(&payload), sizeof(payload), PayloadType::ChannelSwitch);
+    transmit(reactorSendParams);
 
-    ESP_LOGI(TAG, "Preparing to send payload type: %d", messageData->payload_type);
+    TickType_t interval = pdMS_TO_TICKS(ESPNOW_CHANNEL_SWITCH_DELAY_MS / ESPNOW_CHANNEL_SWITCH_REPEATS);
+    timers.schedule(TIMER_CHANNEL_SWITCH, now + (remaining < interval ? remaining : interval));
+}
+#endif
 
-    // Copy the payload into the flexible array member
-    memcpy(messageData->payload, payload, payload_len);
+esp_err_t Sender::transmitAligned(SendParams &sendParams) {
+#if !ENABLE_WAKE_ALIGNMENT
+    return transmit(sendParams);
+#else
+    static const uint8_t noMac[ESP_NOW_ETH_ALEN] = {0};
+    if (std::memcmp(sendParams.dest_mac, noMac, ESP_NOW_ETH_ALEN) != 0) {
+        return transmit(sendParams); // Unicast has the MAC layer's retries instead
+    }
 
-    // Set the CRC field to 0 before calculating the CRC
-    messageData->crc = 0;
+    HeldFrame *slot = nullptr;
+    bool holding = false;
+    for (HeldFrame &held : heldFrames) {
+        if (held.pending) {
+            holding = true;
+        } else if (!slot) {
+            slot = &held;
+        }
+    }
+    // Held frames refer to transmit points by index, so only replan between them
+    if (wakePlanStale && !holding) {
+        WakeSchedule::plan(PeerRegistry::begin(), PeerRegistry::end());
+        wakePlanStale = false;
+    }
 
-    // Calculate CRC over the entire copied structure
-    uint16_t calculatedCrc = esp_crc16_le(UINT16_MAX, reinterpret_cast<const uint8_t *>(messageData), messageDataSize);
+    // Frames for one node wait for its point only; fleet frames for every point
+    auto *messageData = reinterpret_cast<const MessageData *>(sendParams.raw_data);
+    uint8_t pending = 0;
+    bool sendNow = WakeSchedule::unplannedPeers() > 0;
+    if (messageData->flags & MESSAGE_FLAG_DESTINATION) {
+        DestinationExtension destination;
+        std::memcpy(&destination, sendParams.raw_data + messageExtensionOffset(messageData->flags, MESSAGE_FLAG_DESTINATION),
+                    sizeof(destination));
+        PeerEntry *peer = PeerRegistry::find(destination.node_id);
+        sendNow = !peer || peer->wake_point == WAKE_POINT_NONE;
+        if (!sendNow) {
+            pending = 1 << peer->wake_point;
+        }
+    } else {
+        pending = static_cast<uint8_t>((1u << WakeSchedule::pointCount()) - 1);
+    }
 
-    messageData->crc = calculatedCrc;
+    if (pending && !slot) {
+        ESP_LOGW(TAG, "No free wake hold slot, sending type=%d unaligned", messageData->payload_type);
+        pending = 0;
+        sendNow = true;
+    }
 
-    ESP_LOGI(TAG, "Calculated CRC: %04X", messageData->crc);
+    esp_err_t result = ESP_OK;
+    if (sendNow || !pending) {
+        result = transmit(sendParams);
+    }
+    if (pending) {
+        slot->params = sendParams;
+        slot->pending = pending;
+        slot->held_at_us = esp_timer_get_time();
+        wakeFramesHeld++;
+        scheduleWakeWindow();
+    }
+    return result;
+#endif
+}
 
-    // Ensure raw_data buffer is large enough to hold the entire messageData
-    if (messageDataSize > sizeof(sendParams.raw_data)) {
-        ESP_LOGE(TAG, "raw_data buffer size is insufficient");
-        free(messageData);
+#if ENABLE_WAKE_ALIGNMENT
+void Sender::flushWakeWindow() {
+    int64_t now = esp_timer_get_time();
+    for (size_t point = 0; point < WakeSchedule::pointCount(); point++) {
+        if (!WakeSchedule::due(WakeSchedule::pointPhaseMs(point))) {
+            continue;
+        }
+        for (HeldFrame &held : heldFrames) {
+            if (held.pending & (1 << point)) {
+                held.pending &= ~(1 << point);
+                transmit(held.params);
+                wakeCopiesSent++;
+                wakeHoldMsTotal += (now - held.held_at_us) / 1000;
+            }
+        }
+    }
+    scheduleWakeWindow();
+}
+
+void Sender::scheduleWakeWindow() {
+    uint8_t pending = 0;
+    for (const HeldFrame &held : heldFrames) {
+        pending |= held.pending;
+    }
+    if (!pending) {
+        timers.cancel(TIMER_WAKE_WINDOW);
         return;
     }
 
-    // Copy the entire messageData (including the payload) into raw_data
-    memcpy(sendParams.raw_data, messageData, messageDataSize);
-    sendParams.data_len = messageDataSize;
+    uint32_t soonestMs = UINT32_MAX;
+    for (size_t point = 0; point < WakeSchedule::pointCount(); point++) {
+        if (pending & (1 << point)) {
+            soonestMs = std::min(soonestMs, WakeSchedule::msUntil(WakeSchedule::pointPhaseMs(point)));
+        }
+    }
+    // Rounded up, so the timer never fires before the point
+    TickType_t ticks = (soonestMs + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+    timers.schedule(TIMER_WAKE_WINDOW, xTaskGetTickCount() + ticks);
+}
+#endif
 
-    // Free the allocated memory for messageData
-    free(messageData);
+// Carries the show state version when that is replicated, otherwise a single byte
+esp_err_t Sender::sendKeepalive() {
+#if ENABLE_SHOW_STATE
+    StateVersionPayload keepalivePayload = ShowState::current();
+    timers.schedule(TIMER_STATE_ADVERTISE, xTaskGetTickCount() + pdMS_TO_TICKS(STATE_ADVERTISE_INTERVAL_MS));
+#else
+    uint8_t keepalivePayload[1] = {0}; // Minimal payload for keepalive
+#endif
+    prepareSendParams(reactorSendParams, reinterpret_cast<const uint8_t *>(&keepalivePayload), sizeof(keepalivePayload),
+                      PayloadType::Keepalive);
+    esp_err_t result = transmit(reactorSendParams);
+    return result == ESP_ERR_ESPNOW_NOT_FOUND ? ESP_OK : result;
 }
 
-void Sender::sendLoop(void *pvParameter) {
-    ESP_LOGI(TAG, "Send loop task started");
+#if ENABLE_SHOW_STATE
+// Fleet frame bringing every receiver at `base_version` of `epoch` or later up to
+// date; a snapshot if they share nothing with us
+void Sender::broadcastStateDelta(uint16_t epoch, uint32_t base_version) {
+    uint8_t delta[SHOW_STATE_MAX_ENCODED_LEN];
+    size_t len = ShowState::encodeDelta(epoch, base_version, delta, sizeof(delta));
+    StateDeltaHeader header;
+    std::memcpy(&header, delta, sizeof(header));
+    ESP_LOGI(TAG, "Show state delta %lu -> %lu, fields 0x%04x", static_cast<unsigned long>(header.base_version),
+             static_cast<unsigned long>(header.version), header.field_mask);
+    prepareSendParams(reactorSendParams, delta, len, PayloadType::StateDelta);
+    transmitAligned(reactorSendParams);
+    lastDeltaVersion = std::max(lastDeltaVersion, header.version);
+    timers.schedule(TIMER_STATE_ADVERTISE, xTaskGetTickCount() + pdMS_TO_TICKS(STATE_ADVERTISE_INTERVAL_MS));
+}
+#endif
 
-    static uint8_t payload[128]; // Adjust size as needed
+void Sender::prepareSendParams(SendParams &sendParams, const uint8_t *payload, size_t payload_len, PayloadType payload_type,
+                               NodeId dest_node) {
+    prepareSendParams(sendParams, payload, payload_len, payload_type, FrameTarget::toNode(dest_node));
+}
 
-    while (true) {
-        // Check if there are any registered peers
-        esp_now_peer_num_t peerCount = {};
-        esp_now_get_peer_num(&peerCount);
+void Sender::prepareSendParams(SendParams &sendParams, const uint8_t *payload, size_t payload_len, PayloadType payload_type,
+                               const FrameTarget &target) {
+    // Log payload length and buffer sizes
+    ESP_LOGD(TAG, "Payload length: %zu, raw_data size: %zu", payload_len, sizeof(sendParams.raw_data));
 
-        if (peerCount.total_num == 0) {
-            ESP_LOGD(TAG, "No registered peers. Skipping message queueing.");
-            vTaskDelay(1000 / portTICK_PERIOD_MS); // Delay before checking again
-            continue;
-        }
+    uint8_t flags = SENDER_FRAME_FLAGS | target.flag;
+    size_t headerLen = messageHeaderLength(flags);
 
-        esp_fill_random(payload, sizeof(payload));
+    // Validate payload length
+    if (payload_len > ESP_NOW_MAX_DATA_LEN_V2 - headerLen) {
+        ESP_LOGE(TAG, "Payload length exceeds maximum allowed: %zu", payload_len);
+        return;
+    }
 
-        auto *sendParams = new SendParams;
-        prepareSendParams(*sendParams, payload, sizeof(payload), PayloadType::ChangePattern);
+    // Build the frame in place: header, extensions and payload go straight into raw_data
+    size_t messageDataSize = headerLen + payload_len;
+    uint8_t *frame = sendParams.raw_data;
+    MessageData *messageData = reinterpret_cast<MessageData *>(frame);
 
-        if (xQueueSend(outgoingMessageQueue, &sendParams, portMAX_DELAY) != pdTRUE) {
-            ESP_LOGE(TAG, "Failed to enqueue message");
-            delete sendParams;
-        }
+    // Initialize the fixed fields of MessageData
+    messageData->seq_num = getNextSequenceNumber(target);
+    messageData->payload_type = static_cast<uint8_t>(payload_type);
+    messageData->flags = flags;
 
-        // Delay for 1 second before sending the next message
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
+#if ENABLE_LATENCY_TRACING
+    // transmit_us is filled in by transmit()
+    TraceExtension trace = {static_cast<uint32_t>(esp_timer_get_time()), 0};
+    memcpy(messageData->payload, &trace, sizeof(trace));
+#endif
+    if (flags & MESSAGE_FLAG_DESTINATION) {
+        DestinationExtension destination = {target.node};
+        memcpy(frame + messageExtensionOffset(flags, MESSAGE_FLAG_DESTINATION), &destination, sizeof(destination));
+    }
+#if ENABLE_RELAY
+    RelayExtension relay = {};
+    memcpy(relay.origin, ownMac, ESP_NOW_ETH_ALEN);
+    relay.hops_left = RELAY_MAX_HOPS;
+    memcpy(frame + messageExtensionOffset(flags, MESSAGE_FLAG_RELAY), &relay, sizeof(relay));
+#endif
+#if ENABLE_WAKE_ALIGNMENT
+    // phase_ms is filled in by transmit()
+    WakePhaseExtension wake = {0};
+    memcpy(frame + messageExtensionOffset(flags, MESSAGE_FLAG_WAKE_PHASE), &wake, sizeof(wake));
+#endif
+    if (flags & MESSAGE_FLAG_GROUPS) {
+        GroupsExtension groups = {target.groups};
+        memcpy(frame + messageExtensionOffset(flags, MESSAGE_FLAG_GROUPS), &groups, sizeof(groups));
+    }
+    if (flags & MESSAGE_FLAG_NODE_BITMAP) {
+        memcpy(frame + messageExtensionOffset(flags, MESSAGE_FLAG_NODE_BITMAP), &target.bitmap, sizeof(target.bitmap));
     }
-}
 
-void Sender::sendKeepalive(void *pvParameter) {
-    ESP_LOGI(TAG, "Keepalive task started");
+    // Copy the payload after the header extensions
+    if (payload_len > 0) {
+        memcpy(frame + headerLen, payload, payload_len);
+    }
 
-    while (true) {
-        // Check if there are any registered peers
-        esp_now_peer_num_t peerCount = {};
-        esp_now_get_peer_num(&peerCount);
+#if ENABLE_AUTH
+    // Signed last, once everything the tag covers is in place
+    Auth::sign(frame, messageDataSize);
+#endif
 
-        if (peerCount.total_num == 0) {
-            ESP_LOGD(TAG, "No registered peers. Skipping keepalive message.");
-            vTaskDelay(5000 / portTICK_PERIOD_MS); // Delay before checking again
-            continue;
-        }
+    // Set the CRC field to 0 before calculating the CRC
+    messageData->crc = 0;
+    messageData->crc = esp_crc16_le(UINT16_MAX, frame, messageDataSize);
+    sendParams.data_len = messageDataSize;
 
-        // Prepare the keepalive payload
-        uint8_t keepalivePayload[1] = {0}; // Minimal payload for keepalive
+    ESP_LOGD(TAG, "Prepared payload type %d, seq %u, CRC %04X", messageData->payload_type, messageData->seq_num,
+             messageData->crc);
+}
 
-        auto *sendParams = new SendParams;
-        prepareSendParams(*sendParams, keepalivePayload, sizeof(keepalivePayload), PayloadType::Keepalive);
+void Sender::logRegisteredPeers() {
+    ESP_LOGI(TAG, "Total registered nodes: %zu", PeerRegistry::size());
 
-        if (xQueueSend(outgoingMessageQueue, &sendParams, portMAX_DELAY) != pdTRUE) {
-            ESP_LOGE(TAG, "Failed to enqueue keepalive message");
-            delete sendParams;
-        }
+    TickType_t now = xTaskGetTickCount();
+    for (const PeerEntry *peer = PeerRegistry::begin(); peer != PeerRegistry::end(); ++peer) {
+        ESP_LOGD(TAG, "Node %u: MAC=" MACSTR ", last heard %lus ago", peer->node_id, MAC2STR(peer->mac),
+                 static_cast<unsigned long>(pdTICKS_TO_MS(now - peer->last_heard) / 1000));
+    }
+}
 
-        // Delay for 5 seconds before sending the next keepalive message
-        vTaskDelay(5000 / portTICK_PERIOD_MS);
+#if ENABLE_TELEMETRY
+void Sender::applyTelemetry(const uint8_t *mac_addr, const uint8_t *payload, size_t payload_len) {
+    TelemetryReport report;
+    if (!Telemetry::decodeReport(payload, payload_len, report)) {
+        ESP_LOGE(TAG, "Malformed telemetry from MAC=" MACSTR, MAC2STR(mac_addr));
+        return;
+    }
+
+    PeerEntry *entry = PeerRegistry::find(mac_addr);
+    if (!entry) {
+        ESP_LOGW(TAG, "Telemetry from unregistered MAC=" MACSTR, MAC2STR(mac_addr));
+        return;
+    }
+    PeerTelemetry &peer = entry->telemetry;
+
+    bool keyframe = report.flags & TELEMETRY_FLAG_KEYFRAME;
+    if (keyframe) {
+        peer.synced = true;
+    } else if (static_cast<uint8_t>(peer.last_seq + 1) != report.seq) {
+        // A lost report means our base is wrong until the next keyframe
+        peer.synced = false;
+    }
+    peer.last_seq = report.seq;
+    peer.last_report = xTaskGetTickCount();
+    peer.reported = true;
+
+    for (uint8_t field = 0; field < TELEMETRY_FIELD_COUNT; field++) {
+        peer.values[field] = keyframe ? report.deltas[field] : peer.values[field] + report.deltas[field];
     }
 }
 
-void Sender::logRegisteredPeers() {
-    esp_now_peer_num_t peerCount = {};
-    esp_now_get_peer_num(&peerCount);
+// Fleet-wide loss since the previous call, from the receivers' cumulative counters
+uint32_t Sender::recentFleetLossPermille() {
+    static uint32_t previousFrames = 0;
+    static uint32_t previousLost = 0;
+
+    uint32_t frames = 0;
+    uint32_t lost = 0;
+    for (const PeerEntry *entry = PeerRegistry::begin(); entry != PeerRegistry::end(); ++entry) {
+        if (entry->telemetry.synced) {
+            frames += entry->telemetry.values[TELEMETRY_FRAMES];
+            lost += entry->telemetry.values[TELEMETRY_LOST];
+        }
+    }
 
-    ESP_LOGI(TAG, "Total registered peers: %d", peerCount.total_num);
+    // Totals shrink when a receiver drops out of sync; start over from here
+    uint32_t permille = 0;
+    if (frames >= previousFrames && lost >= previousLost) {
+        uint32_t expected = (frames - previousFrames) + (lost - previousLost);
+        permille = expected ? (lost - previousLost) * 1000 / expected : 0;
+    }
+    previousFrames = frames;
+    previousLost = lost;
+    return permille;
+}
 
-    if (peerCount.total_num > 0) {
-        esp_now_peer_info_t peerInfo = {};
+void Sender::logFleetSummary() {
+    size_t reporting = 0;
+    for (const PeerEntry *entry = PeerRegistry::begin(); entry != PeerRegistry::end(); ++entry) {
+        reporting += entry->telemetry.reported;
+    }
+    if (reporting == 0) {
+        return;
+    }
 
-        for (int i = 0; i < peerCount.total_num; i++) {
-            if (esp_now_fetch_peer(true, &peerInfo) == ESP_OK) {
-                ESP_LOGI(TAG, "Peer %d: MAC=" MACSTR, i, MAC2STR(peerInfo.peer_addr));
-            } else {
-                ESP_LOGE(TAG, "Failed to fetch info for peer %d", i);
-            }
+    int32_t worstRssi = 0;
+    int32_t lowestHeap = INT32_MAX;
+    uint32_t frames = 0;
+    uint32_t lost = 0;
+    uint32_t duplicates = 0;
+    size_t stale = 0;
+    TickType_t now = xTaskGetTickCount();
+
+    // One line per receiver would be hundreds of lines a minute on a large fleet, so
+    // the per-receiver rows are DEBUG and the summary is the only INFO line
+    for (const PeerEntry *entry = PeerRegistry::begin(); entry != PeerRegistry::end(); ++entry) {
+        const PeerTelemetry &peer = entry->telemetry;
+        if (!peer.reported) {
+            continue;
         }
+        const uint8_t *mac = entry->mac;
+        const int32_t *v = peer.values;
+        ESP_LOGD(TAG, "  " MACSTR " rssi=%ld frames=%ld lost=%ld dup=%ld qhwm=%ld heap=%ld/%ld age=%lus%s",
+                 MAC2STR(mac), static_cast<long>(v[TELEMETRY_RSSI]), static_cast<long>(v[TELEMETRY_FRAMES]),
+                 static_cast<long>(v[TELEMETRY_LOST]), static_cast<long>(v[TELEMETRY_DUPLICATES]),
+                 static_cast<long>(v[TELEMETRY_QUEUE_HWM]), static_cast<long>(v[TELEMETRY_FREE_HEAP]),
+                 static_cast<long>(v[TELEMETRY_MIN_FREE_HEAP]),
+                 static_cast<unsigned long>(pdTICKS_TO_MS(now - peer.last_report) / 1000),
+                 peer.synced ? "" : " (stale)");
+
+        if (!peer.synced) {
+            stale++;
+            continue;
+        }
+        if (v[TELEMETRY_RSSI] < worstRssi) {
+            worstRssi = v[TELEMETRY_RSSI];
+        }
+        if (v[TELEMETRY_MIN_FREE_HEAP] < lowestHeap) {
+            lowestHeap = v[TELEMETRY_MIN_FREE_HEAP];
+        }
+        frames += v[TELEMETRY_FRAMES];
+        lost += v[TELEMETRY_LOST];
+        duplicates += v[TELEMETRY_DUPLICATES];
     }
+
+    uint32_t expected = frames + lost;
+    ESP_LOGI(TAG, "Fleet telemetry from %zu receivers: worst rssi=%ld, loss=%lu/%lu (%lu.%lu%%), dup=%lu, "
+             "lowest min-heap=%ld, stale=%zu",
+             reporting, static_cast<long>(worstRssi), static_cast<unsigned long>(lost), static_cast<unsigned long>(expected),
+             static_cast<unsigned long>(expected ? lost * 100 / expected : 0),
+             static_cast<unsigned long>(expected ? (lost * 1000 / expected) % 10 : 0),
+             static_cast<unsigned long>(duplicates), static_cast<long>(lowestHeap == INT32_MAX ? 0 : lowestHeap), stale);
 }
+#endif
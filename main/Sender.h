@@ -2,26 +2,144 @@
 #define SENDER_H
 
 #include <cstdint>
-#include <unordered_map>
+#include <type_traits>
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/task.h"
 #include "esp_now.h"
 #include "Messages.h"
 #include "Manager.h"
+#include "config.h"
+
+struct PeerEntry;
+
+// Header extensions on every frame the sender builds, whatever its target
+#define SENDER_FRAME_FLAGS                                        \
+    ((ENABLE_LATENCY_TRACING ? MESSAGE_FLAG_TRACE : 0) |          \
+     (ENABLE_RELAY ? MESSAGE_FLAG_RELAY : 0) |                    \
+     (ENABLE_AUTH ? MESSAGE_FLAG_AUTH : 0) |                      \
+     (ENABLE_WAKE_ALIGNMENT ? MESSAGE_FLAG_WAKE_PHASE : 0))
+// Largest payload Sender::send accepts, leaving room for the biggest addressing extension
+#define SENDER_MAX_PAYLOAD_LEN (ESP_NOW_MAX_DATA_LEN - messageHeaderLength(SENDER_FRAME_FLAGS | MESSAGE_FLAG_NODE_BITMAP))
+// Frames Sender::send can hold for the reactor at once
+#define SENDER_SEND_SLOTS ESPNOW_QUEUE_SIZE
+
+// What Sender::send does when every slot is taken
+enum class OverflowPolicy : uint8_t {
+    Reject,     // Fail with SendStatus::Full straight away
+    DropOldest, // Discard the oldest frame still waiting and take its slot
+    Wait,       // Block for up to SendOptions::wait_ticks, then fail. Never from the reactor.
+};
+
+struct SendOptions {
+    OverflowPolicy overflow = OverflowPolicy::Reject;
+    TickType_t wait_ticks = 0; // OverflowPolicy::Wait only
+};
+
+enum class SendStatus : uint8_t {
+    Queued,
+    QueuedDroppedOldest, // Queued in place of the oldest waiting frame
+    Full,
+    TooLarge,            // The payload does not fit SENDER_MAX_PAYLOAD_LEN
+    NotStarted,          // Sender::init has not run
+};
+
+// A frame requested through Sender::send. The producer encodes the payload straight
+// into the slot; the reactor adds the header when it transmits.
+struct OutgoingSlot {
+    FrameTarget target;
+    PayloadType type;
+    uint8_t len;
+    uint8_t payload[SENDER_MAX_PAYLOAD_LEN];
+};
 
 class Sender {
 public:
     static esp_err_t init();
+    // Put `node` in exactly `groups`, so frames for those groups reach it. Safe from
+    // any task. Membership is kept on the receiver, which stores it with its pairing.
+    static esp_err_t assignGroups(NodeId node, GroupMask groups);
+    // Queue `payload` for `target` from any task and return without waiting for the
+    // radio, unless options ask to wait for a free slot. The payload is consumed: pass
+    // a temporary or std::move it. Any type with a PayloadTraits specialisation works.
+    template <typename PayloadT>
+    static SendStatus send(const FrameTarget &target, PayloadT &&payload, const SendOptions &options = {}) {
+        static_assert(!std::is_lvalue_reference<PayloadT>::value, "Sender::send consumes its payload; std::move it");
+        using Traits = PayloadTraits<typename std::remove_cv<PayloadT>::type>;
+        uint8_t index;
+        SendStatus status = acquireSlot(options, index);
+        if (status != SendStatus::Queued && status != SendStatus::QueuedDroppedOldest) {
+            return status;
+        }
+        OutgoingSlot &slot = outgoingSlots[index];
+        size_t len = 0;
+        if (!Traits::encode(payload, slot.payload, sizeof(slot.payload), len)) {
+            releaseSlot(index);
+            return SendStatus::TooLarge;
+        }
+        slot.target = target;
+        slot.type = Traits::type;
+        slot.len = static_cast<uint8_t>(len);
+        commitSlot(index);
+        return status;
+    }
+#if ENABLE_SHOW_STATE
+    // Change the show state from any task. Changes go out as a StateDelta, and
+    // receivers that miss it catch up from the version in later keepalives.
+    static void setShowPattern(const char *name);
+    static void setShowBrightness(uint8_t level);
+    static void setShowParam(uint8_t index, int16_t value);
+#endif
+
+    friend class Bench;
+    friend class HostHarness; // Host tools in test/host
 
 private:
-    static void sendLoop(void *pvParameter);
+    static OutgoingSlot outgoingSlots[SENDER_SEND_SLOTS];
+    static void reactorLoop(void *pvParameter);
+    static void drainOutgoingMessages();
+    static void drainIncomingMessages();
+    static void drainGroupAssignments();
+    static void sendGroupAssign(const PeerEntry &peer);
+    static void handleIncoming(MessageEnvelope &envelope);
+    static void handleRegisterRequest(const uint8_t *mac_addr);
+    static void queueRegistrationAck(NodeId node_id);
+    static void flushRegistrations();
+    static void handleTimer(uint8_t timerId);
+    static esp_err_t transmit(SendParams &sendParams);
+    static esp_err_t transmitAligned(SendParams &sendParams); // Holds broadcasts for the receivers' wake windows
+    static esp_err_t initSendSlots();
+    static SendStatus acquireSlot(const SendOptions &options, uint8_t &index);
+    static void commitSlot(uint8_t index);
+    static bool takeCommittedSlot(uint8_t &index, TickType_t ticksToWait);
+    static void releaseSlot(uint8_t index);
     static void sendCallback(const uint8_t *mac_addr, esp_now_send_status_t status);
     static void recvCallback(const esp_now_recv_info_t *recv_info, const uint8_t *data, int len);
-    static void prepareSendParams(SendParams &sendParams, const uint8_t *payload, size_t payload_len, PayloadType payload_type);
-    static uint16_t getNextSequenceNumber(const uint8_t *mac_addr);
-    static void processOutgoingMessages(void *pvParameter);
+    static bool ensurePeerSlot(const uint8_t *mac_addr);
+    static void prepareSendParams(SendParams &sendParams, const uint8_t *payload, size_t payload_len, PayloadType payload_type,
+                                  NodeId dest_node = NODE_ID_BROADCAST);
+    static void prepareSendParams(SendParams &sendParams, const uint8_t *payload, size_t payload_len, PayloadType payload_type,
+                                  const FrameTarget &target);
+    static uint16_t getNextSequenceNumber(const FrameTarget &target);
+    static esp_err_t sendKeepalive();
+#if ENABLE_SHOW_STATE
+    static void broadcastStateDelta(uint16_t epoch, uint32_t base_version);
+#endif
     static void logRegisteredPeers();
-    static void sendKeepalive(void *pvParameter);
+#if ENABLE_CHANNEL_AGILITY
+    static void stepChannelSurvey();
+    static void resumeAfterSurvey();
+    static void stepChannelSwitch();
+#endif
+#if ENABLE_WAKE_ALIGNMENT
+    static void flushWakeWindow();
+    static void scheduleWakeWindow();
+#endif
+#if ENABLE_TELEMETRY
+    static void applyTelemetry(const uint8_t *mac_addr, const uint8_t *payload, size_t payload_len);
+    static void logFleetSummary();
+    static uint32_t recentFleetLossPermille();
+#endif
 };
 
 #endif // SENDER_H
\ No newline at end of file
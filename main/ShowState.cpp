@@ -0,0 +1,183 @@
+#include "ShowState.h"
+
+#if ENABLE_SHOW_STATE
+
+#include "esp_log.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include <cstring>
+
+static const char *TAG = "ShowState";
+
+// Setters run on application tasks, deltas are built by the sender's reactor and
+// applied by the receive loop
+static portMUX_TYPE stateLock = portMUX_INITIALIZER_UNLOCKED;
+static ShowStateValues values = {};
+static uint16_t epoch = 0;   // 0 on a receiver until its first snapshot
+static uint32_t version = 0;
+static uint32_t fieldVersions[SHOW_FIELD_COUNT] = {}; // Sender only: version that last changed each field
+
+static size_t fieldSize(uint8_t field) {
+    switch (field) {
+        case SHOW_FIELD_PATTERN:
+            return SHOW_PATTERN_NAME_LEN;
+        case SHOW_FIELD_BRIGHTNESS:
+            return 1;
+        default:
+            return sizeof(int16_t);
+    }
+}
+
+static uint8_t *fieldData(uint8_t field) {
+    switch (field) {
+        case SHOW_FIELD_PATTERN:
+            return reinterpret_cast<uint8_t *>(values.pattern);
+        case SHOW_FIELD_BRIGHTNESS:
+            return &values.brightness;
+        default:
+            return reinterpret_cast<uint8_t *>(&values.params[field - SHOW_FIELD_PARAM0]);
+    }
+}
+
+// Called with stateLock held
+static void stampField(uint8_t field) {
+    fieldVersions[field] = ++version;
+}
+
+void ShowState::begin() {
+    taskENTER_CRITICAL(&stateLock);
+    do {
+        epoch = static_cast<uint16_t>(esp_random());
+    } while (epoch == 0);
+    taskEXIT_CRITICAL(&stateLock);
+    ESP_LOGI(TAG, "Show state epoch %04x", epoch);
+}
+
+void ShowState::setPattern(const char *name) {
+    char padded[SHOW_PATTERN_NAME_LEN] = {};
+    std::strncpy(padded, name, sizeof(padded));
+    taskENTER_CRITICAL(&stateLock);
+    if (std::memcmp(values.pattern, padded, sizeof(padded)) != 0) {
+        std::memcpy(values.pattern, padded, sizeof(padded));
+        stampField(SHOW_FIELD_PATTERN);
+    }
+    taskEXIT_CRITICAL(&stateLock);
+}
+
+void ShowState::setBrightness(uint8_t level) {
+    taskENTER_CRITICAL(&stateLock);
+    if (values.brightness != level) {
+        values.brightness = level;
+        stampField(SHOW_FIELD_BRIGHTNESS);
+    }
+    taskEXIT_CRITICAL(&stateLock);
+}
+
+void ShowState::setParam(uint8_t index, int16_t value) {
+    if (index >= SHOW_PARAM_COUNT) {
+        return;
+    }
+    taskENTER_CRITICAL(&stateLock);
+    if (values.params[index] != value) {
+        values.params[index] = value;
+        stampField(SHOW_FIELD_PARAM0 + index);
+    }
+    taskEXIT_CRITICAL(&stateLock);
+}
+
+StateVersionPayload ShowState::current() {
+    taskENTER_CRITICAL(&stateLock);
+    StateVersionPayload current = {epoch, version};
+    taskEXIT_CRITICAL(&stateLock);
+    return current;
+}
+
+size_t ShowState::encodeDelta(uint16_t from_epoch, uint32_t base_version, uint8_t *out, size_t capacity) {
+    if (capacity < SHOW_STATE_MAX_ENCODED_LEN) {
+        return 0;
+    }
+    taskENTER_CRITICAL(&stateLock);
+    // Another epoch, or a version from our future, shares nothing with us
+    if (from_epoch != epoch || base_version > version) {
+        base_version = 0;
+    }
+    StateDeltaHeader header = {epoch, base_version, version, 0};
+    size_t len = sizeof(header);
+    for (uint8_t field = 0; field < SHOW_FIELD_COUNT; field++) {
+        if (base_version == 0 || fieldVersions[field] > base_version) {
+            header.field_mask |= 1 << field;
+            std::memcpy(out + len, fieldData(field), fieldSize(field));
+            len += fieldSize(field);
+        }
+    }
+    taskEXIT_CRITICAL(&stateLock);
+    std::memcpy(out, &header, sizeof(header));
+    return len;
+}
+
+bool ShowState::applyDelta(const uint8_t *payload, size_t len) {
+    StateDeltaHeader header;
+    if (len < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, payload, sizeof(header));
+    size_t expected = sizeof(header);
+    for (uint8_t field = 0; field < SHOW_FIELD_COUNT; field++) {
+        if (header.field_mask & (1 << field)) {
+            expected += fieldSize(field);
+        }
+    }
+    if (len < expected || header.field_mask >> SHOW_FIELD_COUNT) {
+        ESP_LOGW(TAG, "Malformed state delta");
+        return false;
+    }
+
+    taskENTER_CRITICAL(&stateLock);
+    bool snapshot = header.base_version == 0;
+    bool sameEpoch = header.epoch == epoch;
+    if (!snapshot && (!sameEpoch || header.base_version > version)) {
+        taskEXIT_CRITICAL(&stateLock);
+        return false; // Builds on changes we never saw
+    }
+    if (sameEpoch && header.version <= version) {
+        taskEXIT_CRITICAL(&stateLock);
+        return true; // Already have all of it
+    }
+    const uint8_t *p = payload + sizeof(header);
+    for (uint8_t field = 0; field < SHOW_FIELD_COUNT; field++) {
+        if (header.field_mask & (1 << field)) {
+            std::memcpy(fieldData(field), p, fieldSize(field));
+            p += fieldSize(field);
+        }
+    }
+    values.pattern[SHOW_PATTERN_NAME_LEN] = '\0';
+    epoch = header.epoch;
+    version = header.version;
+    taskEXIT_CRITICAL(&stateLock);
+
+    ESP_LOGI(TAG, "Show state at version %lu: pattern '%s', brightness %u (%s)", static_cast<unsigned long>(header.version),
+             values.pattern, values.brightness, snapshot ? "snapshot" : "delta");
+    return true;
+}
+
+bool ShowState::behind(const StateVersionPayload &advert) {
+    StateVersionPayload own = current();
+    return advert.epoch != own.epoch || advert.version > own.version;
+}
+
+StateRequestPayload ShowState::request(const StateVersionPayload &advert) {
+    StateVersionPayload own = current();
+    if (advert.epoch != own.epoch) {
+        return {0, 0};
+    }
+    return {own.epoch, own.version};
+}
+
+void ShowState::snapshot(ShowStateValues &out, StateVersionPayload &current) {
+    taskENTER_CRITICAL(&stateLock);
+    out = values;
+    current = {epoch, version};
+    taskEXIT_CRITICAL(&stateLock);
+}
+
+#endif // ENABLE_SHOW_STATE
@@ -0,0 +1,63 @@
+#ifndef SHOW_STATE_H
+#define SHOW_STATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Messages.h"
+#include "config.h"
+
+#if ENABLE_SHOW_STATE
+
+// Fields of the show state, in the order a StateDelta carries their values
+enum ShowField : uint8_t {
+    SHOW_FIELD_PATTERN,    // SHOW_PATTERN_NAME_LEN bytes, NUL-padded
+    SHOW_FIELD_BRIGHTNESS, // 1 byte
+    SHOW_FIELD_PARAM0,     // 2 bytes each, SHOW_PARAM_COUNT of them
+    SHOW_FIELD_COUNT = SHOW_FIELD_PARAM0 + SHOW_PARAM_COUNT,
+};
+static_assert(SHOW_FIELD_COUNT <= 16, "StateDeltaHeader::field_mask has one bit per field");
+
+// Largest StateDelta payload: every field present
+#define SHOW_STATE_MAX_ENCODED_LEN \
+    (sizeof(StateDeltaHeader) + SHOW_PATTERN_NAME_LEN + 1 + SHOW_PARAM_COUNT * sizeof(int16_t))
+
+struct ShowStateValues {
+    char pattern[SHOW_PATTERN_NAME_LEN + 1]; // Always NUL-terminated
+    uint8_t brightness;
+    int16_t params[SHOW_PARAM_COUNT];
+};
+
+// What the fleet should be showing, replicated from the sender to every receiver.
+// Each change bumps the state version and stamps the changed field with it. The
+// sender broadcasts every change as a delta and advertises the version in its
+// keepalives. A receiver that finds itself behind asks for what it is missing. The
+// reply holds only the fields stamped after the receiver's version, because later
+// values overwrite earlier ones, so no history is needed. Versions count within an
+// epoch the sender picks at boot. A receiver from another epoch gets every field.
+class ShowState {
+public:
+    // Sender: pick a new epoch. Setters may be called from any task.
+    static void begin();
+    static void setPattern(const char *name);
+    static void setBrightness(uint8_t level);
+    static void setParam(uint8_t index, int16_t value);
+    static StateVersionPayload current();
+    // Sender: encode the fields a receiver at `base_version` of `epoch` is missing.
+    // Returns the payload length, 0 if `capacity` is too small.
+    static size_t encodeDelta(uint16_t epoch, uint32_t base_version, uint8_t *out, size_t capacity);
+
+    // Receiver: apply a StateDelta payload. False if it is malformed or builds on a
+    // version we do not have, in which case the caller should ask for a catch-up.
+    static bool applyDelta(const uint8_t *payload, size_t len);
+    // Receiver: whether a sender advertising `advert` has state we lack, and the
+    // request that would bring us up to date
+    static bool behind(const StateVersionPayload &advert);
+    static StateRequestPayload request(const StateVersionPayload &advert);
+
+    // Both roles: the state as it stands
+    static void snapshot(ShowStateValues &out, StateVersionPayload &version);
+};
+
+#endif // ENABLE_SHOW_STATE
+
+#endif // SHOW_STATE_H
@@ -0,0 +1,94 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Keeps the producer's and consumer's indices on separate cache lines, so neither
+// side's writes invalidate the line the other one polls
+#define SPSC_CACHE_LINE 64
+
+// Lock-free ring of N slots (a power of two) between one producer and one consumer.
+// Slots are filled and read in place: the producer writes into the slot from
+// beginWrite() and publishes it with commitWrite(), the consumer reads the slot from
+// beginRead() and hands it back with endRead(). Nothing is copied in or out.
+//
+// commitWrite() reports when the ring was empty before, so a consumer that drains
+// until beginRead() returns nullptr and only then sleeps needs waking just on that
+// transition.
+//
+// The producer may also discard the oldest waiting slot with dropOldest(), for
+// overflow policies that prefer new data. It and beginRead() race for that slot
+// through one compare-and-swap on the read index, so a slot the consumer is already
+// reading is never taken from under it.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    // Producer: the next free slot, or nullptr if the ring is full
+    T *beginWrite() {
+        uint32_t head = writeIndex.load(std::memory_order_relaxed);
+        uint32_t tail = readIndex.load(std::memory_order_acquire) & INDEX_MASK;
+        return ((head - tail) & INDEX_MASK) < N ? &slots[head & (N - 1)] : nullptr;
+    }
+
+    // Producer: publish the slot from beginWrite(). True if the ring was empty.
+    bool commitWrite() {
+        uint32_t head = writeIndex.load(std::memory_order_relaxed);
+        writeIndex.store((head + 1) & INDEX_MASK, std::memory_order_release);
+        // Pairs with the fence in endRead(): either we see the consumer's last release
+        // or it sees this slot, so a consumer about to sleep is always woken
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return (readIndex.load(std::memory_order_relaxed) & INDEX_MASK) == head;
+    }
+
+    // Producer: discard the oldest published slot to make room. False if the ring is
+    // empty or the consumer is reading that slot.
+    bool dropOldest() {
+        uint32_t tail = readIndex.load(std::memory_order_acquire);
+        if ((tail & READING) || tail == writeIndex.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        return readIndex.compare_exchange_strong(tail, (tail + 1) & INDEX_MASK, std::memory_order_acq_rel);
+    }
+
+    // Consumer: the oldest published slot, or nullptr if the ring is empty. The slot
+    // is the consumer's alone until endRead(), so it may even be modified in place.
+    T *beginRead() {
+        uint32_t tail = readIndex.load(std::memory_order_relaxed);
+        while (tail != writeIndex.load(std::memory_order_acquire)) {
+            if (readIndex.compare_exchange_weak(tail, tail | READING, std::memory_order_acquire,
+                                                std::memory_order_relaxed)) {
+                return &slots[tail & (N - 1)];
+            }
+            // The producer dropped the slot; tail now holds the next one
+        }
+        return nullptr;
+    }
+
+    // Consumer: release the slot from beginRead() to the producer
+    void endRead() {
+        uint32_t tail = readIndex.load(std::memory_order_relaxed) & INDEX_MASK;
+        readIndex.store((tail + 1) & INDEX_MASK, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    size_t size() const {
+        return (writeIndex.load(std::memory_order_relaxed) - readIndex.load(std::memory_order_relaxed)) & INDEX_MASK;
+    }
+    static constexpr size_t capacity() { return N; }
+
+private:
+    // Set on the read index while the consumer holds its slot. Indices count modulo
+    // 2^31 so they never reach it.
+    static constexpr uint32_t READING = 0x80000000u;
+    static constexpr uint32_t INDEX_MASK = READING - 1;
+
+    alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> writeIndex{0};
+    alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> readIndex{0};
+    alignas(SPSC_CACHE_LINE) T slots[N];
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,226 @@
+#include "Tdma.h"
+
+#if ENABLE_TDMA
+
+#include "FrameTrace.h"
+#include "esp_log.h"
+#include "esp_now.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include <cstring>
+
+static const char *TAG = "Tdma";
+
+#define TDMA_SLOT_COUNT ((TDMA_SUPERFRAME_MS - TDMA_CONTENTION_MS) / TDMA_SLOT_MS)
+static_assert(TDMA_SLOT_COUNT > 0, "TDMA superframe leaves no room for slots");
+static_assert(TDMA_SLOT_MS * 1000 > 2 * TDMA_GUARD_US, "TDMA guard time fills the whole slot");
+
+// Latest beacon and when it arrived
+struct SuperframeTiming {
+    TdmaBeaconPayload beacon;
+    int64_t beacon_us; // 0 until the first beacon
+};
+
+// Uplink frame waiting for its slot
+struct UplinkFrame {
+    uint8_t dest_mac[ESP_NOW_ETH_ALEN];
+    NodeId node;
+    size_t len;
+    uint8_t data[ESP_NOW_MAX_DATA_LEN];
+};
+
+static uint16_t nextSuperframe = 0; // Sender only
+
+static SuperframeTiming timing = {};
+static portMUX_TYPE timingLock = portMUX_INITIALIZER_UNLOCKED; // Beacons arrive on the receive loop, slots fire on the timer task
+static QueueHandle_t uplinkQueue = nullptr;
+static esp_timer_handle_t slotTimer = nullptr;
+
+void Tdma::nextBeacon(TdmaBeaconPayload &beacon, size_t node_count) {
+    size_t cycle = (node_count + TDMA_SLOT_COUNT - 1) / TDMA_SLOT_COUNT;
+    beacon.superframe = nextSuperframe++;
+    beacon.superframe_ms = TDMA_SUPERFRAME_MS;
+    beacon.contention_ms = TDMA_CONTENTION_MS;
+    beacon.slot_count = TDMA_SLOT_COUNT;
+    beacon.slot_ms = TDMA_SLOT_MS;
+    beacon.cycle = cycle > 0 ? static_cast<uint8_t>(cycle) : 1;
+}
+
+esp_err_t Tdma::init() {
+    uplinkQueue = xQueueCreate(TDMA_UPLINK_QUEUE, sizeof(UplinkFrame));
+    if (!uplinkQueue) {
+        ESP_LOGE(TAG, "Failed to create uplink queue");
+        return ESP_ERR_NO_MEM;
+    }
+    esp_timer_create_args_t args = {};
+    args.callback = slotTimerCallback;
+    args.name = "tdmaSlot";
+    esp_err_t err = esp_timer_create(&args, &slotTimer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create slot timer: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+static SuperframeTiming currentTiming() {
+    taskENTER_CRITICAL(&timingLock);
+    SuperframeTiming copy = timing;
+    taskEXIT_CRITICAL(&timingLock);
+    return copy;
+}
+
+void Tdma::onBeacon(const TdmaBeaconPayload &beacon, int64_t rx_time_us) {
+    if (beacon.superframe_ms == 0 || beacon.slot_count == 0 || beacon.cycle == 0 ||
+        beacon.contention_ms + beacon.slot_count * beacon.slot_ms > beacon.superframe_ms) {
+        ESP_LOGW(TAG, "Ignoring malformed beacon");
+        return;
+    }
+    bool wasSynced = synced();
+    taskENTER_CRITICAL(&timingLock);
+    timing.beacon = beacon;
+    timing.beacon_us = rx_time_us;
+    taskEXIT_CRITICAL(&timingLock);
+    if (!wasSynced) {
+        ESP_LOGI(TAG, "Synced to superframe %u: %u slots of %u ms, cycle of %u", beacon.superframe, beacon.slot_count,
+                 beacon.slot_ms, beacon.cycle);
+    }
+}
+
+bool Tdma::synced() {
+    SuperframeTiming t = currentTiming();
+    return t.beacon_us != 0 && esp_timer_get_time() - t.beacon_us < TDMA_SYNC_TIMEOUT_MS * 1000LL;
+}
+
+// Index of `node`'s slot within a superframe, or -1 if it has none and must use the
+// contention period (not registered, or registered since the last beacon grew the cycle)
+static int32_t slotIndex(const TdmaBeaconPayload &beacon, NodeId node) {
+    if (node == NODE_ID_NONE || (node - 1) / beacon.slot_count >= beacon.cycle) {
+        return -1;
+    }
+    return (node - 1) % beacon.slot_count;
+}
+
+static bool nodesTurn(const TdmaBeaconPayload &beacon, NodeId node, int64_t superframes_after_beacon) {
+    uint16_t superframe = static_cast<uint16_t>(beacon.superframe + superframes_after_beacon);
+    return superframe % beacon.cycle == (node - 1) / beacon.slot_count;
+}
+
+// Whether `node` may transmit at `now_us`: inside its own slot, or inside a
+// contention period if it has no slot
+static bool inWindow(const SuperframeTiming &t, NodeId node, int64_t now_us) {
+    const TdmaBeaconPayload &beacon = t.beacon;
+    int64_t period = beacon.superframe_ms * 1000LL;
+    int64_t sinceBeacon = now_us - t.beacon_us;
+    int64_t offset = sinceBeacon % period;
+    int32_t slot = slotIndex(beacon, node);
+    if (slot < 0) {
+        return offset < beacon.contention_ms * 1000LL;
+    }
+    int64_t slotStart = (beacon.contention_ms + slot * beacon.slot_ms) * 1000LL;
+    return nodesTurn(beacon, node, sinceBeacon / period) && offset >= slotStart &&
+           offset < slotStart + beacon.slot_ms * 1000LL - TDMA_GUARD_US;
+}
+
+// When `node` should next transmit at or after `after_us`: the start of its next
+// slot, or a random moment in the next contention period
+static int64_t nextTransmitUs(const SuperframeTiming &t, NodeId node, int64_t after_us) {
+    const TdmaBeaconPayload &beacon = t.beacon;
+    int64_t period = beacon.superframe_ms * 1000LL;
+    int32_t slot = slotIndex(beacon, node);
+    int64_t contentionSpan = beacon.contention_ms * 1000LL - 2 * TDMA_GUARD_US;
+    for (int64_t k = after_us > t.beacon_us ? (after_us - t.beacon_us) / period : 0;; k++) {
+        int64_t start = t.beacon_us + k * period + TDMA_GUARD_US;
+        if (slot < 0) {
+            start += contentionSpan > 0 ? esp_random() % contentionSpan : 0;
+        } else if (nodesTurn(beacon, node, k)) {
+            start += (beacon.contention_ms + slot * beacon.slot_ms) * 1000LL;
+        } else {
+            continue;
+        }
+        if (start >= after_us) {
+            return start;
+        }
+    }
+}
+
+static void sendUplink(const UplinkFrame &uplink) {
+    esp_err_t result = esp_now_send(uplink.dest_mac, uplink.data, uplink.len);
+    if (result != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send uplink frame: %s", esp_err_to_name(result));
+    }
+#if ENABLE_FRAME_TRACE
+    if (result == ESP_OK) {
+        FrameTrace::record(FRAME_TRACE_TX, uplink.dest_mac, 0, uplink.data, uplink.len);
+    }
+#endif
+}
+
+esp_err_t Tdma::submit(const uint8_t *dest_mac, const uint8_t *frame, size_t len, NodeId node) {
+    if (len > ESP_NOW_MAX_DATA_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    UplinkFrame uplink;
+    std::memcpy(uplink.dest_mac, dest_mac, ESP_NOW_ETH_ALEN);
+    uplink.node = node;
+    uplink.len = len;
+    std::memcpy(uplink.data, frame, len);
+    if (xQueueSend(uplinkQueue, &uplink, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Uplink queue full, dropping frame type=%d", reinterpret_cast<const MessageData *>(frame)->payload_type);
+        return ESP_ERR_NO_MEM;
+    }
+    if (!esp_timer_is_active(slotTimer)) {
+        armForNext(node, esp_timer_get_time());
+    }
+    return ESP_OK;
+}
+
+void Tdma::armForNext(NodeId node, int64_t after_us) {
+    int64_t start = nextTransmitUs(currentTiming(), node, after_us);
+    int64_t delay = start - esp_timer_get_time();
+    esp_timer_stop(slotTimer);
+    esp_timer_start_once(slotTimer, delay > 0 ? delay : 0);
+}
+
+uint32_t Tdma::msUntilContention() {
+    if (!synced()) {
+        return 0;
+    }
+    SuperframeTiming t = currentTiming();
+    int64_t now = esp_timer_get_time();
+    int64_t period = t.beacon.superframe_ms * 1000LL;
+    // Task delays end up to a tick either side of the request, so aim well inside
+    int64_t margin = 2 * portTICK_PERIOD_MS * 1000LL;
+    int64_t span = t.beacon.contention_ms * 1000LL - 2 * margin;
+    int64_t start = t.beacon_us + ((now - t.beacon_us) / period + 1) * period + margin;
+    if (span > 0) {
+        start += esp_random() % span;
+    }
+    return (start - now) / 1000;
+}
+
+// Runs on the esp_timer task at the start of a slot
+void Tdma::slotTimerCallback(void *arg) {
+    UplinkFrame uplink;
+    if (xQueuePeek(uplinkQueue, &uplink, 0) != pdTRUE) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    // A beacon since the timer was armed may have moved the slot. Without sync the
+    // frame goes out now rather than waiting for a slot that may never be announced.
+    if (synced() && !inWindow(currentTiming(), uplink.node, now)) {
+        armForNext(uplink.node, now);
+        return;
+    }
+
+    xQueueReceive(uplinkQueue, &uplink, 0);
+    sendUplink(uplink);
+
+    // One frame per slot; anything else waits for the node's next one
+    if (xQueuePeek(uplinkQueue, &uplink, 0) == pdTRUE) {
+        armForNext(uplink.node, now + TDMA_SLOT_MS * 1000LL);
+    }
+}
+
+#endif // ENABLE_TDMA
@@ -0,0 +1,44 @@
+#ifndef TDMA_H
+#define TDMA_H
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "Messages.h"
+#include "config.h"
+
+#if ENABLE_TDMA
+
+// Slotted uplink, so reports from a large fleet do not collide. The sender
+// broadcasts a TdmaBeacon every TDMA_SUPERFRAME_MS. Each superframe opens with
+// TDMA_CONTENTION_MS of contention, where receivers without a slot (still
+// registering) pick a random moment. Slots of TDMA_SLOT_MS follow. Slots come from
+// node IDs, so the sender needs no per-node table: node n owns slot (n - 1) % slots
+// in every superframe where superframe % cycle == (n - 1) / slots.
+//
+// Receivers time slots from when the last beacon arrived. Missed beacons are
+// extrapolated, so sleeping receivers keep their slots. Without a beacon for
+// TDMA_SYNC_TIMEOUT_MS they fall back to sending straight away.
+class Tdma {
+public:
+    // Sender: beacon for the next superframe with `node_count` registered nodes
+    static void nextBeacon(TdmaBeaconPayload &beacon, size_t node_count);
+
+    // Receiver
+    static esp_err_t init();
+    static void onBeacon(const TdmaBeaconPayload &beacon, int64_t rx_time_us);
+    static bool synced();
+    // Queue a ready-built uplink frame for `node`'s slot. Sends it straight away if
+    // not synced to a beacon.
+    static esp_err_t submit(const uint8_t *dest_mac, const uint8_t *frame, size_t len, NodeId node);
+    // Milliseconds until a random moment in the next contention period, 0 if not synced
+    static uint32_t msUntilContention();
+
+private:
+    static void slotTimerCallback(void *arg);
+    static void armForNext(NodeId node, int64_t after_us);
+};
+
+#endif // ENABLE_TDMA
+
+#endif // TDMA_H
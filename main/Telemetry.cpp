@@ -0,0 +1,147 @@
+#include "Telemetry.h"
+
+#if ENABLE_TELEMETRY
+
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+
+// Counters are written by recvLoop and read by the telemetry timer
+static portMUX_TYPE counterLock = portMUX_INITIALIZER_UNLOCKED;
+static int32_t rssiSum = 0;
+static uint32_t rssiSamples = 0;
+static uint32_t framesReceived = 0;
+static uint32_t framesLost = 0;
+static uint32_t framesDuplicated = 0;
+static uint32_t queueHighWater = 0;
+
+// Values sent in the previous report, which the next deltas are taken against
+static int32_t lastReported[TELEMETRY_FIELD_COUNT] = {};
+static uint8_t reportSeq = 0;
+
+void Telemetry::recordFrame(int8_t rssi) {
+    taskENTER_CRITICAL(&counterLock);
+    rssiSum += rssi;
+    rssiSamples++;
+    framesReceived++;
+    taskEXIT_CRITICAL(&counterLock);
+}
+
+void Telemetry::recordLoss(uint32_t frames) {
+    taskENTER_CRITICAL(&counterLock);
+    framesLost += frames;
+    taskEXIT_CRITICAL(&counterLock);
+}
+
+void Telemetry::recordDuplicate() {
+    taskENTER_CRITICAL(&counterLock);
+    framesDuplicated++;
+    taskEXIT_CRITICAL(&counterLock);
+}
+
+void Telemetry::recordQueueDepth(uint32_t depth) {
+    taskENTER_CRITICAL(&counterLock);
+    if (depth > queueHighWater) {
+        queueHighWater = depth;
+    }
+    taskEXIT_CRITICAL(&counterLock);
+}
+
+static uint8_t *putVarint(uint8_t *p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = static_cast<uint8_t>(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = static_cast<uint8_t>(v);
+    return p;
+}
+
+static const uint8_t *getVarint(const uint8_t *p, const uint8_t *end, uint32_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        v |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+static uint32_t zigzag(int32_t v) {
+    return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+}
+
+size_t Telemetry::encodeReport(uint8_t *buf, size_t len) {
+    if (!buf || len < TELEMETRY_MAX_ENCODED_LEN) {
+        return 0;
+    }
+
+    int32_t current[TELEMETRY_FIELD_COUNT];
+    taskENTER_CRITICAL(&counterLock);
+    current[TELEMETRY_RSSI] = rssiSamples ? rssiSum / static_cast<int32_t>(rssiSamples) : lastReported[TELEMETRY_RSSI];
+    current[TELEMETRY_FRAMES] = static_cast<int32_t>(framesReceived);
+    current[TELEMETRY_LOST] = static_cast<int32_t>(framesLost);
+    current[TELEMETRY_DUPLICATES] = static_cast<int32_t>(framesDuplicated);
+    current[TELEMETRY_QUEUE_HWM] = static_cast<int32_t>(queueHighWater);
+    rssiSum = 0;
+    rssiSamples = 0;
+    queueHighWater = 0;
+    taskEXIT_CRITICAL(&counterLock);
+    current[TELEMETRY_FREE_HEAP] = static_cast<int32_t>(heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    current[TELEMETRY_MIN_FREE_HEAP] = static_cast<int32_t>(heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+
+    uint8_t seq = reportSeq++;
+    bool keyframe = seq % TELEMETRY_KEYFRAME_EVERY == 0;
+
+    uint8_t *p = buf;
+    *p++ = seq;
+    *p++ = keyframe ? TELEMETRY_FLAG_KEYFRAME : 0;
+    uint8_t *presence = p++;
+    *presence = 0;
+
+    for (uint8_t field = 0; field < TELEMETRY_FIELD_COUNT; field++) {
+        int32_t delta = keyframe ? current[field] : current[field] - lastReported[field];
+        if (delta != 0) {
+            *presence |= 1 << field;
+            p = putVarint(p, zigzag(delta));
+        }
+        lastReported[field] = current[field];
+    }
+    return p - buf;
+}
+
+bool Telemetry::decodeReport(const uint8_t *buf, size_t len, TelemetryReport &report) {
+    if (!buf || len < 3) {
+        return false;
+    }
+
+    const uint8_t *p = buf;
+    const uint8_t *end = buf + len;
+    report = {};
+    report.seq = *p++;
+    report.flags = *p++;
+    uint8_t presence = *p++;
+
+    for (uint8_t field = 0; field < TELEMETRY_FIELD_COUNT; field++) {
+        if (presence & (1 << field)) {
+            uint32_t raw;
+            p = getVarint(p, end, raw);
+            if (!p) {
+                return false;
+            }
+            report.deltas[field] = unzigzag(raw);
+        }
+    }
+    return true;
+}
+
+uint32_t Telemetry::intervalForFleet(size_t peers) {
+    uint32_t interval = static_cast<uint32_t>(peers) * TELEMETRY_PER_NODE_MS;
+    return interval > TELEMETRY_MIN_INTERVAL_MS ? interval : TELEMETRY_MIN_INTERVAL_MS;
+}
+
+#endif // ENABLE_TELEMETRY
@@ -0,0 +1,56 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include "config.h"
+
+#if ENABLE_TELEMETRY
+
+// Fields carried in a Telemetry payload. Each is sent as a zigzag varint of its
+// change since the previous report, and omitted entirely when unchanged.
+enum TelemetryField : uint8_t {
+    TELEMETRY_RSSI,          // Average RSSI of frames from the sender since the last report
+    TELEMETRY_FRAMES,        // Valid frames received (cumulative)
+    TELEMETRY_LOST,          // Sequence gaps (cumulative)
+    TELEMETRY_DUPLICATES,    // Duplicate or out-of-order frames (cumulative)
+    TELEMETRY_QUEUE_HWM,     // Deepest receive queue since the last report
+    TELEMETRY_FREE_HEAP,
+    TELEMETRY_MIN_FREE_HEAP,
+    TELEMETRY_FIELD_COUNT,
+};
+
+#define TELEMETRY_FLAG_KEYFRAME 0x01 // Deltas are against zero, so the report stands alone
+
+// Largest encoded report: seq, flags, presence bitmap and a 5-byte varint per field
+#define TELEMETRY_MAX_ENCODED_LEN (3 + TELEMETRY_FIELD_COUNT * 5)
+
+struct TelemetryReport {
+    uint8_t seq;
+    uint8_t flags;
+    int32_t deltas[TELEMETRY_FIELD_COUNT];
+};
+
+class Telemetry {
+public:
+    // Receiver side: counters fed from the receive path
+    static void recordFrame(int8_t rssi);
+    static void recordLoss(uint32_t frames);
+    static void recordDuplicate();
+    static void recordQueueDepth(uint32_t depth);
+
+    // Receiver side: encode the next report. Every TELEMETRY_KEYFRAME_EVERY reports
+    // is a keyframe so the sender recovers from a lost delta.
+    static size_t encodeReport(uint8_t *buf, size_t len);
+
+    // Sender side
+    static bool decodeReport(const uint8_t *buf, size_t len, TelemetryReport &report);
+
+    // Reporting interval for a fleet of `peers`, chosen so the whole fleet's uplink
+    // stays around one report per TELEMETRY_PER_NODE_MS regardless of its size.
+    static uint32_t intervalForFleet(size_t peers);
+};
+
+#endif // ENABLE_TELEMETRY
+
+#endif // TELEMETRY_H
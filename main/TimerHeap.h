@@ -0,0 +1,122 @@
+#ifndef TIMER_HEAP_H
+#define TIMER_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+
+// Fixed-capacity binary min-heap of tick deadlines, keyed by a small timer id.
+// Each id can be scheduled at most once; scheduling it again moves its deadline.
+// Not thread-safe: a heap is owned by the single task that waits on it.
+template <size_t N>
+class TimerHeap {
+public:
+    // Schedule (or reschedule) timer `id` to expire at `deadline`.
+    void schedule(uint8_t id, TickType_t deadline) {
+        cancel(id);
+        if (count == N) {
+            return;
+        }
+        entries[count] = {deadline, id};
+        siftUp(count++);
+    }
+
+    void cancel(uint8_t id) {
+        for (size_t i = 0; i < count; i++) {
+            if (entries[i].id == id) {
+                removeAt(i);
+                return;
+            }
+        }
+    }
+
+    bool isScheduled(uint8_t id) const {
+        for (size_t i = 0; i < count; i++) {
+            if (entries[i].id == id) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool empty() const { return count == 0; }
+
+    // Ticks until the earliest deadline, or portMAX_DELAY if nothing is scheduled.
+    TickType_t ticksUntilNext(TickType_t now) const {
+        if (count == 0) {
+            return portMAX_DELAY;
+        }
+        int32_t remaining = static_cast<int32_t>(entries[0].deadline - now);
+        return remaining > 0 ? static_cast<TickType_t>(remaining) : 0;
+    }
+
+    // Pop the earliest timer if it has expired at `now`.
+    bool popExpired(TickType_t now, uint8_t &id) {
+        if (count == 0 || static_cast<int32_t>(entries[0].deadline - now) > 0) {
+            return false;
+        }
+        id = entries[0].id;
+        removeAt(0);
+        return true;
+    }
+
+private:
+    struct Entry {
+        TickType_t deadline;
+        uint8_t id;
+    };
+
+    // Tick-wrap safe ordering
+    static bool before(const Entry &a, const Entry &b) {
+        return static_cast<int32_t>(a.deadline - b.deadline) < 0;
+    }
+
+    void siftUp(size_t i) {
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (!before(entries[i], entries[parent])) {
+                break;
+            }
+            swap(i, parent);
+            i = parent;
+        }
+    }
+
+    void siftDown(size_t i) {
+        while (true) {
+            size_t smallest = i;
+            size_t left = 2 * i + 1;
+            size_t right = left + 1;
+            if (left < count && before(entries[left], entries[smallest])) {
+                smallest = left;
+            }
+            if (right < count && before(entries[right], entries[smallest])) {
+                smallest = right;
+            }
+            if (smallest == i) {
+                return;
+            }
+            swap(i, smallest);
+            i = smallest;
+        }
+    }
+
+    void removeAt(size_t i) {
+        entries[i] = entries[--count];
+        if (i < count) {
+            siftDown(i);
+            siftUp(i);
+        }
+    }
+
+    void swap(size_t a, size_t b) {
+        Entry tmp = entries[a];
+        entries[a] = entries[b];
+        entries[b] = tmp;
+    }
+
+    Entry entries[N] = {};
+    size_t count = 0;
+};
+
+#endif // TIMER_HEAP_H
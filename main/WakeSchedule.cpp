@@ -0,0 +1,169 @@
+#include "WakeSchedule.h"
+
+#if ENABLE_WAKE_ALIGNMENT
+
+#include "PeerRegistry.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <algorithm>
+
+#define WAKE_INTERVAL_MS CONFIG_ESPNOW_WAKE_INTERVAL
+#define WAKE_WINDOW_MS CONFIG_ESPNOW_WAKE_WINDOW
+// Halve the histogram at this many samples, so a window that drifted fades out
+#define WAKE_PHASE_DECAY_SAMPLES 256
+
+// Receiver state, only touched by the receive loop
+static uint16_t phaseCounts[WAKE_PHASE_BINS];
+static uint32_t phaseSamples = 0;    // Since the last decay
+static uint32_t samplesSinceBoot = 0;
+static int reportedBin = -1;         // Bin of the last reported window start, -1 for none
+
+size_t WakeSchedule::points = 0;
+uint16_t WakeSchedule::pointPhases[WAKE_MAX_POINTS];
+size_t WakeSchedule::unplanned = 0;
+
+uint16_t WakeSchedule::currentPhaseMs() {
+    return static_cast<uint16_t>((esp_timer_get_time() / 1000) % WAKE_INTERVAL_MS);
+}
+
+uint32_t WakeSchedule::msUntil(uint16_t phase_ms) {
+    return (phase_ms + WAKE_INTERVAL_MS - currentPhaseMs()) % WAKE_INTERVAL_MS;
+}
+
+bool WakeSchedule::due(uint16_t phase_ms) {
+    // Reactor timers fire up to a tick late; points sit a quarter window from the edges
+    uint32_t tolerance = std::max<uint32_t>(WAKE_WINDOW_MS / 4, 2 * portTICK_PERIOD_MS);
+    uint32_t late = (currentPhaseMs() + WAKE_INTERVAL_MS - phase_ms) % WAKE_INTERVAL_MS;
+    return late <= tolerance;
+}
+
+void WakeSchedule::recordPhase(uint16_t phase_ms) {
+    if (phase_ms >= WAKE_INTERVAL_MS) {
+        return;
+    }
+    phaseCounts[phase_ms * WAKE_PHASE_BINS / WAKE_INTERVAL_MS]++;
+    samplesSinceBoot++;
+    if (++phaseSamples >= WAKE_PHASE_DECAY_SAMPLES) {
+        for (uint16_t &count : phaseCounts) {
+            count /= 2;
+        }
+        phaseSamples = 0;
+    }
+}
+
+// Every frame we hear lands inside our window, so the window opens where the
+// longest run of empty bins ends. -1 when nothing was heard, or frames were heard
+// all round the cycle and there is no window to find.
+static int windowStartBin() {
+    int longest = 0;
+    int longestEnd = -1;
+    int run = 0;
+    for (int i = 0; i < 2 * WAKE_PHASE_BINS; i++) {
+        if (phaseCounts[i % WAKE_PHASE_BINS] != 0) {
+            run = 0;
+            continue;
+        }
+        run++;
+        if (run > longest && run <= WAKE_PHASE_BINS) {
+            longest = run;
+            longestEnd = i % WAKE_PHASE_BINS;
+        }
+    }
+    if (longest == 0 || longest == WAKE_PHASE_BINS) {
+        return -1;
+    }
+    return (longestEnd + 1) % WAKE_PHASE_BINS;
+}
+
+bool WakeSchedule::reportDue(uint16_t &window_start_ms) {
+    if (samplesSinceBoot < WAKE_PHASE_MIN_SAMPLES) {
+        return false;
+    }
+    int bin = windowStartBin();
+    if (bin < 0) {
+        return false;
+    }
+    // Wobbling by one bin is noise, not drift
+    if (reportedBin >= 0) {
+        int moved = (bin - reportedBin + WAKE_PHASE_BINS) % WAKE_PHASE_BINS;
+        if (moved <= 1 || moved >= WAKE_PHASE_BINS - 1) {
+            return false;
+        }
+    }
+    reportedBin = bin;
+    // Middle of the bin, so the error is at most half a bin either way
+    window_start_ms = static_cast<uint16_t>((2 * bin + 1) * WAKE_INTERVAL_MS / (2 * WAKE_PHASE_BINS));
+    return true;
+}
+
+void WakeSchedule::resetReport() {
+    reportedBin = -1;
+}
+
+void WakeSchedule::plan(PeerEntry *begin, PeerEntry *end) {
+    static uint16_t starts[PEER_REGISTRY_CAPACITY];
+    size_t known = 0;
+    for (PeerEntry *peer = begin; peer != end; ++peer) {
+        peer->wake_point = WAKE_POINT_NONE;
+        if (peer->wake_start_ms != WAKE_PHASE_UNKNOWN) {
+            starts[known++] = peer->wake_start_ms;
+        }
+    }
+    std::sort(starts, starts + known);
+
+    // Cut the cycle open at the widest gap between window starts, so no group of
+    // windows straddles the cut
+    size_t first = 0;
+    uint32_t widest = 0;
+    for (size_t i = 0; i < known; i++) {
+        uint32_t gap = (starts[i] + WAKE_INTERVAL_MS - starts[(i + known - 1) % known]) % WAKE_INTERVAL_MS;
+        if (gap > widest) {
+            widest = gap;
+            first = i;
+        }
+    }
+    auto unrolled = [&](uint16_t start) {
+        return known > 0 && start < starts[first] ? start + WAKE_INTERVAL_MS : static_cast<uint32_t>(start);
+    };
+
+    // Greedily group windows whose starts lie within half a window of each other.
+    // A point a quarter window after the group's last start is then at least a
+    // quarter window inside every window in the group.
+    uint32_t groupFirst[WAKE_MAX_POINTS];
+    uint32_t groupLast[WAKE_MAX_POINTS];
+    points = 0;
+    for (size_t k = 0; k < known; k++) {
+        uint32_t start = unrolled(starts[(first + k) % known]);
+        if (points > 0 && start - groupFirst[points - 1] <= WAKE_WINDOW_MS / 2) {
+            groupLast[points - 1] = start;
+            continue;
+        }
+        if (points == WAKE_MAX_POINTS) {
+            break;
+        }
+        groupFirst[points] = start;
+        groupLast[points] = start;
+        points++;
+    }
+    for (size_t i = 0; i < points; i++) {
+        pointPhases[i] = static_cast<uint16_t>((groupLast[i] + WAKE_WINDOW_MS / 4) % WAKE_INTERVAL_MS);
+    }
+
+    unplanned = 0;
+    for (PeerEntry *peer = begin; peer != end; ++peer) {
+        if (peer->wake_start_ms != WAKE_PHASE_UNKNOWN) {
+            uint32_t start = unrolled(peer->wake_start_ms);
+            for (size_t i = 0; i < points; i++) {
+                if (start >= groupFirst[i] && start <= groupLast[i]) {
+                    peer->wake_point = static_cast<uint8_t>(i);
+                    break;
+                }
+            }
+        }
+        if (peer->wake_point == WAKE_POINT_NONE) {
+            unplanned++;
+        }
+    }
+}
+
+#endif // ENABLE_WAKE_ALIGNMENT
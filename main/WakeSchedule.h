@@ -0,0 +1,63 @@
+#ifndef WAKE_SCHEDULE_H
+#define WAKE_SCHEDULE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "sdkconfig.h"
+#include "config.h"
+
+#define WAKE_PHASE_UNKNOWN 0xFFFF // No phase reported or carried
+#define WAKE_POINT_NONE 0xFF      // Peer not covered by any transmit point
+
+#if ENABLE_WAKE_ALIGNMENT
+
+#if !CONFIG_ESPNOW_ENABLE_POWER_SAVE
+#error "ENABLE_WAKE_ALIGNMENT needs CONFIG_ESPNOW_ENABLE_POWER_SAVE"
+#endif
+
+struct PeerEntry;
+
+// Lines fleet frames up with the receivers' power-save wake windows. Every frame
+// carries the sender's position in a CONFIG_ESPNOW_WAKE_INTERVAL cycle of its own
+// clock, so a receiver can histogram the phases of the frames it hears: they all
+// fall inside its window, and the end of the longest empty stretch is where the
+// window opens. Receivers report that phase, and the sender groups the windows into
+// as few transmit points as it can and sends each held frame once at every point.
+//
+// Windows drift as the two clocks do. The sender keeps sending small unaligned
+// probes at random phases so receivers still see where their windows really end,
+// rather than only where the sender aims.
+class WakeSchedule {
+public:
+    // Sender clock position within the wake interval, for outgoing frames
+    static uint16_t currentPhaseMs();
+    // Milliseconds from now until the sender's clock next reaches `phase_ms`
+    static uint32_t msUntil(uint16_t phase_ms);
+    // Whether `phase_ms` has just passed, within the lateness a reactor timer allows
+    static bool due(uint16_t phase_ms);
+
+    // Receiver: phase carried by a valid frame that arrived directly from the sender
+    static void recordPhase(uint16_t phase_ms);
+    // Receiver: true with the window start once enough frames were heard and it moved
+    // since the last report
+    static bool reportDue(uint16_t &window_start_ms);
+    // Receiver: report again after the next frames, e.g. for a sender that rebooted
+    static void resetReport();
+
+    // Sender: recompute the transmit points and each peer's wake_point
+    static void plan(PeerEntry *begin, PeerEntry *end);
+    static size_t pointCount() { return points; }
+    static uint16_t pointPhaseMs(size_t point) { return pointPhases[point]; }
+    // Registered peers that no transmit point covers, because they have not reported
+    // yet or there were more groups than WAKE_MAX_POINTS
+    static size_t unplannedPeers() { return unplanned; }
+
+private:
+    static size_t points;
+    static uint16_t pointPhases[WAKE_MAX_POINTS];
+    static size_t unplanned;
+};
+
+#endif // ENABLE_WAKE_ALIGNMENT
+
+#endif // WAKE_SCHEDULE_H
@@ -14,6 +14,153 @@ typedef enum {
 
 #define USE_POINT_TO_POINT true
 
+// Periodically sample stack, heap and queue usage (see Metrics.h)
+#define ENABLE_METRICS true
+#define METRICS_INTERVAL_MS 60000
+
+// Stamp outgoing frames with a TraceExtension and record per-stage latency
+// histograms on the receiver (see Latency.h). Adds 8 bytes to every frame.
+#define ENABLE_LATENCY_TRACING false
+#define LATENCY_REPORT_INTERVAL_MS 60000
+
+// Receivers report link and health counters back to the sender (see Telemetry.h).
+// The interval grows with fleet size so total uplink stays near one report per
+// TELEMETRY_PER_NODE_MS, and each receiver jitters it by +/-50%.
+#define ENABLE_TELEMETRY true
+#define TELEMETRY_MIN_INTERVAL_MS 30000
+#define TELEMETRY_PER_NODE_MS 500
+#define TELEMETRY_KEYFRAME_EVERY 8
+#define FLEET_SUMMARY_INTERVAL_MS 60000
+
+// Remember pairing across reboots (see Pairing.h). The sender saves new peers at most
+// once per PAIRING_SAVE_DELAY_MS; receivers only write when their pairing changes.
+#define ENABLE_PAIRING_PERSISTENCE true
+#define PAIRING_SAVE_DELAY_MS 10000
+
+// The sender periodically surveys the 2.4 GHz channels and moves the fleet to a
+// quieter one with an announced switch (see ChannelSurvey.h). It also surveys early
+// when fleet loss since the last summary exceeds CHANNEL_LOSS_TRIGGER_PERMILLE, but
+// not within CHANNEL_LOSS_SURVEY_GAP_MS of the last survey: where every channel is
+// that lossy, it would otherwise hold traffic back for a survey every summary.
+// Receivers that lose the sender scan every channel while re-registering.
+// channel_sim.py checks these settings against per-channel interference models.
+#define ENABLE_CHANNEL_AGILITY true
+#define CHANNEL_SURVEY_INTERVAL_MS 1800000
+#define CHANNEL_SURVEY_DWELL_MS 150
+#define CHANNEL_LOSS_TRIGGER_PERMILLE 100
+#define CHANNEL_LOSS_SURVEY_GAP_MS 600000
+#define CHANNEL_SWITCH_HYSTERESIS_PERCENT 70 // Move only if the best channel is at most this busy relative to ours
+
+// Receivers rebroadcast fleet frames to reach nodes out of the sender's range (see
+// Relay.h). Each relay waits a random delay of up to RELAY_MAX_DELAY_MS and stays
+// quiet if it hears RELAY_SUPPRESS_COUNT copies from other relays meanwhile.
+// Suppression gives up some coverage against flooding: a relay that heard enough
+// copies assumes its neighbours did too, which fails at the fleet's edges, where
+// nodes have fewer relays in range. In relay_sim.py's default 12x12 grid at 10% loss,
+// 4 copies cover 96.1% of receivers against 97.2% for flooding, with 62% of its
+// airtime. 2 covered only 91.9%. 5 reaches 96.8% at 72%, and closing the gap takes
+// nearly flooding's airtime. A longer delay saves airtime but adds latency and
+// loses coverage.
+#define ENABLE_RELAY false
+#define RELAY_MAX_HOPS 3
+#define RELAY_MAX_DELAY_MS 40
+#define RELAY_SUPPRESS_COUNT 4
+#define RELAY_SEEN_SIZE 128          // Recently-seen frame fingerprints, must be a power of two
+#define RELAY_PENDING_SLOTS 4        // Frames waiting for their relay delay
+
+// Authenticate every frame from the sender with a tag under the fleet-wide group
+// key CONFIG_ESPNOW_PMK, so one broadcast reaches all boards securely (see Auth.h).
+// The sender reserves replay counters in NVS AUTH_COUNTER_RESERVE at a time;
+// receivers accept counters up to AUTH_REPLAY_WINDOW behind the newest one.
+#define ENABLE_AUTH true
+#define AUTH_COUNTER_RESERVE 4096
+#define AUTH_REPLAY_WINDOW 32        // At most 32, one bit each
+#define AUTH_REPLAY_ORIGINS 4        // Senders tracked at once
+#define AUTH_WINDOW_SAVE_EVERY 64    // Receivers save a sender's newest counter this many counters on
+#define AUTH_BENCHMARK false         // Log the per-frame signing cost at boot
+
+// With CONFIG_ESPNOW_ENABLE_POWER_SAVE, receivers only listen for the first
+// CONFIG_ESPNOW_WAKE_WINDOW ms of every CONFIG_ESPNOW_WAKE_INTERVAL. Receivers learn
+// where that window falls on the sender's clock and report it, and the sender holds
+// fleet frames until the windows come round (see WakeSchedule.h). Adds 2 bytes to
+// every frame and up to one wake interval of latency.
+#define ENABLE_WAKE_ALIGNMENT false
+#define WAKE_PHASE_BINS 32           // Histogram resolution over one wake interval
+#define WAKE_PHASE_MIN_SAMPLES 16    // Frames a receiver hears before it first reports
+#define WAKE_PROBE_INTERVAL_MS 2000  // Mean gap between unaligned probes that keep the estimates honest
+#define WAKE_HOLD_SLOTS 4            // Fleet frames held for wake windows at once
+#define WAKE_MAX_POINTS 8            // Transmit phases per interval; must fit in a uint8_t bitmask
+
+// Receivers send uplink frames only in their own slot of a TDMA superframe timed
+// from the sender's beacons (see Tdma.h). Each superframe opens with a contention
+// period for registrations, then one TDMA_SLOT_MS slot per node; fleets larger
+// than the slot count take turns over several superframes.
+#define ENABLE_TDMA false
+#define TDMA_SUPERFRAME_MS 1000
+#define TDMA_CONTENTION_MS 100
+#define TDMA_SLOT_MS 5
+#define TDMA_GUARD_US 500            // Start this far into a slot, for clock drift and beacon jitter
+#define TDMA_UPLINK_QUEUE 4          // Uplink frames waiting for their slot
+#define TDMA_SYNC_TIMEOUT_MS 10000   // Send straight away after this long without a beacon
+
+// Pick the sender's PHY rate per peer instead of ESP-NOW's fixed 1 Mbit/s (see
+// RateControl.h). Unicast rates adapt to delivery results; the broadcast rate
+// follows the weakest RSSI in the fleet's telemetry, so it needs ENABLE_TELEMETRY.
+#define ENABLE_RATE_CONTROL false
+#define RATE_SAMPLE_EVERY 10         // Unicast frames between tries of a faster rate
+#define RATE_EWMA_PERCENT 25         // Weight of the newest delivery ratio in a rate's average
+#define RATE_MIN_ATTEMPTS 4          // Frames sent at a rate before its ratio is folded in
+#define RATE_BROADCAST_MARGIN_DB 8   // Headroom over a rate's sensitivity for the weakest node
+#define RATE_BROADCAST_LOSS_PERMILLE 50 // Fleet loss that steps the broadcast rate down
+
+// Replicate a versioned show state (pattern, brightness, parameters) from the sender.
+// Keepalives advertise the version, so a receiver that missed a change or rebooted
+// pulls just the fields it lacks (see ShowState.h and show_sync_sim.py).
+#define ENABLE_SHOW_STATE false
+#define SHOW_PATTERN_NAME_LEN 16
+#define SHOW_PARAM_COUNT 8
+#define STATE_ADVERTISE_INTERVAL_MS 2000 // Longest gap between version advertisements, however busy
+#define STATE_REPLY_WINDOW_MS 100        // Requests answered together with one broadcast delta
+#define STATE_REQUEST_JITTER_MS 500      // Receivers wait up to this long before asking, so a delta may arrive first
+#define STATE_REQUEST_RETRY_MS 1000      // Ask again if still behind after this long
+
+// Record raw frames into a ring buffer that can be dumped and replayed over the
+// serial console (see FrameTrace.h and frame_trace.py)
+#define ENABLE_FRAME_TRACE false
+#define FRAME_TRACE_RING_BYTES 8192  // Must be a power of two
+#define FRAME_TRACE_CONSOLE_POLL_MS 50
+
+// Run the protocol microbenchmarks at boot instead of the normal role (see Bench.h
+// and bench_compare.py). Set CONFIG_HEAP_USE_HOOKS to count allocations as well.
+#define ENABLE_BENCH false
+#define BENCH_ITERATIONS 1000
+
+// Log how long each startup phase takes (see BootProfiler.h)
+#define ENABLE_BOOT_PROFILER true
+
+// Leave out setup that a pure ESP-NOW node does not need (the TCP/IP stack) and
+// initialise NVS alongside the Wi-Fi driver instead of before it. Off until the
+// startup report shows it is faster on hardware.
+#define FAST_START false
+
+// Deferred binary logging used on the Wi-Fi task (see DeferredLog.h)
+#define DLOG_LEVEL ESP_LOG_INFO      // Lower-priority DLOG calls compile to nothing
+#define DLOG_RING_SIZE 64            // Records, must be a power of two
+#define DLOG_DRAIN_INTERVAL_MS 1000
+#define DLOG_TEXT_OUTPUT true        // false: print raw records for decode_dlog.py
+
+// The receive callback hands frames to the receive loop (receiver) or reactor
+// (sender) through a lock-free ring that never blocks the Wi-Fi task (see
+// RecvHandoff.h). When the ring is full, the policy picks the frame that is dropped.
+// A DLOG warning fires when it fills to RECV_HIGH_WATER_PERCENT.
+#define RECV_DROP_NEWEST 0
+#define RECV_DROP_OLDEST 1           // Show commands supersede each other, so keep the latest
+#define RECV_OVERFLOW_POLICY RECV_DROP_OLDEST
+#define RECV_HIGH_WATER_PERCENT 75
+// Each slot is a whole MessageEnvelope, sized for an ESP-NOW v2 frame of
+// ESP_NOW_MAX_DATA_LEN_V2 (1470) bytes: about 1.5 KB, so 8 slots take about 12 KB.
+#define RECV_RING_SLOTS 8            // Frames waiting for the consumer, a power of two
+
 #define SENDER_LOG_LEVEL ESP_LOG_DEBUG
 #define RECEIVER_LOG_LEVEL ESP_LOG_DEBUG
 
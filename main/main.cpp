@@ -35,18 +35,32 @@ extern "C" {
 #include "Manager.h"
 #include "Sender.h"
 #include "Receiver.h"
+#include "Metrics.h"
+#include "DeferredLog.h"
+#include "BootProfiler.h"
+#include "Auth.h"
+#include "Bench.h"
 #include "config.h"
 
 extern "C" void app_main() {
     Manager manager;
     esp_err_t err = ESP_OK;
 
+    // Started first so the ESP-NOW callbacks always have somewhere to log
+    DeferredLog::init();
+    BootProfiler::mark("app_main");
+
     err = manager.init();
     if (err != ESP_OK) {
         ESP_LOGE("app_main", "Failed to initialize Manager: %s", esp_err_to_name(err));
         return;
     }
 
+#if ENABLE_BENCH
+    Bench::run();
+    return;
+#endif
+
     switch (DEVICE_ROLE) {
         case DEVICE_ROLE_SENDER:
             // Initialize the example ESPNOW sender
@@ -60,4 +74,11 @@ extern "C" void app_main() {
             ESP_LOGE("app_main", "Invalid device role defined.");
             return;
     }
+    BootProfiler::mark("role init");
+    BootProfiler::report();
+#if ENABLE_AUTH && AUTH_BENCHMARK
+    Auth::benchmark();
+#endif
+
+    Metrics::start();
 }
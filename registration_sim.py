@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+
+import argparse
+import heapq
+import os
+import random
+import re
+
+CONFIG_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "main", "config.h")
+
+ESP_NOW_MAX_DATA_LEN = 250
+HEADER_BYTES = 6           # MessageData without extensions
+BATCH_ENTRY_BYTES = 8      # RegistrationBatchEntry: MAC and node ID
+LOCKSTEP_INTERVAL_MS = 1000
+SLOT_US = 9                # 802.11 slot time
+CW_SLOTS = 16              # Contention window the radio draws its backoff from
+SENSE_US = 20              # A transmission younger than this is not heard yet
+ACK_US = 100               # SIFS and the MAC-level ACK of a unicast
+
+def load_config(path):
+    """Integer #defines from config.h and the headers next to it that hold the registration settings."""
+    values = {}
+    folder = os.path.dirname(path)
+    for name in (path, os.path.join(folder, "Manager.h"), os.path.join(folder, "Auth.h")):
+        if not os.path.exists(name):
+            continue
+        with open(name) as f:
+            for line in f:
+                match = re.match(r"#define\s+(\w+)\s+(\d+)\b", line)
+                if match:
+                    values[match.group(1)] = int(match.group(2))
+    return values
+
+def airtime_us(frame_bytes, rate_mbps):
+    # 802.11 PHY/MAC overhead plus the ESP-NOW vendor action frame header
+    return (frame_bytes + 60) * 8 / rate_mbps
+
+class Medium:
+    """One collision domain: every radio hears every other. Transmissions start after a
+    random backoff, defer while the channel is busy, and collide when they start too
+    close together to sense each other."""
+
+    def __init__(self, rng):
+        self.rng = rng
+        self.on_air = []  # [start, end, collided] of recent transmissions
+
+    def send(self, t, duration):
+        """Puts a frame wanting the channel at `t` on air. Its collided flag is final
+        once its end time has passed."""
+        while True:
+            t += self.rng.randrange(CW_SLOTS) * SLOT_US
+            self.on_air = [tx for tx in self.on_air if tx[1] > t - 10000]
+            busy = [tx[1] for tx in self.on_air if tx[0] <= t - SENSE_US and tx[1] > t]
+            if not busy:
+                break
+            t = max(busy)
+        tx = [t, t + duration, False]
+        for other in self.on_air:
+            if other[1] > t:
+                other[2] = tx[2] = True
+        self.on_air.append(tx)
+        return tx
+
+def simulate(args, cfg, batched, seed):
+    rng = random.Random(seed)
+    medium = Medium(rng)
+    tick_us = 1000000 // args.tick_hz
+    loss = args.loss
+    request_us = airtime_us(HEADER_BYTES, args.rate)
+    # REGISTRATION_BATCH_MAX, with every header extension present
+    batch_max = (ESP_NOW_MAX_DATA_LEN - (HEADER_BYTES + 8 + 7 + 4 + cfg.get("AUTH_TAG_LEN", 8) + 2)) // BATCH_ENTRY_BYTES
+    queue_slots = cfg["RECV_RING_SLOTS"] if batched else cfg["ESPNOW_QUEUE_SIZE"]
+
+    registered_at = [None] * args.nodes
+    attempts = [0] * args.nodes
+    requests = dropped = ack_frames = collisions = 0
+    events = []
+    seq = 0
+
+    def push(t, kind, data=None):
+        nonlocal seq
+        seq += 1
+        heapq.heappush(events, (t, seq, kind, data))
+
+    def backoff_us(attempt):
+        # Receiver::registrationBackoffMs, then vTaskDelay's whole ticks
+        if not batched:
+            ms = LOCKSTEP_INTERVAL_MS
+        else:
+            ceiling = min(cfg["ESPNOW_REGISTRATION_BACKOFF_MAX_MS"], cfg["ESPNOW_REGISTRATION_BACKOFF_BASE_MS"] << min(attempt, 16))
+            ms = rng.randint(0, ceiling)
+        return ms * 1000 // tick_us * tick_us
+
+    for node in range(args.nodes):
+        boot = rng.uniform(0, args.boot_jitter * 1000)
+        # The old loop broadcast straight away; the new one waits first
+        push(boot + (backoff_us(0) if batched else 0), "attempt", node)
+
+    sender_queue = 0           # Frames waiting in the sender's receive queue
+    sender_free_at = 0.0       # When the reactor finishes what it is handling
+    sender_tx = []             # Acknowledgements waiting for the sender's radio, as node lists
+    sender_sending = False
+    pending = []               # Registrations waiting for the batch acknowledgement
+    flush_scheduled = False
+
+    def next_ack(t):
+        nonlocal sender_sending, ack_frames
+        if sender_sending or not sender_tx:
+            return
+        nodes = sender_tx[0][0]
+        sender_sending = True
+        ack_frames += 1
+        size = HEADER_BYTES + 2 if len(nodes) == 1 else HEADER_BYTES + len(nodes) * BATCH_ENTRY_BYTES
+        tx = medium.send(t, airtime_us(size, args.rate) + (ACK_US if len(nodes) == 1 else 0))
+        push(tx[1], "ack_sent", tx)
+
+    while events:
+        t, _, kind, data = heapq.heappop(events)
+        if t > args.timeout * 1000000:
+            break
+        if kind == "attempt":
+            node = data
+            if registered_at[node] is not None:
+                continue
+            requests += 1
+            tx = medium.send(t, request_us)
+            push(tx[1], "request", (node, tx))
+            attempts[node] += 1
+            push(tx[1] + backoff_us(attempts[node]), "attempt", node)
+        elif kind == "request":
+            node, tx = data
+            if tx[2]:
+                collisions += 1
+                continue
+            if rng.random() < loss:
+                continue
+            if sender_queue >= queue_slots:
+                dropped += 1  # Ring full, or the old callback blocked the Wi-Fi task meanwhile
+                continue
+            sender_queue += 1
+            sender_free_at = max(sender_free_at, t) + args.handle_us
+            push(sender_free_at, "handled", node)
+        elif kind == "handled":
+            node = data
+            sender_queue -= 1
+            if not batched:
+                sender_tx.append(([node], 0))
+            elif node not in pending:
+                pending.append(node)
+                if len(pending) == batch_max:
+                    sender_tx.append((pending, 0))
+                    pending = []
+                elif not flush_scheduled:
+                    flush_scheduled = True
+                    push(t + cfg["ESPNOW_REGISTRATION_BATCH_WINDOW_MS"] * 1000, "flush")
+            next_ack(t)
+        elif kind == "flush":
+            flush_scheduled = False
+            if pending:
+                sender_tx.append((pending, 0))
+                pending = []
+            next_ack(t)
+        elif kind == "ack_sent":
+            nodes, tries = sender_tx.pop(0)
+            sender_sending = False
+            if data[2]:
+                collisions += 1
+            got = [n for n in nodes if not data[2] and rng.random() >= loss]
+            for node in got:
+                if registered_at[node] is None:
+                    registered_at[node] = t
+            if len(nodes) == 1 and not got and tries < args.retries:
+                # Unicast: the radio retries until the receiver ACKs
+                sender_tx.insert(0, (nodes, tries + 1))
+            next_ack(t)
+            if all(r is not None for r in registered_at):
+                break
+
+    return registered_at, requests, ack_frames, collisions, dropped
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure time to full registration when a whole fleet powers up at once.")
+    parser.add_argument("--nodes", type=int, default=100)
+    parser.add_argument("--boot-jitter", type=float, default=5, help="Spread of power-up times in ms")
+    parser.add_argument("--loss", type=float, default=0.05, help="Chance of losing each frame at each receiver")
+    parser.add_argument("--handle-us", type=float, default=300, help="Sender time to handle one request")
+    parser.add_argument("--retries", type=int, default=7, help="Radio retries of a unicast frame")
+    parser.add_argument("--rate", type=float, default=1.0, help="PHY rate in Mbit/s")
+    parser.add_argument("--tick-hz", type=int, default=100, help="CONFIG_FREERTOS_HZ")
+    parser.add_argument("--runs", type=int, default=20)
+    parser.add_argument("--timeout", type=float, default=120, help="Give up after this many seconds")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--config", default=CONFIG_H, help="Path to config.h")
+    args = parser.parse_args()
+
+    cfg = load_config(args.config)
+    print(f"{args.nodes} receivers powering up within {args.boot_jitter:.0f} ms, {args.loss * 100:.0f}% loss, "
+          f"{args.runs} runs; backoff {cfg['ESPNOW_REGISTRATION_BACKOFF_BASE_MS']}-"
+          f"{cfg['ESPNOW_REGISTRATION_BACKOFF_MAX_MS']} ms, batch window {cfg['ESPNOW_REGISTRATION_BATCH_WINDOW_MS']} ms")
+
+    modes = (
+        (f"lockstep every {LOCKSTEP_INTERVAL_MS} ms, one ack each", False),
+        ("backoff, batched acks", True),
+    )
+    for name, batched in modes:
+        full, stragglers, requests, acks, collisions, dropped = [], 0, 0, 0, 0, 0
+        for run in range(args.runs):
+            registered_at, r, a, c, d = simulate(args, cfg, batched, args.seed + run)
+            done = [t for t in registered_at if t is not None]
+            if len(done) == args.nodes:
+                full.append(max(done) / 1000000)
+            else:
+                stragglers += args.nodes - len(done)
+            requests, acks, collisions, dropped = requests + r, acks + a, collisions + c, dropped + d
+        full.sort()
+        summary = (f"median {full[len(full) // 2]:5.2f} s, worst {full[-1]:5.2f} s" if full else "never")
+        if stragglers:
+            summary += f", {stragglers} receivers unregistered after {args.timeout:.0f} s"
+        print(f"{name:<36} full registration {summary}  "
+              f"{requests / args.runs / args.nodes:4.1f} requests/receiver, {acks / args.runs:5.1f} ack frames, "
+              f"{collisions / args.runs:5.1f} collisions, {dropped / args.runs:4.1f} requests dropped by the sender")
+
+if __name__ == "__main__":
+    main()
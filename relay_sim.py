@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+
+import argparse
+import heapq
+import math
+import os
+import random
+import re
+
+CONFIG_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "main", "config.h")
+
+def load_config(path):
+    """Integer #defines from config.h."""
+    values = {}
+    with open(path) as f:
+        for line in f:
+            match = re.match(r"#define\s+(\w+)\s+(\d+)\b", line)
+            if match:
+                values[match.group(1)] = int(match.group(2))
+    return values
+
+def airtime_us(frame_bytes, rate_mbps):
+    # 802.11 PHY/MAC overhead plus the ESP-NOW vendor action frame header; broadcasts are not ACKed
+    return (frame_bytes + 60) * 8 / rate_mbps
+
+def grid(args):
+    """Node positions, index 0 being the sender, and who is in radio range of whom."""
+    cells = [(x * args.spacing, y * args.spacing) for y in range(args.height) for x in range(args.width)]
+    if args.sender == "corner":
+        sender = (0.0, 0.0)
+    else:
+        sender = ((args.width - 1) * args.spacing / 2, (args.height - 1) * args.spacing / 2)
+    nodes = [sender] + [c for c in cells if c != sender]
+    neighbours = [[j for j, q in enumerate(nodes) if j != i and math.dist(p, q) <= args.range] for i, p in enumerate(nodes)]
+    return nodes, neighbours
+
+def flood(args, cfg, neighbours, rng, suppress, max_hops):
+    """One fleet frame from the sender, relayed as main/Relay.cpp does.
+
+    `suppress` is RELAY_SUPPRESS_COUNT, or None for naive flooding. Returns the time
+    each node first got the frame (None if never) and the number of transmissions.
+    """
+    count = len(neighbours)
+    airtime = airtime_us(args.frame_bytes, args.rate)
+    delay_us = cfg["RELAY_MAX_DELAY_MS"] * 1000
+
+    got = [None] * count          # First good copy
+    heard = [0] * count           # Copies heard from other relays while waiting
+    busy_until = [0.0] * count    # Carrier sense: when the channel is clear at each node
+    on_air = []                   # (start, end, node) of every transmission so far
+    transmissions = 0
+    events = []
+
+    def push(t, kind, node, hops):
+        heapq.heappush(events, (t, rng.random(), kind, node, hops))
+
+    got[0] = 0.0
+    push(0.0, "start", 0, max_hops)
+    while events:
+        t, _, kind, node, hops = heapq.heappop(events)
+        if kind == "due":
+            # Relay::relayLoop: covered by enough other relays, so stay quiet
+            if suppress is not None and heard[node] >= suppress:
+                continue
+            kind = "start"
+        if kind == "start":
+            if busy_until[node] > t:
+                # The radio defers while it hears someone else
+                push(busy_until[node] + rng.uniform(0, 200), "start", node, hops)
+                continue
+            transmissions += 1
+            on_air.append((t, t + airtime, node))
+            for n in neighbours[node]:
+                busy_until[n] = max(busy_until[n], t + airtime)
+            push(t + airtime, "end", node, hops)
+        elif kind == "end":
+            start = t - airtime
+            for n in neighbours[node]:
+                # Lost to another transmission in range of the receiver, or while it was sending itself
+                collided = any(s < t and e > start and o != node and (o == n or n in neighbours[o]) for s, e, o in on_air)
+                if collided or rng.random() < args.loss:
+                    continue
+                if rng.random() < args.corrupt:
+                    continue  # Bad CRC: Relay::admit drops it without marking the frame seen
+                if got[n] is not None:
+                    heard[n] += 1
+                    continue
+                got[n] = t
+                if hops > 0:
+                    push(t + rng.uniform(0, delay_us), "due", n, hops - 1)
+    return got, transmissions
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure relay coverage and airtime over a grid of receivers.")
+    parser.add_argument("--width", type=int, default=12, help="Receivers per row")
+    parser.add_argument("--height", type=int, default=12, help="Rows")
+    parser.add_argument("--spacing", type=float, default=10, help="Metres between neighbours")
+    parser.add_argument("--range", type=float, default=25, help="Radio range in metres")
+    parser.add_argument("--sender", choices=("center", "corner"), default="center")
+    parser.add_argument("--loss", type=float, default=0.1, help="Chance of losing each copy on each link")
+    parser.add_argument("--corrupt", type=float, default=0.02, help="Chance of a copy arriving with a bad CRC")
+    parser.add_argument("--frame-bytes", type=int, default=120)
+    parser.add_argument("--rate", type=float, default=1.0, help="PHY rate in Mbit/s")
+    parser.add_argument("--frames", type=int, default=200)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--config", default=CONFIG_H, help="Path to config.h")
+    args = parser.parse_args()
+
+    cfg = load_config(args.config)
+    nodes, neighbours = grid(args)
+    receivers = len(nodes) - 1
+    airtime = airtime_us(args.frame_bytes, args.rate)
+    print(f"{receivers} receivers on a {args.width}x{args.height} grid, {args.spacing:.0f} m apart, "
+          f"{args.range:.0f} m range, sender at the {args.sender}, {args.loss * 100:.0f}% loss, "
+          f"{args.corrupt * 100:.0f}% corrupted, {args.frames} frames")
+
+    modes = (
+        ("direct only", 0, 0),
+        ("flooding", None, cfg["RELAY_MAX_HOPS"]),
+        (f"relay (suppress {cfg['RELAY_SUPPRESS_COUNT']})", cfg["RELAY_SUPPRESS_COUNT"], cfg["RELAY_MAX_HOPS"]),
+    )
+    for name, suppress, hops in modes:
+        rng = random.Random(args.seed)
+        covered, sent, latencies, worst = 0, 0, [], receivers
+        for _ in range(args.frames):
+            got, transmissions = flood(args, cfg, neighbours, rng, suppress, hops)
+            reached = [t for t in got[1:] if t is not None]
+            covered += len(reached)
+            worst = min(worst, len(reached))
+            sent += transmissions
+            latencies += reached
+        latencies.sort()
+        pick = lambda q: latencies[min(len(latencies) - 1, int(q * len(latencies)))] / 1000 if latencies else 0
+        print(f"{name:<20} coverage {covered * 100.0 / (receivers * args.frames):5.1f}% (worst frame {worst}/{receivers})  "
+              f"{sent / args.frames:5.1f} tx/frame, {sent * airtime / args.frames / 1000:5.1f} ms airtime  "
+              f"latency median {pick(0.5):.1f} ms, p99 {pick(0.99):.1f} ms")
+
+if __name__ == "__main__":
+    main()
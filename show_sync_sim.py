@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+
+import argparse
+import heapq
+import os
+import random
+import re
+
+CONFIG_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "main", "config.h")
+
+def load_config(path):
+    """Integer #defines from config.h."""
+    values = {}
+    with open(path) as f:
+        for line in f:
+            match = re.match(r"#define\s+(\w+)\s+(\d+)\b", line)
+            if match:
+                values[match.group(1)] = int(match.group(2))
+    return values
+
+class Sender:
+    """Version bookkeeping from main/ShowState.cpp and the sender reactor."""
+
+    def __init__(self, cfg):
+        self.fields = 2 + cfg["SHOW_PARAM_COUNT"]
+        self.field_bytes = [cfg["SHOW_PATTERN_NAME_LEN"], 1] + [2] * cfg["SHOW_PARAM_COUNT"]
+        self.field_versions = [0] * self.fields
+        self.version = 0
+        self.last_delta = 0
+        self.requested = None  # Oldest version asked for in the current reply window
+        self.next_advertise = 0.0
+
+    def change(self, rng):
+        self.version += 1
+        self.field_versions[rng.randrange(self.fields)] = self.version
+
+    def delta_bytes(self, base):
+        # StateDeltaHeader plus the fields stamped after `base`
+        return 12 + sum(size for size, v in zip(self.field_bytes, self.field_versions) if base == 0 or v > base)
+
+def simulate(args, cfg, rng):
+    sender = Sender(cfg)
+    advertise = cfg["STATE_ADVERTISE_INTERVAL_MS"] / 1000
+    window = cfg["STATE_REPLY_WINDOW_MS"] / 1000
+    jitter = cfg["STATE_REQUEST_JITTER_MS"] / 1000
+    retry = cfg["STATE_REQUEST_RETRY_MS"] / 1000
+
+    version = [0] * args.nodes          # Each receiver's show state version
+    timer = [None] * args.nodes         # When its pending request fires
+    partitioned = set(rng.sample(range(args.nodes), int(args.nodes * args.partitioned)))
+    rebooted = set(rng.sample(sorted(partitioned), int(len(partitioned) * args.rebooted)))
+    heal = args.warmup + args.partition
+    stats = {"requests": 0, "replies": 0, "reply_bytes": 0}
+
+    events = []
+    def push(t, kind, node=None, data=None):
+        heapq.heappush(events, (t, len(events) + rng.random(), kind, node, data))
+
+    def hears(node, t):
+        return not (node in partitioned and args.warmup <= t < heal) and rng.random() >= args.loss
+
+    def note(node, t, advertised):
+        # Receiver::noteStateVersion
+        if version[node] < advertised and timer[node] is None:
+            timer[node] = t + rng.uniform(0, jitter)
+            push(timer[node], "request", node)
+
+    def rearm_advertise(t):
+        # TIMER_STATE_ADVERTISE moves whenever the version goes out
+        sender.next_advertise = t + advertise
+        push(sender.next_advertise, "advertise", data=sender.next_advertise)
+
+    def broadcast_delta(t, base):
+        size = sender.delta_bytes(base)
+        for node in range(args.nodes):
+            if hears(node, t):
+                if version[node] >= base or base == 0:
+                    version[node] = max(version[node], sender.version)
+                note(node, t, sender.version)
+        sender.last_delta = max(sender.last_delta, sender.version)
+        rearm_advertise(t)
+        return size
+
+    t = 0.0
+    while t < args.seconds:
+        t += rng.expovariate(1 / args.change_interval)
+        push(t, "change")
+    rearm_advertise(0.0)
+    push(args.warmup + args.partition / 2, "reboot")
+
+    converged_at = [None] * args.nodes
+    target = None
+    while events:
+        t, _, kind, node, data = heapq.heappop(events)
+        if t > args.seconds:
+            break
+        if kind == "change":
+            sender.change(rng)
+            broadcast_delta(t, sender.last_delta)
+        elif kind == "advertise":
+            if data != sender.next_advertise:
+                continue
+            for n in range(args.nodes):
+                if hears(n, t):
+                    note(n, t, sender.version)
+            rearm_advertise(t)
+        elif kind == "reboot":
+            for n in rebooted:
+                version[n] = 0  # A new epoch to the receiver: it will ask for a snapshot
+        elif kind == "request":
+            if t != timer[node]:
+                continue
+            timer[node] = None
+            if version[node] >= sender.version:
+                continue
+            stats["requests"] += 1
+            partitioned_now = node in partitioned and args.warmup <= t < heal
+            if not partitioned_now and rng.random() >= args.loss:
+                if sender.requested is None:
+                    push(t + window, "reply")
+                    sender.requested = version[node]
+                sender.requested = min(sender.requested, version[node])
+            timer[node] = t + retry
+            push(timer[node], "request", node)
+        elif kind == "reply":
+            stats["replies"] += 1
+            stats["reply_bytes"] += broadcast_delta(t, sender.requested)
+            sender.requested = None
+
+        if t >= heal:
+            if target is None:
+                target = sender.version  # What the fleet should show when the partition heals
+            for n in partitioned:
+                if converged_at[n] is None and version[n] >= target:
+                    converged_at[n] = t - heal
+
+    times = sorted(c if c is not None else float("inf") for n, c in enumerate(converged_at) if n in partitioned)
+    return times, stats
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure show state convergence after a partition.")
+    parser.add_argument("--nodes", type=int, default=150)
+    parser.add_argument("--partitioned", type=float, default=0.3, help="Share of receivers cut off")
+    parser.add_argument("--rebooted", type=float, default=0.3, help="Share of the cut-off receivers that reboot meanwhile")
+    parser.add_argument("--partition", type=float, default=30, help="Seconds the partition lasts")
+    parser.add_argument("--warmup", type=float, default=10, help="Seconds before the partition starts")
+    parser.add_argument("--seconds", type=float, default=120, help="Simulated time")
+    parser.add_argument("--change-interval", type=float, default=1.0, help="Mean seconds between show changes")
+    parser.add_argument("--loss", type=float, default=0.1, help="Chance of losing each frame, either way")
+    parser.add_argument("--trials", type=int, default=50)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--config", default=CONFIG_H, help="Path to config.h")
+    args = parser.parse_args()
+
+    cfg = load_config(args.config)
+    rng = random.Random(args.seed)
+    times, requests, replies, reply_bytes = [], 0, 0, 0
+    for _ in range(args.trials):
+        t, stats = simulate(args, cfg, rng)
+        times += t
+        requests += stats["requests"]
+        replies += stats["replies"]
+        reply_bytes += stats["reply_bytes"]
+    times.sort()
+    pick = lambda q: times[min(len(times) - 1, int(q * len(times)))]
+    bound = (cfg["STATE_ADVERTISE_INTERVAL_MS"] + cfg["STATE_REQUEST_JITTER_MS"] + cfg["STATE_REPLY_WINDOW_MS"]) / 1000
+
+    print(f"{args.nodes} nodes, {int(args.nodes * args.partitioned)} partitioned for {args.partition:.0f} s, "
+          f"{args.loss * 100:.0f}% loss, {args.trials} trials")
+    print(f"convergence after heal: median {pick(0.5):.2f} s, p99 {pick(0.99):.2f} s, worst {times[-1]:.2f} s "
+          f"(lossless bound {bound:.2f} s, plus {cfg['STATE_REQUEST_RETRY_MS'] / 1000:.1f} s per lost request or reply)")
+    print(f"per trial: {requests / args.trials:.1f} requests, {replies / args.trials:.1f} catch-up broadcasts, "
+          f"{reply_bytes / max(replies, 1):.0f} bytes each")
+
+if __name__ == "__main__":
+    main()
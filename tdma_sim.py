@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+
+import argparse
+import os
+import random
+import re
+
+CONFIG_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "main", "config.h")
+
+def load_config(path):
+    """Integer #defines from config.h."""
+    values = {}
+    with open(path) as f:
+        for line in f:
+            match = re.match(r"#define\s+(\w+)\s+(\d+)\b", line)
+            if match:
+                values[match.group(1)] = int(match.group(2))
+    return values
+
+def airtime_us(frame_bytes, rate_mbps):
+    # 802.11 PHY/MAC overhead plus the ESP-NOW vendor action frame header, and the ACK
+    return (frame_bytes + 60) * 8 / rate_mbps + 300
+
+class Tdma:
+    """Slot arithmetic from main/Tdma.cpp, with the receiver's clock running `ppm` fast."""
+
+    def __init__(self, cfg, nodes):
+        self.superframe_us = cfg["TDMA_SUPERFRAME_MS"] * 1000
+        self.contention_us = cfg["TDMA_CONTENTION_MS"] * 1000
+        self.slot_us = cfg["TDMA_SLOT_MS"] * 1000
+        self.guard_us = cfg["TDMA_GUARD_US"]
+        self.slots = (cfg["TDMA_SUPERFRAME_MS"] - cfg["TDMA_CONTENTION_MS"]) // cfg["TDMA_SLOT_MS"]
+        self.cycle = max(1, -(-nodes // self.slots))
+
+    def next_transmit(self, node, after_us, last_beacon_us, ppm):
+        # Superframes are counted from the last beacon heard, on the node's own clock
+        index = node - 1
+        slot, turn = index % self.slots, index // self.slots
+        period = self.superframe_us * (1 + ppm * 1e-6)
+        k = max(0, int((after_us - last_beacon_us) // period))
+        while True:
+            if (round(last_beacon_us / self.superframe_us) + k) % self.cycle == turn:
+                start = last_beacon_us + k * period + (self.contention_us + slot * self.slot_us + self.guard_us) * (1 + ppm * 1e-6)
+                if start >= after_us:
+                    return start
+            k += 1
+
+def simulate(args, cfg, slotted):
+    rng = random.Random(args.seed)
+    tdma = Tdma(cfg, args.nodes)
+    duration_us = args.seconds * 1_000_000
+    interval_ms = max(cfg["TELEMETRY_MIN_INTERVAL_MS"], args.nodes * cfg["TELEMETRY_PER_NODE_MS"])
+    ppm = [rng.uniform(-args.ppm, args.ppm) for _ in range(args.nodes)]
+    airtime = airtime_us(args.frame_bytes, args.rate)
+
+    # Reports every node generates: jittered telemetry, plus everyone answering one
+    # fleet-wide request (a LatencyReportRequest) in the middle of the run
+    generated = []
+    for node in range(1, args.nodes + 1):
+        t = rng.uniform(0, interval_ms * 1000)
+        while t < duration_us:
+            generated.append((t, node))
+            t += rng.uniform(0.5, 1.5) * interval_ms * 1000
+        generated.append((duration_us / 2 + rng.uniform(0, 2000), node))
+
+    transmissions = []
+    delays = []
+    next_free = {}  # One frame per slot: a node's queued reports wait for its later slots
+    for created, node in sorted(generated):
+        if not slotted:
+            start = created
+        else:
+            created_or_queued = max(created, next_free.get(node, 0))
+            # Most recent beacon the node heard before the report was created
+            beacon = (created_or_queued // tdma.superframe_us) * tdma.superframe_us
+            while beacon > 0 and rng.random() < args.beacon_loss:
+                beacon -= tdma.superframe_us
+            start = tdma.next_transmit(node, created_or_queued, beacon + rng.uniform(0, args.beacon_jitter_us), ppm[node - 1])
+            next_free[node] = start + tdma.slot_us
+        transmissions.append((start, start + airtime))
+        delays.append(start - created)
+
+    # A transmission collides when it overlaps any other
+    transmissions.sort()
+    collided = [False] * len(transmissions)
+    latest_end, latest_index = -1.0, -1
+    for i, (start, end) in enumerate(transmissions):
+        if start < latest_end:
+            collided[i] = True
+            collided[latest_index] = True
+        if end > latest_end:
+            latest_end, latest_index = end, i
+    delays.sort()
+    return len(transmissions), sum(collided), delays[len(delays) // 2], delays[-1]
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare uplink collisions with and without TDMA slots.")
+    parser.add_argument("--nodes", type=int, default=150)
+    parser.add_argument("--seconds", type=int, default=600, help="Simulated time")
+    parser.add_argument("--frame-bytes", type=int, default=60, help="Uplink frame size, a typical telemetry report")
+    parser.add_argument("--rate", type=float, default=1.0, help="PHY rate in Mbit/s")
+    parser.add_argument("--ppm", type=float, default=20, help="Crystal tolerance of each receiver")
+    parser.add_argument("--beacon-loss", type=float, default=0.1, help="Chance of missing each beacon")
+    parser.add_argument("--beacon-jitter-us", type=float, default=200, help="Spread in when receivers timestamp a beacon")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--config", default=CONFIG_H, help="Path to config.h")
+    args = parser.parse_args()
+
+    cfg = load_config(args.config)
+    tdma = Tdma(cfg, args.nodes)
+    print(f"{args.nodes} nodes, {tdma.slots} slots of {cfg['TDMA_SLOT_MS']} ms, cycle of {tdma.cycle} superframes, "
+          f"{airtime_us(args.frame_bytes, args.rate):.0f} us per frame")
+    for name, slotted in (("random access", False), ("tdma", True)):
+        frames, collided, median_us, worst_us = simulate(args, cfg, slotted)
+        print(f"{name:<14} {frames:>6} frames  {collided:>5} collided ({collided * 100.0 / frames:.2f}%)  "
+              f"delay median {median_us / 1000:.1f} ms, worst {worst_us / 1000:.1f} ms")
+
+if __name__ == "__main__":
+    main()
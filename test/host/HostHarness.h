@@ -0,0 +1,53 @@
+#ifndef HOST_HARNESS_H
+#define HOST_HARNESS_H
+
+#include <cstdint>
+#include <cstring>
+#include "Receiver.h"
+#include "Sender.h"
+
+// Built with main/'s sources and test/host/IdfShims.cpp. Reaches into the sender and
+// receiver the way Bench does on the device, standing in for the tasks the shims never run.
+
+extern uint8_t hostMac[ESP_NOW_ETH_ALEN]; // What esp_wifi_get_mac reports
+extern uint32_t hostFramesSent;           // Calls to esp_now_send
+
+class HostHarness {
+public:
+    // Receiver::init: the receive ring, the protocol's own subscriptions, timers that
+    // never fire. Its tasks are created but not run.
+    static void initReceiver() { Receiver::init(); }
+
+    // One frame through the receive callback, as the Wi-Fi task hands it over, then
+    // through processFrame, parseESPNOWData and dispatch, as recvLoop takes it
+    static void receive(const uint8_t *src, bool broadcast, int8_t rssi, const uint8_t *data, int len) {
+        static const uint8_t broadcastAddr[ESP_NOW_ETH_ALEN] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+        uint8_t srcAddr[ESP_NOW_ETH_ALEN];
+        uint8_t desAddr[ESP_NOW_ETH_ALEN];
+        std::memcpy(srcAddr, src, ESP_NOW_ETH_ALEN);
+        std::memcpy(desAddr, broadcast ? broadcastAddr : hostMac, ESP_NOW_ETH_ALEN);
+        wifi_pkt_rx_ctrl_t rxCtrl = {};
+        rxCtrl.rssi = rssi;
+        rxCtrl.channel = CONFIG_ESPNOW_CHANNEL;
+        esp_now_recv_info_t info = {srcAddr, desAddr, &rxCtrl};
+        Receiver::recvCallback(&info, data, len);
+        Receiver::drainReceivedFrames();
+    }
+
+    // Sender::init: its slots and queues, and the MAC it signs and relays frames with
+    static void initSender() { Sender::init(); }
+
+    // The steps Bench times on the device
+    static void prepare(SendParams &params, const uint8_t *payload, size_t len, PayloadType type) {
+        Sender::prepareSendParams(params, payload, len, type);
+    }
+    static uint16_t nextSequence(const FrameTarget &target) { return Sender::getNextSequenceNumber(target); }
+    static int parse(const uint8_t *data, uint16_t len, const uint8_t *src) {
+        return Receiver::parseESPNOWData(data, len, src);
+    }
+    static void dispatch(const MessageEnvelope &envelope, PayloadType type) { Receiver::dispatch(envelope, type); }
+    static void resetSequences(const uint8_t *src) { Receiver::resetSequenceTracking(src); }
+    static std::unordered_map<std::string, uint16_t> &receiverSequences() { return Receiver::peerLastSequenceNumbers; }
+};
+
+#endif // HOST_HARNESS_H
@@ -0,0 +1,57 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+
+// Shared by the host tests in this directory, each of which is one translation unit
+
+// The consumer's task notification: set by the producer, taken by the consumer
+class Notify {
+public:
+    void give() {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = true;
+        cond.notify_one();
+    }
+    // False if nothing arrived within `timeoutMs`
+    bool take(int timeoutMs) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!cond.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return pending; })) {
+            return false;
+        }
+        pending = false;
+        return true;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool pending = false;
+};
+
+static std::atomic<int> failures{0};
+
+#define CHECK(cond, ...)                         \
+    do {                                         \
+        if (!(cond)) {                           \
+            std::printf("FAIL: " __VA_ARGS__);   \
+            std::printf("\n");                   \
+            failures++;                          \
+        }                                        \
+    } while (0)
+
+// main's return value: 1 if any CHECK failed
+static int testResult() {
+    if (failures > 0) {
+        std::printf("%d failures\n", failures.load());
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
+
+#endif // HOST_TEST_H
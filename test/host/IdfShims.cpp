@@ -0,0 +1,501 @@
+// Host definitions behind the headers in test/host/idf, so the host tools can link
+// main/'s real sources instead of copies. They stand in for ESP-IDF only as far as
+// those tools need: nothing here runs a task, fires a timer or puts a frame on air.
+// The tools call into main/ from one thread, in the order the device's tasks would.
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "esp_cpu.h"
+#include "esp_crc.h"
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_now.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "HostHarness.h"
+
+uint8_t hostMac[ESP_NOW_ETH_ALEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+uint32_t hostFramesSent = 0;
+
+static const auto startTime = std::chrono::steady_clock::now();
+
+// Logging
+
+static std::map<std::string, esp_log_level_t> logLevels;
+static esp_log_level_t defaultLogLevel = ESP_LOG_INFO;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    if (std::strcmp(tag, "*") == 0) {
+        defaultLogLevel = level;
+        logLevels.clear();
+    } else {
+        logLevels[tag] = level;
+    }
+}
+
+static bool logEnabled(esp_log_level_t level, const char *tag) {
+    auto found = logLevels.find(tag);
+    return level <= (found != logLevels.end() ? found->second : defaultLogLevel);
+}
+
+// Same layout as the device's console: "I (1234) Tag: message"
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    if (!logEnabled(level, tag)) {
+        return;
+    }
+    static const char letters[] = "NEWIDV";
+    std::fprintf(stderr, "%c (%lld) %s: ", letters[level], static_cast<long long>(esp_timer_get_time() / 1000), tag);
+    va_list args;
+    va_start(args, format);
+    std::vfprintf(stderr, format, args);
+    va_end(args);
+    std::fputc('\n', stderr);
+}
+
+void esp_log_buffer_hex_internal(const char *tag, const void *buffer, uint16_t len, esp_log_level_t level) {
+    if (!logEnabled(level, tag)) {
+        return;
+    }
+    std::string hex;
+    for (uint16_t i = 0; i < len; i++) {
+        char byte[4];
+        std::snprintf(byte, sizeof(byte), "%02x ", static_cast<const uint8_t *>(buffer)[i]);
+        hex += byte;
+    }
+    esp_log_write(level, tag, "%s", hex.c_str());
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_NVS_NOT_FOUND:
+        return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_ESPNOW_FULL:
+        return "ESP_ERR_ESPNOW_FULL";
+    case ESP_ERR_ESPNOW_EXIST:
+        return "ESP_ERR_ESPNOW_EXIST";
+    default:
+        return "ESP_FAIL";
+    }
+}
+
+// System
+
+// The ROM's CRC-16/CCITT, least significant bit first, as esp_rom_crc16_le computes it
+uint16_t esp_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+// Time stamp counter cycles where there is one, nanoseconds elsewhere. The fence keeps
+// the read from being reordered around the few instructions a short benchmark times.
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_lfence();
+    return static_cast<esp_cpu_cycle_count_t>(__rdtsc());
+#else
+    return static_cast<esp_cpu_cycle_count_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count());
+#endif
+}
+
+static std::mt19937 randomSource(1);
+
+uint32_t esp_random(void) {
+    return randomSource();
+}
+
+void esp_fill_random(void *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        static_cast<uint8_t *>(buf)[i] = static_cast<uint8_t>(randomSource());
+    }
+}
+
+int64_t esp_timer_get_time(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    return 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return 0;
+}
+
+esp_err_t esp_event_loop_create_default(void) {
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_init(void) {
+    return ESP_OK;
+}
+
+// Wi-Fi
+
+static uint8_t channel = CONFIG_ESPNOW_CHANNEL;
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second) {
+    channel = primary;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t *primary, wifi_second_chan_t *second) {
+    *primary = channel;
+    *second = WIFI_SECOND_CHAN_NONE;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_protocol(wifi_interface_t ifx, uint8_t protocol_bitmap) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connectionless_module_set_wake_interval(uint16_t wake_interval) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous(bool enable) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t *filter) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_config_espnow_rate(wifi_interface_t ifx, wifi_phy_rate_t rate) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t mac[6]) {
+    std::memcpy(mac, hostMac, ESP_NOW_ETH_ALEN);
+    return ESP_OK;
+}
+
+// ESP-NOW
+
+static std::set<std::string> peers;
+
+esp_err_t esp_now_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t esp_now_deinit(void) {
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) {
+    return ESP_OK;
+}
+
+esp_err_t esp_now_send(const uint8_t *peer_addr, const uint8_t *data, size_t len) {
+    hostFramesSent++;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer) {
+    std::string key(reinterpret_cast<const char *>(peer->peer_addr), ESP_NOW_ETH_ALEN);
+    if (peers.count(key)) {
+        return ESP_ERR_ESPNOW_EXIST;
+    }
+    if (peers.size() >= ESP_NOW_MAX_TOTAL_PEER_NUM) {
+        return ESP_ERR_ESPNOW_FULL;
+    }
+    peers.insert(key);
+    return ESP_OK;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t *peer_addr) {
+    return peers.erase(std::string(reinterpret_cast<const char *>(peer_addr), ESP_NOW_ETH_ALEN)) ? ESP_OK
+                                                                                                 : ESP_ERR_ESPNOW_NOT_FOUND;
+}
+
+bool esp_now_is_peer_exist(const uint8_t *peer_addr) {
+    return peers.count(std::string(reinterpret_cast<const char *>(peer_addr), ESP_NOW_ETH_ALEN)) > 0;
+}
+
+esp_err_t esp_now_set_pmk(const uint8_t *pmk) {
+    return ESP_OK;
+}
+
+esp_err_t esp_now_set_wake_window(uint16_t window) {
+    return ESP_OK;
+}
+
+esp_err_t esp_now_set_peer_rate_config(const uint8_t *peer_addr, esp_now_rate_config_t *config) {
+    return ESP_OK;
+}
+
+// NVS, keyed by namespace and key
+
+static std::map<std::string, std::vector<uint8_t>> storage;
+static std::vector<std::string> namespaces; // Indexed by handle - 1
+
+static std::string storageKey(nvs_handle_t handle, const char *key) {
+    return namespaces[handle - 1] + "/" + key;
+}
+
+static esp_err_t setValue(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(value);
+    storage[storageKey(handle, key)].assign(bytes, bytes + length);
+    return ESP_OK;
+}
+
+static esp_err_t getValue(nvs_handle_t handle, const char *key, void *out_value, size_t length) {
+    auto found = storage.find(storageKey(handle, key));
+    if (found == storage.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (found->second.size() != length) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    std::memcpy(out_value, found->second.data(), length);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    storage.clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+    namespaces.push_back(name);
+    *out_handle = namespaces.size();
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    return setValue(handle, key, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    auto found = storage.find(storageKey(handle, key));
+    if (found == storage.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value) {
+        if (*length < found->second.size()) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        std::memcpy(out_value, found->second.data(), found->second.size());
+    }
+    *length = found->second.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+    return setValue(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value) {
+    return getValue(handle, key, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value) {
+    return setValue(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value) {
+    return getValue(handle, key, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    return storage.erase(storageKey(handle, key)) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
+
+// FreeRTOS
+
+// Everything runs on one thread, so there is nothing to exclude
+void vPortEnterCritical(portMUX_TYPE *mux) {
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) {
+}
+
+struct QueueDefinition {
+    size_t length;
+    size_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    return new QueueDefinition{length, itemSize, {}};
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait) {
+    if (queue->items.size() >= queue->length) {
+        return pdFALSE; // Nothing else runs that could make room
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(item);
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticksToWait) {
+    if (queue->items.empty()) {
+        return pdFALSE;
+    }
+    std::memcpy(buffer, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return queue->items.size();
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+struct tskTaskControlBlock {
+    const char *name;
+};
+
+static tskTaskControlBlock mainTask = {"main"};
+
+// The task is recorded but never run: the tools call what it would have called
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stackDepth, void *parameters,
+                       UBaseType_t priority, TaskHandle_t *createdTask) {
+    TaskHandle_t handle = new tskTaskControlBlock{name};
+    if (createdTask) {
+        *createdTask = handle;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(pdTICKS_TO_MS(ticks)));
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return static_cast<TickType_t>(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return &mainTask;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return 0;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t ticksToWait) {
+    return pdFALSE;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    return 0;
+}
+
+struct tmrTimerControl {
+    const char *name;
+};
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t autoReload, void *id,
+                           TimerCallbackFunction_t callback) {
+    return new tmrTimerControl{name};
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticksToWait) {
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticksToWait) {
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticksToWait) {
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticksToWait) {
+    return pdPASS;
+}
+
+TaskHandle_t xTimerGetTimerDaemonTaskHandle(void) {
+    return &mainTask;
+}
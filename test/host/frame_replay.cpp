@@ -0,0 +1,190 @@
+// Replays a frame trace capture (see main/FrameTrace.h) through the receiver's real
+// receive path on the build machine: recvCallback, the receive ring, processFrame,
+// parseESPNOWData and dispatch, built from main/ against the ESP-IDF stand-ins in
+// test/host/idf. Received frames are fed with their original spacing, or back to
+// back with --fast to measure throughput. Build and run from the repository root:
+//
+//   g++ -std=gnu++2b -O2 -Itest/host -Itest/host/idf -Imain test/host/frame_replay.cpp test/host/IdfShims.cpp main/Receiver.cpp main/Auth.cpp main/BootProfiler.cpp main/Manager.cpp main/Pairing.cpp main/RecvHandoff.cpp main/Telemetry.cpp main/PeerRegistry.cpp main/DeferredLog.cpp main/Metrics.cpp -o frame_replay
+//   ./frame_replay capture.txt [--fast] [--quiet] [--mac aa:bb:cc:dd:ee:ff]
+//
+// The receiver's own log lines go to stderr, so frames it rejects show up with the
+// reason; commands that reach the application are printed to stdout. Frames signed
+// with ENABLE_AUTH only verify if CONFIG_ESPNOW_PMK matches the fleet's key: pass
+// -DCONFIG_ESPNOW_PMK='"..."' when building.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "esp_mac.h"
+#include "HostHarness.h"
+
+#define TRACE_RX 0x01        // FRAME_TRACE_RX
+#define TRACE_BROADCAST 0x04 // FRAME_TRACE_BROADCAST
+
+// FrameTraceRecord, which main/ only declares with ENABLE_FRAME_TRACE
+struct TraceRecord {
+    uint32_t timestamp_us;
+    uint8_t peer[ESP_NOW_ETH_ALEN];
+    int8_t rssi;
+    uint8_t flags;
+    uint16_t len;
+} __attribute__((packed));
+
+static uint32_t patterns = 0;
+static uint32_t brightnessChanges = 0;
+
+static void onPattern(std::string_view name, const ReceivedFrame &frame) {
+    std::printf("ChangePattern \"%.*s\" from " MACSTR "\n", static_cast<int>(name.size()), name.data(),
+                MAC2STR(frame.envelope.src_mac));
+    patterns++;
+}
+
+static void onBrightness(const ChangeBrightnessPayload &payload, const ReceivedFrame &frame) {
+    std::printf("ChangeBrightness %u from " MACSTR "\n", payload.brightnessLevel, MAC2STR(frame.envelope.src_mac));
+    brightnessChanges++;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Whole records from the "FTRACE:<hex>" lines of a capture, as frame_trace.py reads them
+static std::vector<std::vector<uint8_t>> parseCapture(std::istream &in) {
+    std::vector<std::vector<uint8_t>> records;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t marker = line.find("FTRACE:");
+        if (marker == std::string::npos) {
+            continue;
+        }
+        std::vector<uint8_t> raw;
+        size_t pos = marker + 7;
+        bool hex = true;
+        for (; pos + 1 < line.size() && hexDigit(line[pos]) >= 0; pos += 2) {
+            int high = hexDigit(line[pos]);
+            int low = hexDigit(line[pos + 1]);
+            if (low < 0) {
+                hex = false;
+                break;
+            }
+            raw.push_back(static_cast<uint8_t>(high << 4 | low));
+        }
+        while (pos < line.size() && (line[pos] == '\r' || line[pos] == ' ')) {
+            pos++;
+        }
+        if (!hex || pos != line.size() || raw.size() < sizeof(TraceRecord)) {
+            continue; // END, REPLAYED and other status lines
+        }
+        TraceRecord header;
+        std::memcpy(&header, raw.data(), sizeof(header));
+        if (raw.size() == sizeof(header) + header.len) {
+            records.push_back(raw);
+        }
+    }
+    return records;
+}
+
+static bool parseMac(const char *text, uint8_t *mac) {
+    unsigned bytes[ESP_NOW_ETH_ALEN];
+    if (std::sscanf(text, "%x:%x:%x:%x:%x:%x", &bytes[0], &bytes[1], &bytes[2], &bytes[3], &bytes[4], &bytes[5]) != 6) {
+        return false;
+    }
+    for (int i = 0; i < ESP_NOW_ETH_ALEN; i++) {
+        mac[i] = static_cast<uint8_t>(bytes[i]);
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *path = nullptr;
+    bool fast = false;
+    bool quiet = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--fast") == 0) {
+            fast = true;
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (std::strcmp(argv[i], "--mac") == 0 && i + 1 < argc && parseMac(argv[i + 1], hostMac)) {
+            i++; // Our own MAC, which RegistrationBatch acknowledgements are matched against
+        } else if (!path && (argv[i][0] != '-' || std::strcmp(argv[i], "-") == 0)) {
+            path = argv[i];
+        } else {
+            std::fprintf(stderr, "usage: %s capture.txt|- [--fast] [--quiet] [--mac aa:bb:cc:dd:ee:ff]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!path) {
+        std::fprintf(stderr, "usage: %s capture.txt|- [--fast] [--quiet] [--mac aa:bb:cc:dd:ee:ff]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<std::vector<uint8_t>> records;
+    if (std::strcmp(path, "-") == 0) {
+        records = parseCapture(std::cin);
+    } else {
+        std::ifstream in(path);
+        if (!in) {
+            std::fprintf(stderr, "Cannot open %s\n", path);
+            return 1;
+        }
+        records = parseCapture(in);
+    }
+    if (records.empty()) {
+        std::fprintf(stderr, "No FTRACE records in capture\n");
+        return 1;
+    }
+
+    HostHarness::initReceiver();
+    if (quiet) {
+        esp_log_level_set("*", ESP_LOG_NONE);
+    }
+    Receiver::subscribe<PayloadType::ChangePattern>(onPattern);
+    Receiver::subscribe<PayloadType::ChangeBrightness>(onBrightness);
+
+    // Sent frames were recorded on the sender's side of the link; only what a receiver
+    // heard goes back through the receive path, as FrameTrace::replay does on the device
+    uint32_t frames = 0;
+    uint64_t bytes = 0;
+    uint32_t firstUs = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &raw : records) {
+        TraceRecord header;
+        std::memcpy(&header, raw.data(), sizeof(header));
+        if (!(header.flags & TRACE_RX)) {
+            continue;
+        }
+        if (frames == 0) {
+            firstUs = header.timestamp_us;
+        } else if (!fast) {
+            std::this_thread::sleep_until(start + std::chrono::microseconds(header.timestamp_us - firstUs));
+        }
+        HostHarness::receive(header.peer, header.flags & TRACE_BROADCAST, header.rssi, raw.data() + sizeof(header),
+                             header.len);
+        frames++;
+        bytes += header.len;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::printf("%zu records, %u received frames (%llu bytes) replayed in %.1f ms", records.size(), frames,
+                static_cast<unsigned long long>(bytes), elapsed.count() * 1000);
+    if (fast && elapsed.count() > 0) {
+        std::printf(": %.0f frames/s", frames / elapsed.count());
+    }
+    std::printf("\n%u ChangePattern, %u ChangeBrightness dispatched; %u frames sent in reply\n", patterns,
+                brightnessChanges, hostFramesSent);
+    return 0;
+}
@@ -0,0 +1,309 @@
+// Host counterpart of the on-device Bench (main/Bench.cpp): times the protocol hot
+// paths built from main/ against the ESP-IDF stand-ins in test/host/idf, and prints
+// the same "BENCH:{...}" lines, so bench_compare.py can hold CI to a baseline without
+// a board. Cycles come from the time stamp counter; allocations are counted by
+// replacing the global operator new, so every case reports them. The occasional
+// allocation in prepare_send and parse is the NVS stand-in storing the auth counter
+// and replay windows, which the firmware saves every few thousand frames. The cases
+// that need real tasks (queue and ring throughput, send contention) only run on the
+// device.
+//
+// A shared build machine is noisier than a board, so the whole suite runs several
+// times and each case reports its fastest pass; the first pass also warms the caches.
+// Build and run from the repository root:
+//
+//   g++ -std=gnu++2b -O2 -Itest/host -Itest/host/idf -Imain test/host/hot_path_bench.cpp test/host/IdfShims.cpp main/Sender.cpp main/Receiver.cpp main/Auth.cpp main/BootProfiler.cpp main/ChannelSurvey.cpp main/Manager.cpp main/Pairing.cpp main/RecvHandoff.cpp main/Telemetry.cpp main/PeerRegistry.cpp main/DeferredLog.cpp main/Metrics.cpp -o hot_path_bench
+//   ./hot_path_bench [--iterations N] [--passes N] | python3 bench_compare.py - --baseline baseline.json
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "HostHarness.h"
+#include "PeerRegistry.h"
+#include "SpscRing.h"
+
+static std::atomic<uint32_t> allocations{0};
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+static const size_t frameSizes[] = {16, 64, 128, ESP_NOW_MAX_DATA_LEN};
+// ChangePattern payload sizes
+static const size_t payloadSizes[] = {32, 64, 128, 200};
+static const size_t peerCounts[] = {1, 16, 64, PEER_REGISTRY_CAPACITY};
+
+static const uint8_t benchMac[ESP_NOW_ETH_ALEN] = {0x02, 0xbe, 0x4c, 0x00, 0x00, 0x01};
+
+static int iterations = 10000;
+static int passes = 5;
+
+struct BenchStats {
+    uint32_t iterations = 0;
+    uint64_t cycles = 0;
+    uint32_t minCycles = UINT32_MAX;
+    uint32_t allocations = 0;
+};
+
+// Times one call of `op`, so per-iteration setup stays out of the numbers
+template <typename Op>
+static void measure(BenchStats &stats, Op &&op) {
+    uint32_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+    uint32_t start = esp_cpu_get_cycle_count();
+    op();
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    stats.allocations += allocations.load(std::memory_order_relaxed) - allocationsBefore;
+    stats.iterations++;
+    stats.cycles += cycles;
+    if (cycles < stats.minCycles) {
+        stats.minCycles = cycles;
+    }
+}
+
+typedef std::pair<std::string, size_t> CaseKey;
+static std::map<CaseKey, BenchStats> fastest; // Each case's fastest pass so far
+static std::vector<CaseKey> caseOrder;
+
+// Keeps the pass if it is the case's fastest; main prints them once every pass has run
+static void report(const char *name, size_t param, const BenchStats &stats) {
+    if (stats.iterations == 0) {
+        return;
+    }
+    CaseKey key(name, param);
+    auto found = fastest.find(key);
+    if (found == fastest.end()) {
+        caseOrder.push_back(key);
+        fastest[key] = stats;
+    } else {
+        // Allocations are chosen apart from cycles: which pass an NVS save lands in is
+        // fixed, but which pass runs fastest is not
+        uint32_t allocations = std::min(found->second.allocations, stats.allocations);
+        if (stats.cycles / stats.iterations < found->second.cycles / found->second.iterations) {
+            found->second = stats;
+        }
+        found->second.allocations = allocations;
+    }
+}
+
+static void printResult(const char *name, size_t param, const BenchStats &stats) {
+    std::printf("BENCH:{\"name\":\"%s\",\"param\":%u,\"iterations\":%" PRIu32 ",\"cycles_mean\":%" PRIu32
+                ",\"cycles_min\":%" PRIu32 ",\"allocs\":%" PRIu32 "}\n",
+                name, static_cast<unsigned>(param), stats.iterations,
+                static_cast<uint32_t>(stats.cycles / stats.iterations), stats.minCycles, stats.allocations);
+}
+
+static void benchCrc() {
+    static uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    for (size_t i = 0; i < sizeof(frame); i++) {
+        frame[i] = static_cast<uint8_t>(i);
+    }
+    volatile uint16_t sink = 0;
+    for (size_t size : frameSizes) {
+        BenchStats stats;
+        for (int i = 0; i < iterations; i++) {
+            measure(stats, [&] { sink = computeMessageCrc(frame, size); });
+        }
+        report("crc16", size, stats);
+    }
+}
+
+static void benchPrepare() {
+    static SendParams params;
+    uint8_t payload[200];
+    std::memset(payload, 'a', sizeof(payload));
+    for (size_t size : payloadSizes) {
+        BenchStats stats;
+        for (int i = 0; i < iterations; i++) {
+            measure(stats, [&] { HostHarness::prepare(params, payload, size, PayloadType::ChangePattern); });
+        }
+        report("prepare_send", size, stats);
+    }
+}
+
+// Every iteration parses a freshly built frame so the sequence and replay checks pass
+static void benchParse() {
+    static SendParams params;
+    uint8_t payload[200];
+    std::memset(payload, 'a', sizeof(payload));
+    for (size_t size : payloadSizes) {
+        HostHarness::resetSequences(hostMac);
+        BenchStats stats;
+        int failures = 0;
+        for (int i = 0; i < iterations; i++) {
+            HostHarness::prepare(params, payload, size, PayloadType::ChangePattern);
+            measure(stats, [&] {
+                if (HostHarness::parse(params.raw_data, params.data_len, hostMac) < 0) {
+                    failures++;
+                }
+            });
+        }
+        if (failures > 0) {
+            std::fprintf(stderr, "parse: %d of %d frames rejected at payload size %u\n", failures, iterations,
+                         static_cast<unsigned>(size));
+        }
+        report("parse", size, stats);
+    }
+}
+
+static volatile size_t dispatchedBytes = 0;
+
+static void onBenchPattern(std::string_view name, const ReceivedFrame &frame) {
+    dispatchedBytes = dispatchedBytes + name.size();
+}
+
+// The subscription table lookup and handler call, apart from parsing
+static void benchDispatch() {
+    static SendParams params;
+    static MessageEnvelope envelope;
+    uint8_t payload[200];
+    std::memset(payload, 'a', sizeof(payload));
+    Receiver::subscribe<PayloadType::ChangePattern>(onBenchPattern);
+    for (size_t size : payloadSizes) {
+        HostHarness::prepare(params, payload, size, PayloadType::ChangePattern);
+        std::memcpy(envelope.src_mac, hostMac, ESP_NOW_ETH_ALEN);
+        std::memcpy(envelope.data, params.raw_data, params.data_len);
+        envelope.data_len = params.data_len;
+        BenchStats stats;
+        for (int i = 0; i < iterations; i++) {
+            measure(stats, [&] { HostHarness::dispatch(envelope, PayloadType::ChangePattern); });
+        }
+        report("dispatch", size, stats);
+    }
+    Receiver::unsubscribe(PayloadType::ChangePattern);
+}
+
+// recvCallback's copy into a ring slot and the consumer's release, without the wakeup
+static void benchRingHandoff() {
+    static SpscRing<MessageEnvelope, RECV_RING_SLOTS> ring;
+    static uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    for (size_t size : frameSizes) {
+        BenchStats stats;
+        for (int i = 0; i < iterations; i++) {
+            measure(stats, [&] {
+                MessageEnvelope *slot = ring.beginWrite();
+                std::memcpy(slot->data, frame, size);
+                slot->data_len = size;
+                ring.commitWrite();
+                ring.beginRead();
+                ring.endRead();
+            });
+        }
+        report("ring_handoff", size, stats);
+    }
+}
+
+static void peerMac(size_t index, uint8_t *mac) {
+    std::memcpy(mac, benchMac, ESP_NOW_ETH_ALEN);
+    mac[4] = static_cast<uint8_t>(index >> 8);
+    mac[5] = static_cast<uint8_t>(index);
+}
+
+// Peer counts only grow, since the registry never forgets a peer
+static void benchSenderLookup() {
+    for (size_t peers : peerCounts) {
+        for (size_t i = PeerRegistry::size(); i < peers; i++) {
+            uint8_t mac[ESP_NOW_ETH_ALEN];
+            peerMac(i, mac);
+            bool created;
+            PeerRegistry::add(mac, created);
+        }
+
+        BenchStats findStats;
+        BenchStats seqStats;
+        for (int i = 0; i < iterations; i++) {
+            uint8_t mac[ESP_NOW_ETH_ALEN];
+            peerMac(esp_random() % peers, mac);
+            PeerEntry *peer = nullptr;
+            measure(findStats, [&] { peer = PeerRegistry::find(mac); });
+            if (peer) {
+                FrameTarget target = FrameTarget::toNode(peer->node_id);
+                measure(seqStats, [&] { HostHarness::nextSequence(target); });
+            }
+        }
+        report("sender_peer_find", peers, findStats);
+        report("sender_next_seq", peers, seqStats);
+    }
+}
+
+static void benchReceiverLookup() {
+    auto &sequences = HostHarness::receiverSequences();
+    for (size_t peers : peerCounts) {
+        sequences.clear();
+        for (size_t i = 0; i < peers; i++) {
+            uint8_t mac[ESP_NOW_ETH_ALEN];
+            peerMac(i, mac);
+            sequences[std::string(reinterpret_cast<const char *>(mac), ESP_NOW_ETH_ALEN)] = 1;
+        }
+
+        // Same key construction and lookup as the sequence check in parseESPNOWData
+        BenchStats stats;
+        volatile uint16_t sink = 0;
+        for (int i = 0; i < iterations; i++) {
+            uint8_t mac[ESP_NOW_ETH_ALEN];
+            peerMac(esp_random() % peers, mac);
+            measure(stats, [&] {
+                std::string peerKey(reinterpret_cast<const char *>(mac), ESP_NOW_ETH_ALEN);
+                sink = sequences[peerKey];
+            });
+        }
+        report("receiver_seq_lookup", peers, stats);
+    }
+    sequences.clear();
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+            iterations = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--passes") == 0 && i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+            passes = std::atoi(argv[++i]);
+        } else {
+            std::fprintf(stderr, "usage: %s [--iterations N] [--passes N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    HostHarness::initReceiver();
+    HostHarness::initSender();
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    for (int pass = 0; pass < passes; pass++) {
+        benchCrc();
+        benchPrepare();
+        benchParse();
+        benchDispatch();
+        benchRingHandoff();
+        benchSenderLookup();
+        benchReceiverLookup();
+    }
+
+    std::printf("BENCH:START\n");
+    for (const CaseKey &key : caseOrder) {
+        printResult(key.first.c_str(), key.second, fastest[key]);
+    }
+    std::printf("BENCH:END\n");
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef HOST_ESP_CPU_H
+#define HOST_ESP_CPU_H
+
+// Host stand-in for ESP-IDF's esp_cpu.h: the cycle counter (see test/host/IdfShims.cpp)
+
+#include <cstdint>
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+extern "C" esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
+
+#endif // HOST_ESP_CPU_H
@@ -0,0 +1,10 @@
+#ifndef HOST_ESP_CRC_H
+#define HOST_ESP_CRC_H
+
+// Host stand-in for ESP-IDF's esp_crc.h: the ROM CRC routine (see test/host/IdfShims.cpp)
+
+#include <cstdint>
+
+extern "C" uint16_t esp_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len);
+
+#endif // HOST_ESP_CRC_H
@@ -0,0 +1,10 @@
+#ifndef HOST_ESP_EVENT_H
+#define HOST_ESP_EVENT_H
+
+// Host stand-in for ESP-IDF's esp_event.h: the default event loop (see test/host/IdfShims.cpp)
+
+#include "esp_err.h"
+
+extern "C" esp_err_t esp_event_loop_create_default(void);
+
+#endif // HOST_ESP_EVENT_H
@@ -0,0 +1,12 @@
+#ifndef HOST_ESP_MAC_H
+#define HOST_ESP_MAC_H
+
+// Host stand-in for ESP-IDF's esp_mac.h: MAC formatting (see test/host/IdfShims.cpp)
+
+#include <cstdint>
+#include "esp_err.h"
+
+#define MACSTR "%02x:%02x:%02x:%02x:%02x:%02x"
+#define MAC2STR(a) (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+
+#endif // HOST_ESP_MAC_H
@@ -0,0 +1,10 @@
+#ifndef HOST_ESP_NETIF_H
+#define HOST_ESP_NETIF_H
+
+// Host stand-in for ESP-IDF's esp_netif.h: network interface start-up (see test/host/IdfShims.cpp)
+
+#include "esp_err.h"
+
+extern "C" esp_err_t esp_netif_init(void);
+
+#endif // HOST_ESP_NETIF_H
@@ -0,0 +1,14 @@
+#ifndef HOST_ESP_RANDOM_H
+#define HOST_ESP_RANDOM_H
+
+// Host stand-in for ESP-IDF's esp_random.h: a seeded pseudo-random generator, so runs repeat (see test/host/IdfShims.cpp)
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+uint32_t esp_random(void);
+void esp_fill_random(void *buf, size_t len);
+}
+
+#endif // HOST_ESP_RANDOM_H
@@ -0,0 +1,8 @@
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+// Host stand-in for ESP-IDF's esp_system.h: nothing main/ calls on the host (see test/host/IdfShims.cpp)
+
+#include "esp_err.h"
+
+#endif // HOST_ESP_SYSTEM_H
@@ -0,0 +1,11 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+// Host stand-in for ESP-IDF's esp_timer.h: microseconds since the program started (see test/host/IdfShims.cpp)
+
+#include <cstdint>
+#include "esp_err.h"
+
+extern "C" int64_t esp_timer_get_time(void);
+
+#endif // HOST_ESP_TIMER_H
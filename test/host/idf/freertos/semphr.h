@@ -0,0 +1,10 @@
+#ifndef HOST_FREERTOS_SEMPHR_H
+#define HOST_FREERTOS_SEMPHR_H
+
+// Host stand-in for ESP-IDF's freertos/semphr.h: nothing main/ calls on the host (see test/host/IdfShims.cpp)
+
+#include "queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#endif // HOST_FREERTOS_SEMPHR_H
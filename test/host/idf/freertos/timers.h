@@ -0,0 +1,22 @@
+#ifndef HOST_FREERTOS_TIMERS_H
+#define HOST_FREERTOS_TIMERS_H
+
+// Host stand-in for ESP-IDF's freertos/timers.h: timers that are created but never fire (see test/host/IdfShims.cpp)
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef struct tmrTimerControl *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+
+extern "C" {
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t autoReload, void *id,
+                           TimerCallbackFunction_t callback);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticksToWait);
+TaskHandle_t xTimerGetTimerDaemonTaskHandle(void);
+}
+
+#endif // HOST_FREERTOS_TIMERS_H
@@ -0,0 +1,13 @@
+#ifndef HOST_NVS_FLASH_H
+#define HOST_NVS_FLASH_H
+
+// Host stand-in for ESP-IDF's nvs_flash.h: flash start-up (see test/host/IdfShims.cpp)
+
+#include "nvs.h"
+
+extern "C" {
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+}
+
+#endif // HOST_NVS_FLASH_H
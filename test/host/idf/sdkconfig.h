@@ -0,0 +1,16 @@
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+// Host stand-in for ESP-IDF's sdkconfig.h: the Kconfig defaults from main/Kconfig.projbuild (see test/host/IdfShims.cpp)
+
+#define CONFIG_ESPNOW_WIFI_MODE_STATION 1
+#ifndef CONFIG_ESPNOW_PMK // Pass -DCONFIG_ESPNOW_PMK='"..."' to match a fleet's key
+#define CONFIG_ESPNOW_PMK "pmk1234567890123"
+#endif
+#define CONFIG_ESPNOW_LMK "lmk1234567890123"
+#define CONFIG_ESPNOW_CHANNEL 1
+#define CONFIG_ESPNOW_WAKE_INTERVAL 100
+#define CONFIG_ESPNOW_WAKE_WINDOW 50
+#define CONFIG_FREERTOS_HZ 100
+
+#endif // HOST_SDKCONFIG_H
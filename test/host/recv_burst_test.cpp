@@ -0,0 +1,206 @@
+// Host stress test of the receive handoff's overflow policies under bursty traffic:
+// a producer thread standing in for the Wi-Fi task sends bursts of frames faster
+// than the consumer, standing in for recvLoop, can parse them. Build and run from the
+// repository root:
+//
+//   g++ -std=c++17 -O2 -pthread -Imain test/host/recv_burst_test.cpp -o recv_burst_test && ./recv_burst_test
+//
+// Exits non-zero if a frame is neither delivered nor counted as dropped, arrives out of
+// order or torn, a policy drops the wrong frame, or drops happen without the
+// high-water alarm having fired.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include "SpscRing.h"
+#include "HostTest.h"
+
+#define FRAME_DATA_LEN 1470        // ESP_NOW_MAX_DATA_LEN_V2, as MessageEnvelope::data
+#define RING_SLOTS 8               // RECV_RING_SLOTS
+#define HIGH_WATER_PERCENT 75      // RECV_HIGH_WATER_PERCENT
+#define HIGH_WATER ((RING_SLOTS * HIGH_WATER_PERCENT + 99) / 100)
+#define BURSTS 2000
+#define BURST_MAX_FRAMES 24        // Frames in a burst, 1 to this
+#define BURST_GAP_MAX_US 1500      // Idle time after a burst, 0 to this
+#define FRAME_SPACING_US 2         // Between frames within a burst
+#define PARSE_US 30                // Consumer's work per frame, done holding the slot
+
+enum class HandoffPolicy : uint8_t {
+    DropNewest,
+    DropOldest,
+};
+
+// Laid out like MessageEnvelope, so slots are the size the firmware's are
+struct Frame {
+    uint8_t src_mac[6];
+    uint32_t seq;
+    size_t len;
+    uint8_t data[FRAME_DATA_LEN];
+};
+
+typedef SpscRing<Frame, RING_SLOTS> Ring;
+
+// RecvHandoff::beginPush and commitPush over the same ring, with the DLOG records
+// counted and the task notification replaced by Notify
+class Handoff {
+public:
+    explicit Handoff(HandoffPolicy policy) : policy(policy) {}
+
+    Frame *beginPush() {
+        Frame *slot = ring.beginWrite();
+        if (!slot && policy == HandoffPolicy::DropOldest && ring.dropOldest()) {
+            slot = ring.beginWrite();
+            droppedOldest++;
+        } else if (!slot) {
+            droppedNewest++;
+        }
+        return slot;
+    }
+
+    void commitPush() {
+        bool wasEmpty = ring.commitWrite();
+        size_t waiting = ring.size();
+        if (wasEmpty) {
+            notify.give();
+        }
+        if (waiting >= HIGH_WATER) {
+            if (!alarmed) {
+                alarmed = true;
+                alarms++;
+            }
+        } else if (waiting < RING_SLOTS / 2) {
+            alarmed = false;
+        }
+    }
+
+    Ring ring;
+    Notify notify;
+    HandoffPolicy policy;
+    uint32_t droppedOldest = 0; // Policy made room by dropping the oldest frame
+    uint32_t droppedNewest = 0; // Full, or the consumer held the oldest frame
+    uint32_t alarms = 0;
+    bool alarmed = false;
+};
+
+static void spinFor(int us) {
+    auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < until) {
+    }
+}
+
+static void send(Handoff &handoff, uint32_t seq) {
+    if (Frame *slot = handoff.beginPush()) {
+        slot->seq = seq;
+        std::memset(slot->data, static_cast<uint8_t>(seq), sizeof(slot->data));
+        handoff.commitPush();
+    }
+}
+
+static const char *policyName(HandoffPolicy policy) {
+    return policy == HandoffPolicy::DropOldest ? "drop oldest" : "drop newest";
+}
+
+// One frame more than the ring holds, with the consumer stalled: the policy decides
+// exactly which frame goes
+static void overflowByOne(HandoffPolicy policy) {
+    Handoff handoff(policy);
+    for (uint32_t seq = 0; seq <= RING_SLOTS; seq++) {
+        send(handoff, seq);
+    }
+    uint32_t first = policy == HandoffPolicy::DropOldest ? 1 : 0;
+    uint32_t expected = first;
+    while (Frame *frame = handoff.ring.beginRead()) {
+        CHECK(frame->seq == expected, "%s: overflow by one delivered frame %u, expected %u", policyName(policy),
+              frame->seq, expected);
+        expected++;
+        handoff.ring.endRead();
+    }
+    CHECK(expected == first + RING_SLOTS, "%s: overflow by one delivered %u frames", policyName(policy),
+          expected - first);
+    CHECK(handoff.alarms == 1, "%s: overflow by one raised %u alarms", policyName(policy), handoff.alarms);
+}
+
+static void bursts(HandoffPolicy policy) {
+    Handoff handoff(policy);
+    std::atomic<bool> done{false};
+    std::mt19937 rng(1);
+    std::vector<bool> lastOfBurst;
+
+    // Decide the traffic up front so both policies see the same bursts
+    std::vector<std::pair<int, int>> plan; // Frames, then idle microseconds
+    for (int i = 0; i < BURSTS; i++) {
+        int frames = std::uniform_int_distribution<int>(1, BURST_MAX_FRAMES)(rng);
+        plan.push_back({frames, std::uniform_int_distribution<int>(0, BURST_GAP_MAX_US)(rng)});
+        lastOfBurst.insert(lastOfBurst.end(), frames - 1, false);
+        lastOfBurst.push_back(true);
+    }
+    uint32_t sent = lastOfBurst.size();
+
+    uint32_t received = 0;
+    uint32_t lastsReceived = 0;
+    uint32_t torn = 0;
+    std::thread consumer([&] {
+        int64_t last = -1;
+        for (;;) {
+            bool woken = handoff.notify.take(1000);
+            while (Frame *frame = handoff.ring.beginRead()) {
+                CHECK(static_cast<int64_t>(frame->seq) > last, "%s: frame %u after %lld", policyName(policy),
+                      frame->seq, static_cast<long long>(last));
+                last = frame->seq;
+                for (uint8_t byte : frame->data) {
+                    if (byte != static_cast<uint8_t>(frame->seq)) {
+                        torn++;
+                        break;
+                    }
+                }
+                lastsReceived += lastOfBurst[frame->seq];
+                received++;
+                spinFor(PARSE_US);
+                handoff.ring.endRead();
+            }
+            if (done.load() && handoff.ring.size() == 0) {
+                return;
+            }
+            CHECK(woken || handoff.ring.size() == 0 || handoff.notify.take(1000),
+                  "%s: consumer slept through %zu waiting frames", policyName(policy), handoff.ring.size());
+        }
+    });
+
+    uint32_t seq = 0;
+    for (const auto &burst : plan) {
+        for (int i = 0; i < burst.first; i++) {
+            send(handoff, seq++);
+            spinFor(FRAME_SPACING_US);
+        }
+        spinFor(burst.second);
+    }
+    done.store(true);
+    handoff.notify.give();
+    consumer.join();
+
+    uint32_t dropped = handoff.droppedOldest + handoff.droppedNewest;
+    CHECK(received + dropped == sent, "%s: %u received + %u dropped != %u sent", policyName(policy), received,
+          dropped, sent);
+    CHECK(torn == 0, "%s: %u torn frames", policyName(policy), torn);
+    CHECK(dropped == 0 || handoff.alarms > 0, "%s: %u frames dropped without a high-water alarm", policyName(policy),
+          dropped);
+    if (policy == HandoffPolicy::DropNewest) {
+        CHECK(handoff.droppedOldest == 0, "drop newest: dropped %u oldest frames", handoff.droppedOldest);
+    }
+    std::printf("%s: %u frames in %d bursts, %u received, %u dropped (%u oldest, %u newest), %u alarms, "
+                "last frame of %.1f%% of bursts delivered\n",
+                policyName(policy), sent, BURSTS, received, dropped, handoff.droppedOldest, handoff.droppedNewest,
+                handoff.alarms, lastsReceived * 100.0 / BURSTS);
+}
+
+int main() {
+    for (HandoffPolicy policy : {HandoffPolicy::DropNewest, HandoffPolicy::DropOldest}) {
+        overflowByOne(policy);
+        bursts(policy);
+    }
+    return testResult();
+}
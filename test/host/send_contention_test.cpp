@@ -0,0 +1,226 @@
+// Host throughput benchmark of Sender::send under contention: several producer threads,
+// standing in for application tasks, queue move-only payloads through the outgoing
+// slots while a reactor thread drains them. The FreeRTOS queues of slot indices are
+// modelled with a mutex and condition variable each, as their send and receive take a
+// critical section. Build and run from the repository root:
+//
+//   g++ -std=c++17 -O2 -pthread -Imain test/host/send_contention_test.cpp -o send_contention_test && ./send_contention_test
+//
+// Exits non-zero if a frame is delivered twice or out of order for its producer, if a
+// queued frame is neither delivered nor dropped for a newer one, or if OverflowPolicy::Wait
+// loses a frame.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "HostTest.h"
+
+#define SEND_SLOTS 6               // SENDER_SEND_SLOTS, ESPNOW_QUEUE_SIZE
+#define MAX_PAYLOAD_LEN 214        // SENDER_MAX_PAYLOAD_LEN with the default config.h
+#define HEADER_LEN 36              // Header, AuthExtension and the largest addressing extension
+#define FRAMES 400000              // Split between the producers of each run
+#define PAYLOAD_LEN 32
+#define WAIT_MS 1000               // SendOptions::wait_ticks for OverflowPolicy::Wait
+
+enum class OverflowPolicy : uint8_t {
+    Reject,
+    DropOldest,
+    Wait,
+};
+
+enum class SendStatus : uint8_t {
+    Queued,
+    QueuedDroppedOldest,
+    Full,
+    TooLarge,
+};
+
+// A FreeRTOS queue of slot indices
+class IndexQueue {
+public:
+    bool send(uint8_t index) {
+        std::lock_guard<std::mutex> lock(mutex);
+        items.push_back(index);
+        cond.notify_one();
+        return true;
+    }
+    bool receive(uint8_t &index, int waitMs) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!cond.wait_for(lock, std::chrono::milliseconds(waitMs), [this] { return !items.empty(); })) {
+            return false;
+        }
+        index = items.front();
+        items.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<uint8_t> items;
+};
+
+// Owns its bytes, so it can only be moved into send(), as the firmware's API demands
+struct OwnedPayload {
+    std::unique_ptr<uint8_t[]> bytes;
+    size_t len;
+};
+
+struct OutgoingSlot {
+    uint8_t len;
+    uint8_t payload[MAX_PAYLOAD_LEN];
+};
+
+// Sender::send, acquireSlot, commitSlot and releaseSlot over the same two queues
+class Outbox {
+public:
+    Outbox() {
+        for (uint8_t index = 0; index < SEND_SLOTS; index++) {
+            freeSlots.send(index);
+        }
+    }
+
+    SendStatus send(OwnedPayload &&payload, OverflowPolicy overflow) {
+        uint8_t index;
+        SendStatus status = acquireSlot(overflow, index);
+        if (status != SendStatus::Queued && status != SendStatus::QueuedDroppedOldest) {
+            return status;
+        }
+        OutgoingSlot &slot = slots[index];
+        if (payload.len > sizeof(slot.payload)) {
+            freeSlots.send(index);
+            return SendStatus::TooLarge;
+        }
+        std::memcpy(slot.payload, payload.bytes.get(), payload.len);
+        slot.len = static_cast<uint8_t>(payload.len);
+        readySlots.send(index);
+        notify.give();
+        return status;
+    }
+
+    IndexQueue freeSlots;
+    IndexQueue readySlots;
+    OutgoingSlot slots[SEND_SLOTS];
+    Notify notify;
+    std::atomic<uint32_t> droppedOldest{0};
+    std::atomic<uint32_t> rejected{0};
+
+private:
+    SendStatus acquireSlot(OverflowPolicy overflow, uint8_t &index) {
+        if (freeSlots.receive(index, overflow == OverflowPolicy::Wait ? WAIT_MS : 0)) {
+            return SendStatus::Queued;
+        }
+        if (overflow == OverflowPolicy::DropOldest && readySlots.receive(index, 0)) {
+            droppedOldest++;
+            return SendStatus::QueuedDroppedOldest;
+        }
+        rejected++;
+        return SendStatus::Full;
+    }
+};
+
+static const char *policyName(OverflowPolicy policy) {
+    switch (policy) {
+    case OverflowPolicy::Reject:
+        return "reject";
+    case OverflowPolicy::DropOldest:
+        return "drop oldest";
+    default:
+        return "wait";
+    }
+}
+
+// Payloads carry their producer and sequence number, so the reactor can check order
+static OwnedPayload makePayload(uint32_t producer, uint32_t seq) {
+    OwnedPayload payload{std::unique_ptr<uint8_t[]>(new uint8_t[PAYLOAD_LEN]), PAYLOAD_LEN};
+    std::memset(payload.bytes.get(), 0, PAYLOAD_LEN);
+    std::memcpy(payload.bytes.get(), &producer, sizeof(producer));
+    std::memcpy(payload.bytes.get() + sizeof(producer), &seq, sizeof(seq));
+    return payload;
+}
+
+static void run(OverflowPolicy policy, uint32_t producers) {
+    Outbox outbox;
+    std::atomic<bool> done{false};
+    std::vector<int64_t> lastSeq(producers, -1);
+    uint32_t delivered = 0;
+    uint32_t misordered = 0;
+
+    // drainOutgoingMessages: take each committed slot, build the frame, free the slot
+    std::thread reactor([&] {
+        uint8_t frame[HEADER_LEN + MAX_PAYLOAD_LEN] = {};
+        for (;;) {
+            outbox.notify.take(1000);
+            uint8_t index;
+            while (outbox.readySlots.receive(index, 0)) {
+                const OutgoingSlot &slot = outbox.slots[index];
+                std::memcpy(frame + HEADER_LEN, slot.payload, slot.len);
+                outbox.freeSlots.send(index);
+                uint32_t producer;
+                uint32_t seq;
+                std::memcpy(&producer, frame + HEADER_LEN, sizeof(producer));
+                std::memcpy(&seq, frame + HEADER_LEN + sizeof(producer), sizeof(seq));
+                if (static_cast<int64_t>(seq) <= lastSeq[producer]) {
+                    misordered++;
+                }
+                lastSeq[producer] = seq;
+                delivered++;
+            }
+            if (done.load()) {
+                return;
+            }
+        }
+    });
+
+    std::atomic<uint32_t> queued{0};
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t producer = 0; producer < producers; producer++) {
+        threads.emplace_back([&, producer] {
+            uint32_t count = 0;
+            for (uint32_t seq = 0; seq < FRAMES / producers; seq++) {
+                SendStatus status = outbox.send(makePayload(producer, seq), policy);
+                count += status == SendStatus::Queued || status == SendStatus::QueuedDroppedOldest;
+            }
+            queued += count;
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    done.store(true);
+    outbox.notify.give();
+    reactor.join();
+
+    uint32_t sent = FRAMES / producers * producers;
+    CHECK(misordered == 0, "%s, %u producers: %u frames out of order or repeated", policyName(policy), producers,
+          misordered);
+    CHECK(queued + outbox.rejected == sent, "%s, %u producers: %u queued + %u rejected != %u sent", policyName(policy),
+          producers, queued.load(), outbox.rejected.load(), sent);
+    CHECK(delivered + outbox.droppedOldest == queued, "%s, %u producers: %u delivered + %u dropped != %u queued",
+          policyName(policy), producers, delivered, outbox.droppedOldest.load(), queued.load());
+    if (policy == OverflowPolicy::Wait) {
+        CHECK(delivered == sent, "wait, %u producers: %u of %u frames delivered", producers, delivered, sent);
+    }
+    std::printf("%-11s %u producers: %8.0f sends/s, %6u delivered, %6u rejected, %6u dropped oldest\n",
+                policyName(policy), producers, sent / elapsed.count(), delivered, outbox.rejected.load(),
+                outbox.droppedOldest.load());
+}
+
+int main() {
+    for (OverflowPolicy policy : {OverflowPolicy::Reject, OverflowPolicy::DropOldest, OverflowPolicy::Wait}) {
+        for (uint32_t producers : {1u, 2u, 4u, 8u}) {
+            run(policy, producers);
+        }
+    }
+    return testResult();
+}